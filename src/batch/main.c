@@ -0,0 +1,1194 @@
+// Headless batch renderer, renders a mesh lit by the sky and writes the image to disk without opening a window, so it
+// runs on machines without a display, GL driver or GLFW/GLEW, and the main thread sleeps until the render is done
+//
+// usage: ./bin/rtbatch.out [options]
+//   --res WxH                               image resolution (default 1280x720)
+//   --spp N                                 samples per pixel (default 32, or 65536 with --budget)
+//   --budget S                              render passes over the frame until S seconds are up, --spp caps it
+//   --depth N                               max ray bounces (default 8)
+//   --threads N                             render threads (default NUM_HYPERTHREADS)
+//   --numa on|off                           spread the threads over the NUMA nodes, each with its own copy of the
+//                                           scene and band of the image (default off, see Render_Set_Numa)
+//   --tile N                                tile size in pixels (default RENDER_TILE_W_PX)
+//   --adaptive E                            adaptive sampling error threshold, 0 disables (default 0)
+//   --mode path|wavefront|wavefront-sorted  integrator (default path)
+//   --sampler sobol|stratified|random       sample generator (default sobol)
+//   --seed N                                render seed (default RENDER_DEFAULT_SEED)
+//   --denoise on|off                        filter the noise out of the finished image, guided by the albedo, normal
+//                                           and depth each pixel first sees (default off, see rt/denoise.h)
+//   --scene mesh.obj                        mesh to render (default assets/little_dragon.obj)
+//   --envmap sky.hdr                        equirectangular HDR sky (default assets/skybox2 cubemap)
+//   --out image.bmp                         output file (default output.bmp)
+//   --aovs file.exr                         also write the float beauty, first hit albedo, normal, depth, material ID
+//                                           and per pixel spp to one multi-channel OpenEXR
+//   --checkpoint file                       save the render state to file between passes, at most every interval
+//   --checkpoint-interval S                 seconds between checkpoints (default 600)
+//   --resume file                           continue the render saved in a checkpoint (same scene and resolution), its
+//                                           seed, sampler, tile size, adaptive and denoise settings, spp and depth
+//                                           are used
+//   --region X,Y,W,H                        only render this pixel rectangle, can be given up to RENDER_MAX_REGIONS
+//                                           times (the image outside them is black, or --base's)
+//   --base image.bmp                        render the regions over this image (same resolution) instead of black
+//   --animation file.anim                   render every frame of a keyframed camera path and mesh transform (see
+//                                           world/animation.h), frame N is written to image_000N.bmp
+//   --jobs file.jobs                        render many small images, one whole image per thread at a time (for
+//                                           thumbnails and swatches), one job per line of the form
+//                                           out.bmp fromX fromY fromZ toX toY toZ vfov diffuse|metal|glass r g b rough
+//                                           (the mesh's material is replaced by the job's, the scene is built once)
+//   --serve PORT                            coordinate a distributed render: wait for workers on PORT, hand them chunks
+//                                           of samples and write the merged image (see rt/distributed.h)
+//   --connect HOST:PORT                     work on the distributed render served at HOST:PORT, the coordinator's
+//                                           resolution, spp, depth, mode, sampler, seed, scene and envmap are used
+//
+// Alongside the image it writes image.bmp.json with the render settings and what was completed (spp, passes, time)
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gfx/image.h"
+#include "gfx/mesh.h"
+#include "gfx/texture.h"
+#include "math/vec.h"
+#include "platform/misc.h"
+#include "platform/numa.h"
+#include "platform/profiling.h"
+#include "platform/threads.h"
+#include "rt/distributed.h"
+#include "rt/renderer.h"
+#include "world/animation.h"
+#include "world/camera.h"
+#include "world/scene.h"
+
+typedef struct {
+    size_t res_w, res_h;
+    size_t samples_per_pixel;
+    size_t max_ray_depth;
+    size_t num_threads;
+    bool   numa;
+    size_t tile_size;
+    f32    adaptive_error;
+    f32    budget_s;
+    bool   spp_given;
+
+    RenderMode  mode;
+    bool        sort_rays;
+    SamplerType sampler;
+    u64         seed;
+    bool        denoise;
+
+    const char* scene_path;
+    const char* envmap_path;
+    const char* out_path;
+    const char* aovs_path;
+    const char* checkpoint_path;
+    f32         checkpoint_interval_s;
+    const char* resume_path;
+
+    RenderRect  regions[RENDER_MAX_REGIONS];
+    size_t      num_regions;
+    const char* base_path;
+
+    const char* animation_path;
+    const char* jobs_path;
+
+    u16  serve_port;
+    char connect_host[256];
+    u16  connect_port;
+} BatchOptions;
+
+typedef enum {
+    JOB_MATERIAL_DIFFUSE,
+    JOB_MATERIAL_METAL,
+    JOB_MATERIAL_GLASS,
+} JobMaterial;
+
+// One small image of a --jobs render
+typedef struct {
+    char        out_path[1024];
+    point3      look_from;
+    point3      look_to;
+    f32         vfov;
+    JobMaterial material;
+    Color       albedo;
+    f32         roughness;
+} BatchJob;
+
+#define Vector_Type BatchJob
+#include "ctl/containers/vector.h"
+
+// set by SIGINT, the main thread notices it and exports the partial image (stdio isn't async-signal-safe, so the
+// handler itself can't)
+intern volatile sig_atomic_t g_interrupted = 0;
+
+intern bool ExportImage(ImageRGB* img, const char* filename)
+{
+    FILE* fd = fopen(filename, "wb+");
+    if (fd == NULL) {
+        printf("Failed to export render: Cannot open %s\n", filename);
+        return false;
+    }
+
+    if (!ImageRGB_Save_BMP(img, fd)) {
+        fclose(fd);
+        printf("Failed to export render: Cannot write to %s\n", filename);
+        return false;
+    }
+
+    fclose(fd);
+    printf("Exported render to %s\n", filename);
+
+    return true;
+}
+
+intern void InterruptHandler(int sig)
+{
+    (void)sig;
+    g_interrupted = 1;
+}
+
+intern void Batch_Usage(const char* exe)
+{
+    printf(
+        "usage: %s [--res WxH] [--spp N] [--budget S] [--depth N] [--threads N] [--numa on|off] [--tile N]\n"
+        "       [--adaptive E] [--mode path|wavefront|wavefront-sorted] [--sampler sobol|stratified|random]\n"
+        "       [--seed N] [--denoise on|off] [--scene mesh.obj] [--envmap sky.hdr] [--out image.bmp]\n"
+        "       [--aovs file.exr] [--checkpoint file] [--checkpoint-interval S] [--resume file]\n"
+        "       [--region X,Y,W,H ...] [--base image.bmp] [--animation file.anim] [--jobs file.jobs]\n"
+        "       [--serve PORT | --connect HOST:PORT]\n",
+        exe);
+}
+
+intern bool Batch_ParseSize(const char* arg, size_t* value)
+{
+    char*              end;
+    unsigned long long parsed = strtoull(arg, &end, 10);
+
+    if (end == arg || *end != '\0' || parsed == 0) {
+        return false;
+    }
+
+    *value = (size_t)parsed;
+    return true;
+}
+
+intern bool Batch_ParsePort(const char* arg, u16* port)
+{
+    size_t parsed;
+    if (!Batch_ParseSize(arg, &parsed) || parsed > UINT16_MAX) {
+        return false;
+    }
+
+    *port = (u16)parsed;
+    return true;
+}
+
+// HOST:PORT, the port is after the last ':' so the host can be an IPv6 address
+intern bool Batch_ParseAddress(const char* arg, char* host, size_t host_size, u16* port)
+{
+    const char* colon = strrchr(arg, ':');
+    if (colon == NULL || colon == arg || (size_t)(colon - arg) >= host_size) {
+        return false;
+    }
+
+    memcpy(host, arg, (size_t)(colon - arg));
+    host[colon - arg] = '\0';
+
+    return Batch_ParsePort(colon + 1, port);
+}
+
+intern bool Batch_ParseArgs(int argc, char** argv, BatchOptions* opts)
+{
+    for (int ii = 1; ii < argc; ii++) {
+        const char* flag = argv[ii];
+
+        if (ii + 1 >= argc) {
+            printf("Missing value for %s\n", flag);
+            return false;
+        }
+
+        const char* value = argv[++ii];
+        bool        valid = true;
+
+        if (strcmp(flag, "--res") == 0) {
+            unsigned long long res_w = 0, res_h = 0;
+            valid = sscanf(value, "%llux%llu", &res_w, &res_h) == 2 && res_w > 0 && res_h > 0;
+
+            opts->res_w = (size_t)res_w;
+            opts->res_h = (size_t)res_h;
+        } else if (strcmp(flag, "--spp") == 0) {
+            valid           = Batch_ParseSize(value, &opts->samples_per_pixel);
+            opts->spp_given = true;
+        } else if (strcmp(flag, "--budget") == 0) {
+            opts->budget_s = (f32)atof(value);
+            valid          = opts->budget_s > 0.0f;
+        } else if (strcmp(flag, "--depth") == 0) {
+            valid = Batch_ParseSize(value, &opts->max_ray_depth);
+        } else if (strcmp(flag, "--threads") == 0) {
+            valid = Batch_ParseSize(value, &opts->num_threads);
+        } else if (strcmp(flag, "--numa") == 0) {
+            opts->numa = strcmp(value, "on") == 0;
+            valid      = opts->numa || strcmp(value, "off") == 0;
+        } else if (strcmp(flag, "--denoise") == 0) {
+            opts->denoise = strcmp(value, "on") == 0;
+            valid         = opts->denoise || strcmp(value, "off") == 0;
+        } else if (strcmp(flag, "--tile") == 0) {
+            valid = Batch_ParseSize(value, &opts->tile_size);
+        } else if (strcmp(flag, "--adaptive") == 0) {
+            opts->adaptive_error = (f32)atof(value);
+        } else if (strcmp(flag, "--mode") == 0) {
+            if (strcmp(value, "path") == 0) {
+                opts->mode = RENDER_MODE_PATH;
+            } else if (strcmp(value, "wavefront") == 0 || strcmp(value, "wavefront-sorted") == 0) {
+                opts->mode      = RENDER_MODE_WAVEFRONT;
+                opts->sort_rays = strcmp(value, "wavefront-sorted") == 0;
+            } else {
+                valid = false;
+            }
+        } else if (strcmp(flag, "--sampler") == 0) {
+            if (strcmp(value, "random") == 0) {
+                opts->sampler = SAMPLER_RANDOM;
+            } else if (strcmp(value, "stratified") == 0) {
+                opts->sampler = SAMPLER_STRATIFIED;
+            } else if (strcmp(value, "sobol") == 0) {
+                opts->sampler = SAMPLER_SOBOL;
+            } else {
+                valid = false;
+            }
+        } else if (strcmp(flag, "--seed") == 0) {
+            opts->seed = strtoull(value, NULL, 0);
+        } else if (strcmp(flag, "--scene") == 0) {
+            opts->scene_path = value;
+        } else if (strcmp(flag, "--envmap") == 0) {
+            opts->envmap_path = value;
+        } else if (strcmp(flag, "--out") == 0) {
+            opts->out_path = value;
+        } else if (strcmp(flag, "--aovs") == 0) {
+            opts->aovs_path = value;
+        } else if (strcmp(flag, "--checkpoint") == 0) {
+            opts->checkpoint_path = value;
+        } else if (strcmp(flag, "--checkpoint-interval") == 0) {
+            opts->checkpoint_interval_s = (f32)atof(value);
+            valid                       = opts->checkpoint_interval_s >= 0.0f;
+        } else if (strcmp(flag, "--resume") == 0) {
+            opts->resume_path = value;
+        } else if (strcmp(flag, "--region") == 0) {
+            unsigned long long x = 0, y = 0, w = 0, h = 0;
+            valid = opts->num_regions < RENDER_MAX_REGIONS
+                    && sscanf(value, "%llu,%llu,%llu,%llu", &x, &y, &w, &h) == 4 && w > 0 && h > 0;
+
+            if (valid) {
+                opts->regions[opts->num_regions++] = (RenderRect){.x = x, .y = y, .w = w, .h = h};
+            }
+        } else if (strcmp(flag, "--base") == 0) {
+            opts->base_path = value;
+        } else if (strcmp(flag, "--animation") == 0) {
+            opts->animation_path = value;
+        } else if (strcmp(flag, "--jobs") == 0) {
+            opts->jobs_path = value;
+        } else if (strcmp(flag, "--serve") == 0) {
+            valid = Batch_ParsePort(value, &opts->serve_port);
+        } else if (strcmp(flag, "--connect") == 0) {
+            valid = Batch_ParseAddress(value, opts->connect_host, sizeof(opts->connect_host), &opts->connect_port);
+        } else {
+            printf("Unknown option %s\n", flag);
+            return false;
+        }
+
+        if (!valid) {
+            printf("Invalid value for %s: %s\n", flag, value);
+            return false;
+        }
+    }
+
+    bool distributed = opts->serve_port != 0 || opts->connect_port != 0;
+    if (distributed && (opts->budget_s > 0.0f || opts->checkpoint_path || opts->resume_path || opts->num_regions)) {
+        printf("--budget, --checkpoint, --resume and --region can't be used with --serve or --connect\n");
+        return false;
+    }
+
+    bool single_image = distributed || opts->checkpoint_path || opts->resume_path || opts->base_path;
+    if (opts->animation_path && single_image) {
+        printf("--animation can't be used with --checkpoint, --resume, --base, --serve or --connect\n");
+        return false;
+    }
+
+    // jobs render in one pass on one thread each, and write their own images
+    bool multi_pass = opts->budget_s > 0.0f || opts->adaptive_error > 0.0f;
+    if (opts->jobs_path && (single_image || multi_pass || opts->animation_path)) {
+        printf("--jobs can't be used with --budget, --adaptive, --animation or any single image option\n");
+        return false;
+    }
+
+    // jobs don't use the render pool, so there are no workers to spread over nodes
+    if (opts->jobs_path && opts->numa) {
+        printf("--numa can't be used with --jobs\n");
+        return false;
+    }
+
+    // workers only hand back radiance sums, the coordinator has no guides to filter the merged image with (or export)
+    if (distributed && (opts->denoise || opts->aovs_path)) {
+        printf("--denoise and --aovs can't be used with --serve or --connect\n");
+        return false;
+    }
+
+    if (opts->aovs_path && (opts->animation_path || opts->jobs_path)) {
+        printf("--aovs can't be used with --animation or --jobs\n");
+        return false;
+    }
+
+    if (opts->serve_port != 0 && opts->connect_port != 0) {
+        printf("--serve and --connect can't be used together\n");
+        return false;
+    }
+
+    return true;
+}
+
+intern Mesh* Batch_Mesh(const char* mesh_path, Material* material)
+{
+    FILE* fd = fopen(mesh_path, "r");
+    if (fd == NULL) {
+        ABORT("Couldn't open %s", mesh_path);
+    }
+
+    Mesh* mesh = Mesh_New();
+    if (mesh == NULL || !Mesh_Import_OBJ(mesh, fd)) {
+        ABORT("Failed to import %s", mesh_path);
+    }
+    fclose(fd);
+
+    Mesh_Set_Material(mesh, material);
+
+    return mesh;
+}
+
+// Builds a scene from the mesh with its current transform, the mesh is kept so later frames can reuse it
+intern Scene* Batch_Scene(Mesh* mesh, Skybox* skybox)
+{
+    Scene* scene = Scene_New(skybox);
+    if (scene == NULL) {
+        ABORT("Failed to create scene");
+    }
+
+    Mesh_AddToScene(mesh, scene);
+
+    if (!Scene_Prepare(scene)) {
+        ABORT("Failed to prepare scene");
+    }
+
+    return scene;
+}
+
+// Writes str as a quoted JSON string
+intern void Batch_WriteString(FILE* fd, const char* str)
+{
+    fputc('"', fd);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', fd);
+        }
+        fputc(*str, fd);
+    }
+    fputc('"', fd);
+}
+
+intern bool Batch_WriteMetadata(const char* image_path, BatchOptions* opts, RenderStats* stats, i64 elapsed_ms)
+{
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s.json", image_path) >= (int)sizeof(path)) {
+        return false;
+    }
+
+    FILE* fd = fopen(path, "w");
+    if (fd == NULL) {
+        printf("Failed to write render metadata: Cannot open %s\n", path);
+        return false;
+    }
+
+    fprintf(fd, "{\n    \"image\": ");
+    Batch_WriteString(fd, image_path);
+    fprintf(fd, ",\n    \"scene\": ");
+    Batch_WriteString(fd, opts->scene_path);
+
+    fprintf(
+        fd,
+        ",\n"
+        "    \"resolution\": [%zu, %zu],\n"
+        "    \"max_ray_depth\": %zu,\n"
+        "    \"seed\": " U64_DEC_FMT ",\n"
+        "    \"denoised\": %s,\n"
+        "    \"time_budget_ms\": " I64_DEC_FMT ",\n"
+        "    \"requested_spp\": %zu,\n"
+        "    \"completed_spp\": %zu,\n"
+        "    \"passes\": %zu,\n"
+        "    \"samples\": " U64_DEC_FMT ",\n"
+        "    \"elapsed_ms\": " I64_DEC_FMT "\n"
+        "}\n",
+        opts->res_w,
+        opts->res_h,
+        opts->max_ray_depth,
+        opts->seed,
+        opts->denoise ? "true" : "false",
+        (i64)(opts->budget_s * 1000.0f),
+        opts->samples_per_pixel,
+        stats->spp,
+        stats->passes,
+        stats->samples,
+        elapsed_ms);
+
+    fclose(fd);
+    return true;
+}
+
+// Frames the scene bounds from the same direction main.c looks at its scenes from
+intern Camera* Batch_Camera(Scene* scene, size_t res_w, size_t res_h)
+{
+    BoundingBox bounds = Scene_Get_Bounds(scene);
+
+    point3 center   = vmul(vadd(bounds.min, bounds.max), 0.5f);
+    f32    radius   = vmag(vsub(bounds.max, bounds.min)) * 0.5f;
+    point3 lookFrom = vadd(center, vmul(vnorm(((vec3){1, -1, 1})), radius * 3.0f));
+    vec3   vup      = (vec3){0, 0, 1};
+
+    return Camera_New(lookFrom, center, vup, (f32)res_w / (f32)res_h, 40.0f, 0.0f, radius * 3.0f);
+}
+
+// Uses the animation's camera if it has one, otherwise frames the scene
+intern Camera* Batch_FrameCamera(Scene* scene, AnimationFrame* pose, size_t res_w, size_t res_h)
+{
+    if (!pose->has_camera) {
+        return Batch_Camera(scene, res_w, res_h);
+    }
+
+    f32  focus_dist = vmag(vsub(pose->look_to, pose->look_from));
+    vec3 vup        = (vec3){0, 0, 1};
+
+    return Camera_New(pose->look_from, pose->look_to, vup, (f32)res_w / (f32)res_h, pose->vfov, 0.0f, focus_dist);
+}
+
+intern void Batch_Configure(RenderCtx* ctx, BatchOptions* opts)
+{
+    Render_Set_TileSize(ctx, opts->tile_size, opts->tile_size);
+    Render_Set_Mode(ctx, opts->mode);
+    Render_Set_RaySorting(ctx, opts->sort_rays);
+    Render_Set_Sampler(ctx, opts->sampler);
+    Render_Set_Seed(ctx, opts->seed);
+    Render_Set_Denoise(ctx, opts->denoise);
+    Render_Set_AOVs(ctx, opts->aovs_path != NULL);
+    Render_Set_Adaptive(ctx, RENDER_ADAPTIVE_MIN_SPP, RENDER_ADAPTIVE_STEP_SPP, opts->adaptive_error);
+    Render_Set_TimeBudget(ctx, (i64)(opts->budget_s * 1000.0f), RENDER_BUDGET_PASS_SPP);
+    Render_Set_Checkpoint(ctx, opts->checkpoint_path, (i64)(opts->checkpoint_interval_s * 1000.0f));
+    Render_Set_Region(ctx, opts->regions, opts->num_regions);
+    Render_Set_Threads(ctx, opts->num_threads);
+    Render_Set_Numa(ctx, opts->numa);
+}
+
+intern void Batch_PrintSettings(BatchOptions* opts)
+{
+    printf(
+        "%zux%zu, %zu spp, %zu bounces, %zu threads, %s\n",
+        opts->res_w,
+        opts->res_h,
+        opts->samples_per_pixel,
+        opts->max_ray_depth,
+        opts->num_threads,
+        opts->scene_path);
+
+    if (opts->numa) {
+        printf("Spreading the threads over %zu NUMA nodes\n", MIN(Numa_NodeCount(), (size_t)NUMA_MAX_NODES));
+    }
+}
+
+// The image the render is written into, the regions of a render with --base are composited over that image
+intern ImageRGB* Batch_Image(BatchOptions* opts)
+{
+    ImageRGB* img = (ImageRGB*)calloc(1, sizeof(ImageRGB));
+    if (img == NULL) {
+        ABORT("Failed to create image buffer");
+    }
+
+    if (opts->base_path == NULL) {
+        if (!ImageRGB_Load_Empty(img, opts->res_w, opts->res_h)) {
+            ABORT("Failed to create image buffer");
+        }
+
+        return img;
+    }
+
+    FILE* fd = fopen(opts->base_path, "rb");
+    if (fd == NULL || !ImageRGB_Load_BMP(img, fd)) {
+        ABORT("Failed to load base image %s", opts->base_path);
+    }
+    fclose(fd);
+
+    if (img->res.width != opts->res_w || img->res.height != opts->res_h) {
+        ABORT(
+            "Base image %s is %zux%zu, not %zux%zu",
+            opts->base_path,
+            img->res.width,
+            img->res.height,
+            opts->res_w,
+            opts->res_h);
+    }
+
+    return img;
+}
+
+// Writes the finished render's float beauty and AOVs (see Render_Read_AOVs) to one multi-channel OpenEXR
+intern bool Batch_ExportAOVs(RenderCtx* ctx, const char* path)
+{
+    size_t num_pixels = ctx->img->res.width * ctx->img->res.height;
+
+    f32* data = (f32*)malloc(NUM_RENDER_AOVS * num_pixels * sizeof(f32));
+    if (data == NULL) {
+        ABORT("Failed to allocate AOV buffers");
+    }
+
+    f32*         planes[NUM_RENDER_AOVS];
+    ImageChannel channels[NUM_RENDER_AOVS];
+
+    for (size_t ii = 0; ii < NUM_RENDER_AOVS; ii++) {
+        planes[ii]   = &data[ii * num_pixels];
+        channels[ii] = (ImageChannel){.name = Render_AOV_Name((RenderAOV)ii), .data = planes[ii]};
+    }
+
+    Render_Read_AOVs(ctx, planes);
+
+    FILE* fd = fopen(path, "wb");
+    if (fd == NULL) {
+        printf("Failed to export AOVs: Cannot open %s\n", path);
+        free(data);
+        return false;
+    }
+
+    bool saved = Image_Save_EXR(ctx->img->res.width, ctx->img->res.height, channels, NUM_RENDER_AOVS, fd);
+    fclose(fd);
+    free(data);
+
+    if (saved) {
+        printf("Exported AOVs to %s\n", path);
+    }
+
+    return saved;
+}
+
+// Renders the job on this machine, waking up to check for SIGINT until it's done
+intern bool Batch_Render(RenderCtx* ctx, ImageRGB* img, BatchOptions* opts, Stopwatch* sw)
+{
+    printf("Starting :: Render\n");
+    Stopwatch_Start(sw);
+
+    if (opts->resume_path == NULL) {
+        Render_Start(ctx, opts->samples_per_pixel, opts->max_ray_depth);
+    } else if (Render_Resume(ctx, opts->resume_path)) {
+        printf("Resumed from %s at %zu spp\n", opts->resume_path, ctx->stats.spp);
+    } else {
+        ABORT("Failed to resume from %s", opts->resume_path);
+    }
+
+    // the workers do all the rendering, the main thread only wakes up to check for SIGINT
+    while (!Render_Done(ctx) && !g_interrupted) {
+        SleepMS(100);
+    }
+
+    // the render threads are still busy, cleaning up would wait for them to finish the job, so exit from here
+    if (g_interrupted) {
+        printf("\nExporting partial image to disk\n");
+        exit(ExportImage(img, opts->out_path) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    Stopwatch_Stop(sw);
+
+    i64 elapsed_ms = Stopwatch_Elapsed(sw, STOPWATCH_MILISECONDS);
+    printf(
+        "Finished :: Render :: (" I64_DEC_FMT "%s)\n",
+        elapsed_ms,
+        STOPWATCH_TIMESCALE_UNIT(STOPWATCH_MILISECONDS));
+
+    u64 uniform_samples = (u64)opts->res_w * opts->res_h * opts->samples_per_pixel;
+    printf(
+        U64_DEC_FMT " samples in %zu passes, %zu spp (%.1f%% of uniform sampling)\n",
+        ctx->stats.samples,
+        ctx->stats.passes,
+        ctx->stats.spp,
+        100.0 * ctx->stats.samples / (f64)uniform_samples);
+
+    return ExportImage(img, opts->out_path) && (opts->aovs_path == NULL || Batch_ExportAOVs(ctx, opts->aovs_path))
+           && Batch_WriteMetadata(opts->out_path, opts, &ctx->stats, elapsed_ms);
+}
+
+// image.bmp -> image_0042.bmp
+intern void Batch_FramePath(const char* out_path, size_t frame, char* path, size_t path_size)
+{
+    const char* ext      = strrchr(out_path, '.');
+    int         stem_len = ext && !strpbrk(ext, "/\\") ? (int)(ext - out_path) : (int)strlen(out_path);
+
+    snprintf(path, path_size, "%.*s_%04zu%s", stem_len, out_path, frame, out_path + stem_len);
+}
+
+// Scene setup for one frame, run on its own thread so it overlaps with the render of the frame before
+typedef struct {
+    Mesh*          mesh;
+    Skybox*        skybox;
+    AnimationFrame pose;
+    Scene*         scene;
+} FramePrep;
+
+intern void Batch_PrepareFrame(void* arg)
+{
+    FramePrep* prep = (FramePrep*)arg;
+
+    Mesh_Set_Origin(prep->mesh, prep->pose.origin);
+    Mesh_Set_Rotation(prep->mesh, prep->pose.rotation_axis, prep->pose.rotation);
+    Mesh_Set_Scale(prep->mesh, prep->pose.scale);
+
+    prep->scene = Batch_Scene(prep->mesh, prep->skybox);
+}
+
+// Renders every frame of the animation, the mesh, textures and skybox are only loaded once, frame N+1's scene
+// (kd-tree and light sampler) is built on another thread while frame N renders, and frame N is written to disk while
+// frame N+1 renders (the two frames alternate between two images)
+intern bool Batch_Animate(BatchOptions* opts, Animation* anim, Mesh* mesh, Skybox* skybox, Stopwatch* sw)
+{
+    size_t    num_frames = Animation_NumFrames(anim);
+    ImageRGB* imgs[2];
+    bool      exported = true;
+
+    for (size_t ii = 0; ii < 2; ii++) {
+        imgs[ii] = Batch_Image(opts);
+    }
+
+    // the first frame has nothing to overlap with
+    FramePrep prep = {.mesh = mesh, .skybox = skybox, .pose = Animation_At(anim, 0), .scene = NULL};
+    Batch_PrepareFrame(&prep);
+
+    Scene*  scene = prep.scene;
+    Camera* cam   = Batch_FrameCamera(scene, &prep.pose, opts->res_w, opts->res_h);
+
+    RenderCtx* ctx = Render_New(scene, imgs[0], cam);
+    if (ctx == NULL || cam == NULL) {
+        ABORT("Failed to create render context");
+    }
+
+    Batch_Configure(ctx, opts);
+    Batch_PrintSettings(opts);
+    printf("Starting :: Animation :: (%zu frames)\n", num_frames);
+
+    Stopwatch_Start(sw);
+    Render_Start(ctx, opts->samples_per_pixel, opts->max_ray_depth);
+
+    i64 frame_start_ms = 0;
+
+    for (size_t frame = 0; frame < num_frames; frame++) {
+        bool    has_next    = frame + 1 < num_frames;
+        Thread* prep_thread = NULL;
+
+        if (has_next) {
+            prep.pose   = Animation_At(anim, frame + 1);
+            prep_thread = Thread_New();
+
+            if (prep_thread == NULL || !Thread_Spawn(prep_thread, Batch_PrepareFrame, &prep)) {
+                ABORT("Failed to start scene preparation thread");
+            }
+        }
+
+        while (!Render_Done(ctx) && !g_interrupted) {
+            SleepMS(100);
+        }
+
+        char path[4096];
+        Batch_FramePath(opts->out_path, frame, path, sizeof(path));
+
+        // the render threads are still busy, cleaning up would wait for them to finish the frame, so exit from here
+        if (g_interrupted) {
+            printf("\nExporting partial frame to disk\n");
+            exit(ExportImage(imgs[frame % 2], path) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        Stopwatch_Stop(sw);
+        i64         elapsed_ms = Stopwatch_Elapsed(sw, STOPWATCH_MILISECONDS);
+        RenderStats stats      = ctx->stats;
+        Scene*      done_scene = scene;
+        Camera*     done_cam   = cam;
+
+        printf(
+            "Finished :: Frame %zu/%zu :: (" I64_DEC_FMT "ms)\n",
+            frame + 1,
+            num_frames,
+            elapsed_ms - frame_start_ms);
+
+        if (has_next) {
+            Thread_Join(prep_thread);
+            Thread_Delete(prep_thread);
+
+            scene = prep.scene;
+            cam   = Batch_FrameCamera(scene, &prep.pose, opts->res_w, opts->res_h);
+            if (cam == NULL) {
+                ABORT("Failed to create camera");
+            }
+
+            // every frame gets its own seed so the noise doesn't stay fixed to the screen
+            Render_Set_Job(ctx, scene, imgs[(frame + 1) % 2], cam);
+            Render_Set_Seed(ctx, opts->seed + frame + 1);
+            Render_Start(ctx, opts->samples_per_pixel, opts->max_ray_depth);
+        }
+
+        exported = exported && ExportImage(imgs[frame % 2], path)
+                   && Batch_WriteMetadata(path, opts, &stats, elapsed_ms - frame_start_ms);
+
+        Scene_Delete(done_scene);
+        free(done_cam);
+
+        frame_start_ms = elapsed_ms;
+    }
+
+    Render_Delete(ctx);
+
+    for (size_t ii = 0; ii < 2; ii++) {
+        ImageRGB_Unload(imgs[ii]);
+        free(imgs[ii]);
+    }
+
+    return exported;
+}
+
+intern bool Batch_LoadJobs(const char* path, Vector(BatchJob) * jobs)
+{
+    FILE* fd = fopen(path, "r");
+    if (fd == NULL) {
+        printf("Couldn't open %s\n", path);
+        return false;
+    }
+
+    char line[2048];
+    bool valid = true;
+
+    while (valid && fgets(line, sizeof(line), fd) != NULL) {
+        BatchJob job;
+        char     material[16];
+
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        valid = sscanf(
+                    line,
+                    "%1023s %f %f %f %f %f %f %f %15s %f %f %f %f",
+                    job.out_path,
+                    &job.look_from.x,
+                    &job.look_from.y,
+                    &job.look_from.z,
+                    &job.look_to.x,
+                    &job.look_to.y,
+                    &job.look_to.z,
+                    &job.vfov,
+                    material,
+                    &job.albedo.r,
+                    &job.albedo.g,
+                    &job.albedo.b,
+                    &job.roughness)
+                == 13;
+
+        if (valid && strcmp(material, "diffuse") == 0) {
+            job.material = JOB_MATERIAL_DIFFUSE;
+        } else if (valid && strcmp(material, "metal") == 0) {
+            job.material = JOB_MATERIAL_METAL;
+        } else if (valid && strcmp(material, "glass") == 0) {
+            job.material = JOB_MATERIAL_GLASS;
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            printf("Invalid job: %s", line);
+        } else if (!Vector_Push(jobs, job)) {
+            ABORT("Failed to allocate jobs");
+        }
+    }
+
+    fclose(fd);
+    return valid;
+}
+
+intern Material Batch_JobMaterial(BatchJob* job, Texture* albedo)
+{
+    switch (job->material) {
+        case JOB_MATERIAL_DIFFUSE: {
+            return Material_Disney_Diffuse_Make(albedo, job->roughness, 0.0f);
+        } break;
+
+        case JOB_MATERIAL_METAL: {
+            return Material_Disney_Metal_Make(albedo, job->roughness, 0.0f);
+        } break;
+
+        case JOB_MATERIAL_GLASS: {
+            return Material_Disney_Glass_Make(albedo, job->roughness, 0.0f, 1.5f);
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+// Jobs are claimed through a shared cursor, every other bit of state belongs to one thread
+typedef struct {
+    BatchOptions* opts;
+    Scene*        scene;
+    Material*     material; // the mesh's material, which every job overrides
+    BatchJob*     jobs;
+    size_t        num_jobs;
+    size_t        next;
+    size_t        num_failed;
+} JobQueue;
+
+// Renders whole jobs on this thread with a render context of its own (see Render_Now) until the queue runs dry
+intern void Batch_JobWorker(void* arg)
+{
+    JobQueue*     queue = (JobQueue*)arg;
+    BatchOptions* opts  = queue->opts;
+    ImageRGB      img;
+
+    if (!ImageRGB_Load_Empty(&img, opts->res_w, opts->res_h)) {
+        ABORT("Failed to create image buffer");
+    }
+
+    RenderCtx* ctx = Render_New(queue->scene, &img, NULL);
+    if (ctx == NULL) {
+        ABORT("Failed to create render context");
+    }
+
+    Batch_Configure(ctx, opts);
+
+    while (!g_interrupted) {
+        size_t index = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (index >= queue->num_jobs) {
+            break;
+        }
+
+        BatchJob* job    = &queue->jobs[index];
+        Texture*  albedo = Texture_New();
+        if (albedo == NULL || !Texture_Import_Color(albedo, job->albedo)) {
+            ABORT("Failed to create texture");
+        }
+
+        Material         material = Batch_JobMaterial(job, albedo);
+        MaterialOverride override = {.original = queue->material, .replacement = &material};
+
+        f32     focus_dist = vmag(vsub(job->look_to, job->look_from));
+        f32     aspect     = (f32)opts->res_w / (f32)opts->res_h;
+        Camera* cam = Camera_New(job->look_from, job->look_to, (vec3){0, 0, 1}, aspect, job->vfov, 0.0f, focus_dist);
+        if (cam == NULL) {
+            ABORT("Failed to create camera");
+        }
+
+        Render_Set_Job(ctx, queue->scene, &img, cam);
+        Render_Set_MaterialOverrides(ctx, &override, 1);
+        Render_Now(ctx, opts->samples_per_pixel, opts->max_ray_depth);
+
+        if (!ExportImage(&img, job->out_path)) {
+            __atomic_fetch_add(&queue->num_failed, 1, __ATOMIC_RELAXED);
+        }
+
+        free(cam);
+        Texture_Delete(albedo);
+    }
+
+    Render_Delete(ctx);
+    ImageRGB_Unload(&img);
+}
+
+// Renders every job in the file against one shared scene, a thread per core each rendering whole images, since for
+// small images splitting one image across threads costs more in synchronization than it gains
+intern bool Batch_RunJobs(BatchOptions* opts, Scene* scene, Material* material, Stopwatch* sw)
+{
+    Vector(BatchJob) jobs;
+    if (!Vector_Init(&jobs, Vector_Default_Capacity)) {
+        ABORT("Failed to allocate jobs");
+    }
+
+    if (!Batch_LoadJobs(opts->jobs_path, &jobs)) {
+        Vector_Uninit(&jobs);
+        return false;
+    }
+
+    JobQueue queue = {
+        .opts       = opts,
+        .scene      = scene,
+        .material   = material,
+        .jobs       = jobs.at,
+        .num_jobs   = jobs.length,
+        .next       = 0,
+        .num_failed = 0,
+    };
+
+    size_t   num_threads = MIN(opts->num_threads, jobs.length);
+    Thread** threads     = (Thread**)calloc(num_threads, sizeof(Thread*));
+    if (num_threads > 0 && threads == NULL) {
+        ABORT("Failed to allocate job threads");
+    }
+
+    Batch_PrintSettings(opts);
+    printf("Starting :: Jobs :: (%zu images)\n", jobs.length);
+    Stopwatch_Start(sw);
+
+    for (size_t ii = 0; ii < num_threads; ii++) {
+        threads[ii] = Thread_New();
+        if (threads[ii] == NULL || !Thread_Spawn(threads[ii], Batch_JobWorker, &queue)) {
+            ABORT("Failed to start job thread");
+        }
+    }
+
+    for (size_t ii = 0; ii < num_threads; ii++) {
+        Thread_Join(threads[ii]);
+        Thread_Delete(threads[ii]);
+    }
+
+    Stopwatch_Stop(sw);
+
+    i64    elapsed_ms = Stopwatch_Elapsed(sw, STOPWATCH_MILISECONDS);
+    size_t num_done   = MIN(queue.next, queue.num_jobs);
+    printf(
+        "Finished :: Jobs :: (" I64_DEC_FMT "ms, %zu images, %.1f images/s)\n",
+        elapsed_ms,
+        num_done,
+        1000.0 * (f64)num_done / (f64)MAX(elapsed_ms, (i64)1));
+
+    bool succeeded = queue.num_failed == 0 && num_done == queue.num_jobs;
+
+    free(threads);
+    Vector_Uninit(&jobs);
+
+    return succeeded;
+}
+
+// Coordinates a distributed render of the options' job, the coordinator never loads the scene, only the workers do
+intern bool Batch_Serve(BatchOptions* opts, Stopwatch* sw)
+{
+    DistJob job = {
+        .res_w             = (u32)opts->res_w,
+        .res_h             = (u32)opts->res_h,
+        .samples_per_pixel = (u32)opts->samples_per_pixel,
+        .max_ray_depth     = (u32)opts->max_ray_depth,
+        .mode              = (u32)opts->mode,
+        .sort_rays         = opts->sort_rays,
+        .sampler           = (u32)opts->sampler,
+        .seed              = opts->seed,
+        .scene_path        = {0},
+        .envmap_path       = {0},
+    };
+
+    const char* envmap_path = opts->envmap_path ? opts->envmap_path : "";
+    if (strlen(opts->scene_path) >= DIST_PATH_MAX || strlen(envmap_path) >= DIST_PATH_MAX) {
+        printf("Scene and envmap paths must be shorter than %d characters\n", DIST_PATH_MAX);
+        return false;
+    }
+
+    strcpy(job.scene_path, opts->scene_path);
+    strcpy(job.envmap_path, envmap_path);
+
+    ImageRGB* img = (ImageRGB*)calloc(1, sizeof(ImageRGB));
+    if (img == NULL || !ImageRGB_Load_Empty(img, opts->res_w, opts->res_h)) {
+        ABORT("Failed to create image buffer");
+    }
+
+    printf("Starting :: Distributed Render\n");
+    Stopwatch_Start(sw);
+
+    RenderStats stats;
+    bool        finished = Dist_Coordinate(&job, opts->serve_port, img, &stats, &g_interrupted);
+
+    Stopwatch_Stop(sw);
+    i64 elapsed_ms = Stopwatch_Elapsed(sw, STOPWATCH_MILISECONDS);
+
+    bool exported = false;
+    if (finished) {
+        printf(
+            "Finished :: Distributed Render :: (" I64_DEC_FMT "%s)\n",
+            elapsed_ms,
+            STOPWATCH_TIMESCALE_UNIT(STOPWATCH_MILISECONDS));
+
+        exported = ExportImage(img, opts->out_path) && Batch_WriteMetadata(opts->out_path, opts, &stats, elapsed_ms);
+    } else if (g_interrupted) {
+        printf("\nExporting partial image to disk\n");
+        exported = ExportImage(img, opts->out_path);
+    }
+
+    ImageRGB_Unload(img);
+    free(img);
+
+    return exported;
+}
+
+int main(int argc, char** argv)
+{
+    BatchOptions opts = {
+        .res_w             = 1280,
+        .res_h             = 720,
+        .samples_per_pixel = 32,
+        .max_ray_depth     = 8,
+        .num_threads       = NUM_HYPERTHREADS,
+        .numa              = false,
+        .tile_size         = RENDER_TILE_W_PX,
+        .adaptive_error    = 0.0f,
+        .budget_s          = 0.0f,
+        .spp_given         = false,
+        .mode              = RENDER_MODE_PATH,
+        .sort_rays         = false,
+        .sampler           = SAMPLER_SOBOL,
+        .seed              = RENDER_DEFAULT_SEED,
+        .denoise           = false,
+        .scene_path        = "assets/little_dragon.obj",
+        .envmap_path       = NULL,
+        .out_path          = "output.bmp",
+        .aovs_path         = NULL,
+
+        .checkpoint_path       = NULL,
+        .checkpoint_interval_s = 600.0f,
+        .resume_path           = NULL,
+
+        .regions     = {},
+        .num_regions = 0,
+        .base_path   = NULL,
+
+        .animation_path = NULL,
+        .jobs_path      = NULL,
+
+        .serve_port   = 0,
+        .connect_host = {0},
+        .connect_port = 0,
+    };
+
+    if (!Batch_ParseArgs(argc, argv, &opts)) {
+        Batch_Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // a time budget decides the sample count, spp is only a cap then
+    if (opts.budget_s > 0.0f && !opts.spp_given) {
+        opts.samples_per_pixel = 65536;
+    }
+
+    Stopwatch* sw = Stopwatch_New();
+    if (sw == NULL) {
+        ABORT("Failed to create stopwatch");
+    }
+
+    signal(SIGINT, InterruptHandler);
+
+    if (opts.serve_port != 0) {
+        bool served = Batch_Serve(&opts, sw);
+        Stopwatch_Delete(sw);
+
+        return served ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // a worker renders whatever the coordinator asks for, its own options only pick the threads and tile size
+    DistJob     job;
+    DistWorker* worker = NULL;
+
+    if (opts.connect_port != 0) {
+        worker = Dist_Connect(opts.connect_host, opts.connect_port, &job);
+        if (worker == NULL) {
+            ABORT("Failed to join the render served at %s:%u", opts.connect_host, (unsigned)opts.connect_port);
+        }
+
+        opts.res_w             = job.res_w;
+        opts.res_h             = job.res_h;
+        opts.samples_per_pixel = job.samples_per_pixel;
+        opts.max_ray_depth     = job.max_ray_depth;
+        opts.scene_path        = job.scene_path;
+        opts.envmap_path       = job.envmap_path[0] ? job.envmap_path : NULL;
+    }
+
+    Skybox* skybox = opts.envmap_path ? Skybox_Import_HDR(opts.envmap_path) : Skybox_Import_BMP("assets/skybox2");
+    if (skybox == NULL) {
+        ABORT("Failed to load skybox");
+    }
+
+    Texture* albedo = Texture_New();
+    if (albedo == NULL || !Texture_Import_Color(albedo, COLOR_GREY)) {
+        ABORT("Failed to create texture");
+    }
+    Material material = Material_Disney_Diffuse_Make(albedo, 0.5f, 0.0f);
+
+    Mesh* mesh;
+    TIMEIT(sw, STOPWATCH_MILISECONDS, "Mesh load", mesh = Batch_Mesh(opts.scene_path, &material));
+
+    if (opts.animation_path != NULL) {
+        FILE* fd = fopen(opts.animation_path, "r");
+        if (fd == NULL) {
+            ABORT("Couldn't open %s", opts.animation_path);
+        }
+
+        Animation* anim = Animation_Load(fd);
+        if (anim == NULL) {
+            ABORT("Failed to load animation %s", opts.animation_path);
+        }
+        fclose(fd);
+
+        bool animated = Batch_Animate(&opts, anim, mesh, skybox, sw);
+
+        Animation_Delete(anim);
+        Mesh_Delete(mesh);
+        Texture_Delete(albedo);
+        Skybox_Delete(skybox);
+        free(skybox);
+        Stopwatch_Delete(sw);
+
+        return animated ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Scene* scene;
+    TIMEIT(sw, STOPWATCH_MILISECONDS, "Scene build", scene = Batch_Scene(mesh, skybox));
+    Mesh_Delete(mesh);
+
+    if (opts.jobs_path != NULL) {
+        bool ran = Batch_RunJobs(&opts, scene, &material, sw);
+
+        Scene_Delete(scene);
+        Texture_Delete(albedo);
+        Skybox_Delete(skybox);
+        free(skybox);
+        Stopwatch_Delete(sw);
+
+        return ran ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Camera* cam = Batch_Camera(scene, opts.res_w, opts.res_h);
+    if (cam == NULL) {
+        ABORT("Failed to create camera");
+    }
+
+    ImageRGB* img = Batch_Image(&opts);
+
+    RenderCtx* ctx = Render_New(scene, img, cam);
+    if (ctx == NULL) {
+        ABORT("Failed to create render context");
+    }
+
+    Batch_Configure(ctx, &opts);
+    Batch_PrintSettings(&opts);
+
+    bool succeeded;
+    if (worker != NULL) {
+        printf("Joined the render served at %s:%u\n", opts.connect_host, (unsigned)opts.connect_port);
+        succeeded = Dist_Work(worker, ctx, &g_interrupted);
+        Dist_Disconnect(worker);
+    } else {
+        succeeded = Batch_Render(ctx, img, &opts, sw);
+    }
+
+    Render_Delete(ctx);
+    Scene_Delete(scene);
+    Texture_Delete(albedo);
+    Skybox_Delete(skybox);
+    free(skybox);
+    free(cam);
+    ImageRGB_Unload(img);
+    free(img);
+    Stopwatch_Delete(sw);
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
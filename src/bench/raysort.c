@@ -0,0 +1,242 @@
+// Benchmark for secondary ray sorting in the wavefront tracer
+// Renders each mesh on a single thread twice, with and without ray sorting, and reports the time and hardware cache
+// miss rate of the secondary rays' intersect stages (the kd-tree traversal sorting is meant to speed up), then what the
+// sorts themselves cost, shading and shadow rays are left out of the measurement
+//
+// usage: ./bin/rtbench.out [mesh.obj ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gfx/mesh.h"
+#include "gfx/texture.h"
+#include "math/random.h"
+#include "math/vec.h"
+#include "platform/profiling.h"
+#include "rt/wavefront.h"
+#include "world/camera.h"
+#include "world/scene.h"
+
+#define BENCH_RES_W      (320)
+#define BENCH_RES_H      (240)
+#define BENCH_TILE_PX    (16)
+#define BENCH_SPP        (8)
+#define BENCH_RAY_DEPTH  (6)
+#define BENCH_BATCH_SIZE (RENDER_WAVEFRONT_BATCH_SIZE)
+
+typedef struct {
+    WavefrontStageProfile intersect;
+    WavefrontStageProfile sort;
+    f64                   mean_luminance;
+} BenchResult;
+
+intern Skybox* Bench_Skybox(void)
+{
+    Skybox* skybox = (Skybox*)calloc(1, sizeof(Skybox));
+    if (skybox == NULL) {
+        ABORT("Failed to create skybox");
+    }
+
+    for (size_t ii = 0; ii < lengthof(skybox->tex); ii++) {
+        skybox->tex[ii] = Texture_New();
+        if (skybox->tex[ii] == NULL || !Texture_Import_Color(skybox->tex[ii], COLOR_WHITE)) {
+            ABORT("Failed to create skybox texture");
+        }
+    }
+
+    return skybox;
+}
+
+intern Scene* Bench_Scene(const char* mesh_path, Skybox* skybox, Material* material)
+{
+    FILE* fd = fopen(mesh_path, "r");
+    if (fd == NULL) {
+        return NULL;
+    }
+
+    Mesh* mesh = Mesh_New();
+    if (mesh == NULL || !Mesh_Import_OBJ(mesh, fd)) {
+        ABORT("Failed to import %s", mesh_path);
+    }
+    fclose(fd);
+
+    Scene* scene = Scene_New(skybox);
+    if (scene == NULL) {
+        ABORT("Failed to create scene");
+    }
+
+    Mesh_Set_Material(mesh, material);
+    Mesh_AddToScene(mesh, scene);
+    Mesh_Delete(mesh);
+
+    Scene_Prepare(scene);
+    return scene;
+}
+
+// Frames the scene bounds from the same direction main.c looks at its scenes from
+intern Camera* Bench_Camera(Scene* scene)
+{
+    BoundingBox bounds = Scene_Get_Bounds(scene);
+
+    point3 center   = vmul(vadd(bounds.min, bounds.max), 0.5f);
+    f32    radius   = vmag(vsub(bounds.max, bounds.min)) * 0.5f;
+    point3 lookFrom = vadd(center, vmul(vnorm(((vec3){1, -1, 1})), radius * 3.0f));
+    vec3   vup      = (vec3){0, 0, 1};
+
+    return Camera_New(lookFrom, center, vup, (f32)BENCH_RES_W / BENCH_RES_H, 40.0f, 0.0f, radius * 3.0f);
+}
+
+intern BenchResult Bench_Run(Scene* scene, Camera* cam, Wavefront* wf, PerfCounter* perf, bool sort_rays)
+{
+    Ray*   rays     = (Ray*)malloc(BENCH_BATCH_SIZE * sizeof(Ray));
+    Color* radiance = (Color*)malloc(BENCH_BATCH_SIZE * sizeof(Color));
+    if (rays == NULL || radiance == NULL) {
+        ABORT("Failed to allocate ray buffers");
+    }
+
+    Stopwatch* sw = Stopwatch_New();
+    if (sw == NULL) {
+        ABORT("Failed to create stopwatch");
+    }
+
+    WavefrontProfile profile = {
+        .counter   = perf,
+        .clock     = sw,
+        .intersect = {.elapsed_us = 0, .counts = {0, 0}},
+        .sort      = {.elapsed_us = 0, .counts = {0, 0}},
+    };
+
+    // same samples for both runs
+    Random_Seed(0x5EED5EED5EED5EEDull, 0x0123456789ABCDEFull);
+    Wavefront_Set_RaySorting(wf, sort_rays);
+    Wavefront_Set_Profile(wf, &profile);
+
+    f64 luminance = 0.0;
+
+    for (size_t ty = 0; ty < BENCH_RES_H; ty += BENCH_TILE_PX) {
+        for (size_t tx = 0; tx < BENCH_RES_W; tx += BENCH_TILE_PX) {
+            size_t num_rays = 0;
+
+            for (size_t yy = ty; yy < ty + BENCH_TILE_PX; yy++) {
+                for (size_t xx = tx; xx < tx + BENCH_TILE_PX; xx++) {
+                    for (size_t ss = 0; ss < BENCH_SPP; ss++) {
+                        f32 horizontal_fraction = (xx + Random_Unilateral()) / (f32)(BENCH_RES_W - 1);
+                        f32 vertical_fraction   = (yy + Random_Unilateral()) / (f32)(BENCH_RES_H - 1);
+
+                        rays[num_rays++] = Camera_GetRay(cam, horizontal_fraction, vertical_fraction);
+                    }
+                }
+            }
+
+            Wavefront_Trace(wf, scene, NULL, rays, radiance, NULL, num_rays, BENCH_RAY_DEPTH);
+
+            for (size_t ii = 0; ii < num_rays; ii++) {
+                luminance += Color_Luminance(radiance[ii]);
+            }
+        }
+    }
+
+    Wavefront_Set_Profile(wf, NULL);
+
+    BenchResult result = {
+        .intersect      = profile.intersect,
+        .sort           = profile.sort,
+        .mean_luminance = luminance / ((f64)BENCH_RES_W * BENCH_RES_H * BENCH_SPP),
+    };
+
+    Stopwatch_Delete(sw);
+    free(radiance);
+    free(rays);
+
+    return result;
+}
+
+intern void Bench_Print(const char* desc, WavefrontStageProfile* stage)
+{
+    f64 miss_rate = stage->counts.cache_references
+                        ? 100.0 * stage->counts.cache_misses / (f64)stage->counts.cache_references
+                        : 0.0;
+
+    printf(
+        "  %-18s " I64_DEC_FMT " ms, " U64_DEC_FMT " cache refs, " U64_DEC_FMT " misses (%.2f%%)\n",
+        desc,
+        stage->elapsed_us / 1000,
+        stage->counts.cache_references,
+        stage->counts.cache_misses,
+        miss_rate);
+}
+
+int main(int argc, char** argv)
+{
+    static const char* default_meshes[] = {"assets/bunny.obj", "assets/little_dragon.obj"};
+
+    const char** meshes     = default_meshes;
+    size_t       num_meshes = lengthof(default_meshes);
+
+    if (argc > 1) {
+        meshes     = (const char**)&argv[1];
+        num_meshes = (size_t)argc - 1;
+    }
+
+    PerfCounter* perf = PerfCounter_New();
+    if (perf == NULL) {
+        printf("Hardware cache counters unavailable, only reporting time\n");
+    }
+
+    Wavefront* wf = Wavefront_New(BENCH_BATCH_SIZE);
+    if (wf == NULL) {
+        ABORT("Failed to create wavefront");
+    }
+
+    Skybox* skybox = Bench_Skybox();
+
+    Texture* albedo = Texture_New();
+    if (albedo == NULL || !Texture_Import_Color(albedo, COLOR_GREY)) {
+        ABORT("Failed to create texture");
+    }
+    Material material = Material_Disney_Diffuse_Make(albedo, 0.5f, 0.0f);
+
+    printf(
+        "%dx%d, %d spp, %d bounces, %d paths per batch\n\n",
+        BENCH_RES_W,
+        BENCH_RES_H,
+        BENCH_SPP,
+        BENCH_RAY_DEPTH,
+        BENCH_BATCH_SIZE);
+
+    for (size_t ii = 0; ii < num_meshes; ii++) {
+        Scene* scene = Bench_Scene(meshes[ii], skybox, &material);
+        if (scene == NULL) {
+            printf("%s: couldn't open, skipping\n\n", meshes[ii]);
+            continue;
+        }
+
+        Camera* cam = Bench_Camera(scene);
+        if (cam == NULL) {
+            ABORT("Failed to create camera");
+        }
+
+        BenchResult unsorted = Bench_Run(scene, cam, wf, perf, false);
+        BenchResult sorted   = Bench_Run(scene, cam, wf, perf, true);
+
+        printf("%s:\n", meshes[ii]);
+        Bench_Print("unsorted intersect", &unsorted.intersect);
+        Bench_Print("sorted intersect", &sorted.intersect);
+        Bench_Print("sort", &sorted.sort);
+        printf("  mean luminance %.4f unsorted, %.4f sorted\n\n", unsorted.mean_luminance, sorted.mean_luminance);
+
+        free(cam);
+        Scene_Delete(scene);
+    }
+
+    Texture_Delete(albedo);
+    Skybox_Delete(skybox);
+    free(skybox);
+    Wavefront_Delete(wf);
+
+    if (perf) {
+        PerfCounter_Delete(perf);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -5,9 +5,77 @@
 // FPS the render preview window updates at
 #define RENDER_FPS (5)
 
-// The tile size for a render work unit in pixels (tiles are square)
-#define RENDER_TILE_W_PX (2)
-#define RENDER_TILE_H_PX (2)
+// Resolution divisor of the first pass of a render in the preview window, which is restarted whenever the camera moves
+#define PREVIEW_SCALE (8)
+
+// Preview window camera controls: distance moved per key press, radians turned per pixel dragged
+#define PREVIEW_MOVE_STEP (1.0f)
+#define PREVIEW_TURN_RATE (0.005f)
+
+// The default tile size for a render work unit in pixels (can be changed at runtime with Render_Set_TileSize)
+#define RENDER_TILE_W_PX (16)
+#define RENDER_TILE_H_PX (16)
+
+// Adaptive sampling defaults: samples every pixel gets in the base pass, and samples added per later pass to tiles
+// still above the error threshold (see Render_Set_Adaptive)
+#define RENDER_ADAPTIVE_MIN_SPP  (16)
+#define RENDER_ADAPTIVE_STEP_SPP (16)
+
+// Time budgeted rendering defaults: samples per pixel in each pass over the frame (see Render_Set_TimeBudget), and
+// the factor the estimated cost of the next pass is padded by before checking it still fits in the budget
+#define RENDER_BUDGET_PASS_SPP (4)
+#define RENDER_BUDGET_MARGIN   (1.1)
+
+// Samples per pixel in each pass of a checkpointed render, checkpoints are only written between passes (see
+// Render_Set_Checkpoint)
+#define RENDER_CHECKPOINT_PASS_SPP (8)
+
+// Most samples per pixel in a pass of a progressive render, passes double in spp up to it (see Render_Set_Progressive)
+#define RENDER_PROGRESSIVE_MAX_PASS_SPP (16)
+
+// Most rectangles a render can be restricted to (see Render_Set_Region)
+#define RENDER_MAX_REGIONS (16)
+
+// Most material overrides a render can have (see Render_Set_MaterialOverrides)
+#define RENDER_MAX_OVERRIDES (8)
+
+// Luminance below which a pixel's error is measured in absolute rather than relative terms
+#define RENDER_ADAPTIVE_LUMINANCE_FLOOR (0.05f)
+
+// Seed renders start with (can be changed at runtime with Render_Set_Seed), the same seed gives the same image
+#define RENDER_DEFAULT_SEED (0x5EED5EED5EED5EEDull)
+
+// Finished tiles that can be waiting for Render_Poll_Tiles before the next poll just gets the whole image, must be a
+// power of 2
+#define RENDER_COMMIT_QUEUE_SIZE (4096)
+
+// A-trous iterations of the denoiser (see rt/denoise.h), each one reaches twice as far as the last, 5 covers a
+// 125x125 pixel footprint
+#define RENDER_DENOISE_ITERATIONS (5)
+
+// Number of paths each render thread keeps in flight in wavefront mode
+#define RENDER_WAVEFRONT_BATCH_SIZE (4096)
+
+/* ---- Distributed Rendering Parameters ---- */
+
+// Samples per pixel in each unit of work the coordinator hands to a worker process (see rt/distributed.h)
+#define DIST_CHUNK_SPP (8)
+
+// Most worker processes a coordinator serves at once, later connections are turned away
+#define DIST_MAX_WORKERS (256)
+
+// How often the coordinator stops waiting for new workers to check if the render is done or cancelled
+#define DIST_ACCEPT_POLL_MS (250)
+
+// A connection that's been silent this long gets probed, and is dropped after a few probes go unanswered, so a peer
+// whose host loses power or drops off the network is noticed even while it's busy rendering
+#define DIST_KEEPALIVE_IDLE_S     (30)
+#define DIST_KEEPALIVE_INTERVAL_S (10)
+#define DIST_KEEPALIVE_PROBES     (3)
+
+// Longest the coordinator waits on a worker's reply to a chunk before giving the chunk to another worker, for worker
+// processes that hang while their host still answers keepalive probes
+#define DIST_REPLY_TIMEOUT_MS (30 * 60 * 1000)
 
 /* ---- Raytracing Parameters ---- */
 
@@ -19,6 +87,9 @@
 // Specifies the size of the host CPU cache line in bytes
 #define SZ_CACHE_LINE (64ull)
 
+// Most NUMA nodes a render spreads its workers over (see Render_Set_Numa), nodes past it are left unused
+#define NUMA_MAX_NODES (8)
+
 // Number of hyperthreads on the CPU (independent threads of execution)
 #define NUM_HYPERTHREADS (16ull)
 
@@ -2,10 +2,12 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gfx/color.h"
 
@@ -56,6 +58,10 @@ typedef struct {
 
 static_assert_decl(sizeof(BMPHeader) == 0x36);
 
+// Radiance HDR scanlines wider than this (or narrower than the minimum) can't be run length encoded
+#define HDR_RLE_MIN_WIDTH (8)
+#define HDR_RLE_MAX_WIDTH (0x7FFF)
+
 intern inline size_t GetPixelIndex(size_t width, size_t height, size_t xx, size_t yy)
 {
     (void)height;
@@ -255,6 +261,13 @@ RGB ImageRGB_GetPixel(ImageRGB* img, size_t xx, size_t yy)
     return img->pix[GetPixelIndex(img->res.width, img->res.height, xx, yy)];
 }
 
+void ImageRGB_SetRect(ImageRGB* img, size_t x, size_t y, size_t w, size_t h, const RGB* pix)
+{
+    for (size_t row = 0; row < h; row++) {
+        memcpy(&img->pix[GetPixelIndex(img->res.width, img->res.height, x, y + row)], &pix[row * w], w * sizeof(RGB));
+    }
+}
+
 /* ---- Linear Colorspace Image ---- */
 
 bool ImageColor_Load_Empty(ImageColor* img, size_t width, size_t height)
@@ -307,3 +320,246 @@ Color ImageColor_GetPixel(ImageColor* img, size_t xx, size_t yy)
 {
     return img->pix[GetPixelIndex(img->res.width, img->res.height, xx, yy)];
 }
+
+// Shared exponent to float, see: https://www.graphics.cornell.edu/~bjw/rgbe.html
+intern inline Color RGBE_ToColor(u8 rgbe[4])
+{
+    if (rgbe[3] == 0) {
+        return COLOR_BLACK;
+    }
+
+    f32 scale = ldexpf(1.0f, (i32)rgbe[3] - (128 + 8));
+    return (Color){.r = rgbe[0] * scale, .g = rgbe[1] * scale, .b = rgbe[2] * scale};
+}
+
+// Reads a scanline of width pixels as RGBE, either flat or with the per channel run length encoding
+intern void HDR_ReadScanline(FILE* fd, u8 (*scanline)[4], size_t width)
+{
+    u8 rgbe[4];
+    if (fread(rgbe, sizeof(rgbe), 1, fd) != 1) {
+        ABORT("Failed to read scanline from HDR");
+    }
+
+    bool encoded = width >= HDR_RLE_MIN_WIDTH && width <= HDR_RLE_MAX_WIDTH && rgbe[0] == 2 && rgbe[1] == 2
+                   && (rgbe[2] & 0x80) == 0;
+
+    if (!encoded) {
+        memcpy(scanline[0], rgbe, sizeof(rgbe));
+        if (fread(scanline[1], sizeof(rgbe), width - 1, fd) != width - 1) {
+            ABORT("Failed to read scanline from HDR");
+        }
+        return;
+    }
+
+    if ((((size_t)rgbe[2] << 8) | rgbe[3]) != width) {
+        ABORT("HDR scanline width doesn't match the image");
+    }
+
+    // each channel is stored separately as runs (count > 128) and literals (count <= 128)
+    for (size_t channel = 0; channel < 4; channel++) {
+        size_t xx = 0;
+
+        while (xx < width) {
+            u8 count;
+            if (fread(&count, 1, 1, fd) != 1) {
+                ABORT("Failed to read run from HDR");
+            }
+
+            bool   run    = count > 128;
+            size_t length = run ? count - 128u : count;
+
+            if (length == 0 || xx + length > width) {
+                ABORT("HDR run overflows the scanline");
+            }
+
+            if (run) {
+                u8 value;
+                if (fread(&value, 1, 1, fd) != 1) {
+                    ABORT("Failed to read run from HDR");
+                }
+
+                for (size_t ii = 0; ii < length; ii++) {
+                    scanline[xx++][channel] = value;
+                }
+            } else {
+                for (size_t ii = 0; ii < length; ii++) {
+                    u8 value;
+                    if (fread(&value, 1, 1, fd) != 1) {
+                        ABORT("Failed to read run from HDR");
+                    }
+
+                    scanline[xx++][channel] = value;
+                }
+            }
+        }
+    }
+}
+
+bool ImageColor_Load_HDR(ImageColor* img, FILE* fd)
+{
+    char line[256];
+
+    if (fgets(line, sizeof(line), fd) == NULL || (strncmp(line, "#?RADIANCE", 10) && strncmp(line, "#?RGBE", 6))) {
+        ABORT("HDR header looks corrupt");
+    }
+
+    // header variables until a blank line, only the pixel format matters
+    while (true) {
+        if (fgets(line, sizeof(line), fd) == NULL) {
+            ABORT("Failed to read header from HDR");
+        }
+
+        if (line[0] == '\n') {
+            break;
+        }
+
+        if (!strncmp(line, "FORMAT=", 7) && strncmp(line, "FORMAT=32-bit_rle_rgbe", 22)) {
+            ABORT("Unsupported HDR pixel format");
+        }
+    }
+
+    // only the standard orientation (rows top to bottom, pixels left to right) is supported
+    size_t width, height;
+    if (fgets(line, sizeof(line), fd) == NULL || sscanf(line, "-Y %zu +X %zu", &height, &width) != 2) {
+        ABORT("Unsupported HDR resolution line");
+    }
+
+    ImageColor tmp_img;
+    if (!ImageColor_Load_Empty(&tmp_img, width, height)) {
+        ABORT("Failed to initialize image");
+    }
+
+    u8(*scanline)[4] = (u8(*)[4])malloc(width * sizeof(*scanline));
+    if (scanline == NULL) {
+        ABORT("Failed to allocate HDR scanline");
+    }
+
+    for (size_t yy = 0; yy < height; yy++) {
+        HDR_ReadScanline(fd, scanline, width);
+
+        for (size_t xx = 0; xx < width; xx++) {
+            ImageColor_SetPixel(&tmp_img, xx, yy, RGBE_ToColor(scanline[xx]));
+        }
+    }
+
+    free(scanline);
+
+    *img = tmp_img;
+    return true;
+}
+
+/* ---- Multi-channel float image ---- */
+
+#define EXR_MAGIC       (20000630)
+#define EXR_VERSION     (2) // single part scanline file
+#define EXR_PIXEL_FLOAT (2)
+
+intern void EXR_WriteAttribute(FILE* fd, const char* name, const char* type, const void* value, u32 size)
+{
+    if (fwrite(name, strlen(name) + 1, 1, fd) != 1 || fwrite(type, strlen(type) + 1, 1, fd) != 1
+        || fwrite(&size, sizeof(size), 1, fd) != 1 || fwrite(value, size, 1, fd) != 1) {
+        ABORT("Failed to write attribute to EXR");
+    }
+}
+
+bool Image_Save_EXR(size_t width, size_t height, const ImageChannel* channels, size_t num_channels, FILE* fd)
+{
+    // the channel list has to be sorted by name, and each scanline stores the channels in that order
+    size_t* order = (size_t*)malloc(num_channels * sizeof(size_t));
+    if (order == NULL) {
+        ABORT("Failed to allocate EXR channel list");
+    }
+
+    for (size_t ii = 0; ii < num_channels; ii++) {
+        size_t jj = ii;
+        while (jj > 0 && strcmp(channels[order[jj - 1]].name, channels[ii].name) > 0) {
+            order[jj] = order[jj - 1];
+            jj -= 1;
+        }
+
+        order[jj] = ii;
+    }
+
+    // each channel is its name, pixel type, linear flag + 3 reserved bytes and x/y subsampling, then a terminating NUL
+    size_t chlist_size = 1;
+    for (size_t ii = 0; ii < num_channels; ii++) {
+        chlist_size += strlen(channels[ii].name) + 1 + 4 * sizeof(i32);
+    }
+
+    u8* chlist = (u8*)calloc(chlist_size, 1);
+    if (chlist == NULL) {
+        ABORT("Failed to allocate EXR channel list");
+    }
+
+    u8* entry = chlist;
+    for (size_t ii = 0; ii < num_channels; ii++) {
+        const char* name      = channels[order[ii]].name;
+        i32         fields[4] = {EXR_PIXEL_FLOAT, 0, 1, 1};
+
+        memcpy(entry, name, strlen(name) + 1);
+        entry += strlen(name) + 1;
+        memcpy(entry, fields, sizeof(fields));
+        entry += sizeof(fields);
+    }
+
+    u32 magic_version[2] = {EXR_MAGIC, EXR_VERSION};
+    if (fwrite(magic_version, sizeof(magic_version), 1, fd) != 1) {
+        ABORT("Failed to write header to EXR");
+    }
+
+    u8  no_compression   = 0;
+    u8  increasing_y     = 0;
+    i32 window[4]        = {0, 0, (i32)width - 1, (i32)height - 1};
+    f32 aspect_ratio     = 1.0f;
+    f32 screen_center[2] = {0.0f, 0.0f};
+    f32 screen_width     = 1.0f;
+    u8  end_of_header    = 0;
+
+    EXR_WriteAttribute(fd, "channels", "chlist", chlist, (u32)chlist_size);
+    EXR_WriteAttribute(fd, "compression", "compression", &no_compression, sizeof(no_compression));
+    EXR_WriteAttribute(fd, "dataWindow", "box2i", window, sizeof(window));
+    EXR_WriteAttribute(fd, "displayWindow", "box2i", window, sizeof(window));
+    EXR_WriteAttribute(fd, "lineOrder", "lineOrder", &increasing_y, sizeof(increasing_y));
+    EXR_WriteAttribute(fd, "pixelAspectRatio", "float", &aspect_ratio, sizeof(aspect_ratio));
+    EXR_WriteAttribute(fd, "screenWindowCenter", "v2f", screen_center, sizeof(screen_center));
+    EXR_WriteAttribute(fd, "screenWindowWidth", "float", &screen_width, sizeof(screen_width));
+
+    if (fwrite(&end_of_header, sizeof(end_of_header), 1, fd) != 1) {
+        ABORT("Failed to write header to EXR");
+    }
+
+    // offset table (from the start of the file) of the scanline blocks: y, data size, then the data
+    u32 line_size   = (u32)(width * num_channels * sizeof(f32));
+    u64 block_size  = sizeof(i32) + sizeof(u32) + line_size;
+    u64 first_block = (u64)ftell(fd) + height * sizeof(u64);
+
+    for (size_t yy = 0; yy < height; yy++) {
+        u64 offset = first_block + yy * block_size;
+        if (fwrite(&offset, sizeof(offset), 1, fd) != 1) {
+            ABORT("Failed to write offset table to EXR");
+        }
+    }
+
+    for (size_t yy = 0; yy < height; yy++) {
+        i32 line = (i32)yy;
+        if (fwrite(&line, sizeof(line), 1, fd) != 1 || fwrite(&line_size, sizeof(line_size), 1, fd) != 1) {
+            ABORT("Failed to write scanline to EXR");
+        }
+
+        for (size_t ii = 0; ii < num_channels; ii++) {
+            const f32* row = &channels[order[ii]].data[yy * width];
+            if (fwrite(row, sizeof(f32), width, fd) != width) {
+                ABORT("Failed to write scanline to EXR");
+            }
+        }
+    }
+
+    if (fflush(fd)) {
+        ABORT("Failed to flush EXR");
+    }
+
+    free(chlist);
+    free(order);
+
+    return true;
+}
@@ -17,7 +17,7 @@ typedef struct {
     RGB* pix;
 } ImageRGB;
 
-// Linear Colorspace Image stored as f32x3 in [0, 1]
+// Linear Colorspace Image stored as f32x3 in [0, 1] (unbounded when loaded from an HDR)
 // 12 bytes per pixel
 // Should only be used for imported textures, doesn't require conversions
 typedef struct {
@@ -42,15 +42,30 @@ void ImageRGB_Unload(ImageRGB* img);
 void ImageRGB_SetPixel(ImageRGB* img, size_t xx, size_t yy, RGB color);
 RGB  ImageRGB_GetPixel(ImageRGB* img, size_t xx, size_t yy);
 
+// Copies a w x h block of pixels (stored row after row) into the image with its top left corner at x, y
+void ImageRGB_SetRect(ImageRGB* img, size_t x, size_t y, size_t w, size_t h, const RGB* pix);
+
 /* ---- Linear Colorspace Image ---- */
 
 bool ImageColor_Load_Empty(ImageColor* img, size_t width, size_t height);
 bool ImageColor_Load_ImageRGB(ImageColor* img, ImageRGB* src);
+bool ImageColor_Load_HDR(ImageColor* img, FILE* fd); // Radiance RGBE (.hdr)
 
 void ImageColor_Unload(ImageColor* img);
 
 void  ImageColor_SetPixel(ImageColor* img, size_t xx, size_t yy, Color color);
 Color ImageColor_GetPixel(ImageColor* img, size_t xx, size_t yy);
 
+/* ---- Multi-channel float image ---- */
+
+// One plane of a multi-channel image, width * height values stored row after row
+typedef struct {
+    const char* name;
+    const f32*  data;
+} ImageChannel;
+
+// Uncompressed OpenEXR with a 32 bit float channel per plane
+bool Image_Save_EXR(size_t width, size_t height, const ImageChannel* channels, size_t num_channels, FILE* fd);
+
 // TODO: when we implement normal maps (or any other non-sRGB texture) we need
 // to provide a way to not do sRGB -> Linear conversion
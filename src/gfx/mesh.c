@@ -1,6 +1,8 @@
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "math/math.h"
 #include "math/vec.h"
 #include "rt/materials.h"
 #include "rt/surfaces.h"
@@ -18,6 +20,8 @@
 typedef struct Mesh {
     point3            origin;
     f32               scale;
+    vec3              rotation_axis;
+    f32               rotation; // radians about rotation_axis
     Material*         material;
     Vector(Triangle)* polys;
 } Mesh;
@@ -35,6 +39,10 @@ Mesh* Mesh_New(void)
         goto error_Polys;
     }
 
+    mesh->scale         = 1.0f;
+    mesh->rotation_axis = (vec3){0, 0, 1};
+    mesh->rotation      = 0.0f;
+
     return mesh;
 
 error_Polys:
@@ -64,15 +72,36 @@ void Mesh_Set_Scale(Mesh* mesh, f32 scale)
     mesh->scale = scale;
 }
 
+// Rotates about the given axis (unit length) by Rodrigues' formula
+intern vec3 Mesh_Rotate(vec3 vv, vec3 axis, f32 cos_theta, f32 sin_theta)
+{
+    vec3 parallel = vmul(axis, vdot(axis, vv) * (1.0f - cos_theta));
+    return vadd(vadd(vmul(vv, cos_theta), vmul(vcross(axis, vv), sin_theta)), parallel);
+}
+
+void Mesh_Set_Rotation(Mesh* mesh, vec3 axis, f32 degrees)
+{
+    mesh->rotation_axis = vnorm(axis);
+    mesh->rotation      = radiansf(degrees);
+}
+
+// Triangles go into the scene scaled, then rotated, then moved to the origin, the mesh itself is left as imported so
+// it can be added again with a different transform
 void Mesh_AddToScene(Mesh* mesh, Scene* scene)
 {
     Object obj;
+    f32    cos_theta = cosf(mesh->rotation);
+    f32    sin_theta = sinf(mesh->rotation);
 
     for (size_t ii = 0; ii < mesh->polys->length; ii++) {
         Triangle triWorldSpace = mesh->polys->at[ii];
 
         for (size_t jj = 0; jj < 3; jj++) {
-            triWorldSpace.vtx[jj].pos = vadd(vmul(triWorldSpace.vtx[jj].pos, mesh->scale), mesh->origin);
+            Vertex* vtx = &triWorldSpace.vtx[jj];
+
+            vtx->pos  = vmul(vtx->pos, mesh->scale);
+            vtx->pos  = vadd(Mesh_Rotate(vtx->pos, mesh->rotation_axis, cos_theta, sin_theta), mesh->origin);
+            vtx->norm = Mesh_Rotate(vtx->norm, mesh->rotation_axis, cos_theta, sin_theta);
         }
 
         obj.material         = mesh->material;
@@ -15,5 +15,4 @@ void Mesh_AddToScene(Mesh* mesh, Scene* scene);
 void Mesh_Set_Material(Mesh* mesh, Material* material);
 void Mesh_Set_Origin(Mesh* mesh, point3 origin);
 void Mesh_Set_Scale(Mesh* mesh, f32 scale);
-
-// TODO: Mesh_Set_Rotation
+void Mesh_Set_Rotation(Mesh* mesh, vec3 axis, f32 degrees);
@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gfx/color.h"
 #include "gfx/image.h"
@@ -16,13 +17,17 @@
 #include "math/vec.h"
 #include "platform/misc.h"
 #include "platform/profiling.h"
+#include "platform/threads.h"
 #include "rt/renderer.h"
 #include "world/camera.h"
 #include "world/object.h"
 #include "world/scene.h"
 
-Material  g_mats[16];
-ImageRGB* g_img;
+Material g_mats[16];
+
+// set by SIGINT, the preview loop notices it and exports the partial image (stdio isn't async-signal-safe, so the
+// handler itself can't)
+intern volatile sig_atomic_t g_interrupted = 0;
 
 intern bool ExportImage(ImageRGB* img, const char* filename)
 {
@@ -47,14 +52,7 @@ intern bool ExportImage(ImageRGB* img, const char* filename)
 intern void InterruptHandler(int sig)
 {
     (void)sig;
-
-    printf("\nExporting partial image to disk\n");
-
-    if (ExportImage(g_img, "partial.bmp")) {
-        exit(EXIT_SUCCESS);
-    } else {
-        ABORT("Failed to write image to disk");
-    }
+    g_interrupted = 1;
 }
 
 intern void FillScene(Scene* scene, Skybox* skybox)
@@ -260,6 +258,108 @@ intern void FillScene(Scene* scene, Skybox* skybox)
     (void)skybox;
 }
 
+// Free camera steered from the preview window: WASD moves along the view, Q/E moves down/up and dragging with the left
+// mouse button turns it
+typedef struct {
+    point3 origin;
+    f32    yaw;   // radians around Z+, from X+
+    f32    pitch; // radians above the XY plane
+    f32    vfov;
+    f32    focus_dist;
+
+    f64  cursor_x, cursor_y;
+    bool dragging;
+    bool moved; // the render has to be restarted from the new view
+} Navigation;
+
+// Preview window state shared between the main thread, which owns the window and handles its events (GLFW requires
+// both on the main thread), and the preview thread, which owns the GL context and does all the drawing
+typedef struct {
+    GLFWwindow* window;
+    RenderCtx*  ctx;
+    i32         exposure; // display exposure in half stops, changed by the main thread on key presses
+    bool        shutdown;
+    Navigation  nav;      // only touched by the main thread
+} Preview;
+
+intern Navigation Navigation_Make(point3 look_from, point3 look_at, f32 vfov)
+{
+    vec3 dir = vsub(look_at, look_from);
+
+    return (Navigation){
+        .origin     = look_from,
+        .yaw        = atan2f(dir.y, dir.x),
+        .pitch      = atan2f(dir.z, sqrtf(dir.x * dir.x + dir.y * dir.y)),
+        .vfov       = vfov,
+        .focus_dist = vmag(dir),
+        .cursor_x   = 0.0,
+        .cursor_y   = 0.0,
+        .dragging   = false,
+        .moved      = false,
+    };
+}
+
+intern vec3 Navigation_Forward(Navigation* nav)
+{
+    return (vec3){
+        .x = cosf(nav->pitch) * cosf(nav->yaw),
+        .y = cosf(nav->pitch) * sinf(nav->yaw),
+        .z = sinf(nav->pitch),
+    };
+}
+
+intern Camera* Navigation_Camera(Navigation* nav, f32 aspect_ratio)
+{
+    point3 look_at = vadd(nav->origin, Navigation_Forward(nav));
+    vec3   vup     = (vec3){0, 0, 1};
+
+    Camera* cam = Camera_New(nav->origin, look_at, vup, aspect_ratio, nav->vfov, 0.0f, nav->focus_dist);
+    if (cam == NULL) {
+        ABORT("Failed to create camera");
+    }
+
+    return cam;
+}
+
+intern void Navigation_Move(Navigation* nav, int key)
+{
+    vec3 forward = Navigation_Forward(nav);
+    vec3 right   = (vec3){sinf(nav->yaw), -cosf(nav->yaw), 0.0f};
+    vec3 up      = (vec3){0, 0, 1};
+
+    switch (key) {
+        case GLFW_KEY_W: {
+            nav->origin = vadd(nav->origin, vmul(forward, PREVIEW_MOVE_STEP));
+        } break;
+
+        case GLFW_KEY_S: {
+            nav->origin = vsub(nav->origin, vmul(forward, PREVIEW_MOVE_STEP));
+        } break;
+
+        case GLFW_KEY_D: {
+            nav->origin = vadd(nav->origin, vmul(right, PREVIEW_MOVE_STEP));
+        } break;
+
+        case GLFW_KEY_A: {
+            nav->origin = vsub(nav->origin, vmul(right, PREVIEW_MOVE_STEP));
+        } break;
+
+        case GLFW_KEY_E: {
+            nav->origin = vadd(nav->origin, vmul(up, PREVIEW_MOVE_STEP));
+        } break;
+
+        case GLFW_KEY_Q: {
+            nav->origin = vsub(nav->origin, vmul(up, PREVIEW_MOVE_STEP));
+        } break;
+
+        default: {
+            return;
+        }
+    }
+
+    nav->moved = true;
+}
+
 intern void glfw_error_handler(int error_code, const char* description)
 {
     ABORT("GLFW Error :: %s (%d)", description, error_code);
@@ -267,19 +367,73 @@ intern void glfw_error_handler(int error_code, const char* description)
 
 intern void glfw_input_handler(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    (void)window;
     (void)scancode;
     (void)mods;
 
+    Preview* preview = (Preview*)glfwGetWindowUserPointer(window);
+
+    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+        switch (key) {
+            case GLFW_KEY_EQUAL:
+            case GLFW_KEY_KP_ADD: {
+                __atomic_add_fetch(&preview->exposure, 1, __ATOMIC_RELAXED);
+            } break;
+
+            case GLFW_KEY_MINUS:
+            case GLFW_KEY_KP_SUBTRACT: {
+                __atomic_sub_fetch(&preview->exposure, 1, __ATOMIC_RELAXED);
+            } break;
+
+            case GLFW_KEY_0: {
+                __atomic_store_n(&preview->exposure, 0, __ATOMIC_RELAXED);
+            } break;
+
+            default: {
+                Navigation_Move(&preview->nav, key);
+            } break;
+        }
+    }
+
     if (action == GLFW_RELEASE) {
         switch (key) {
             case GLFW_KEY_ESCAPE: {
-                exit(EXIT_SUCCESS);
+                glfwSetWindowShouldClose(window, GL_TRUE);
             } break;
         }
     }
 }
 
+intern void glfw_mouse_button_handler(GLFWwindow* window, int button, int action, int mods)
+{
+    (void)mods;
+
+    Preview* preview = (Preview*)glfwGetWindowUserPointer(window);
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT) {
+        preview->nav.dragging = action == GLFW_PRESS;
+        glfwGetCursorPos(window, &preview->nav.cursor_x, &preview->nav.cursor_y);
+    }
+}
+
+intern void glfw_cursor_handler(GLFWwindow* window, double xpos, double ypos)
+{
+    Preview*    preview = (Preview*)glfwGetWindowUserPointer(window);
+    Navigation* nav     = &preview->nav;
+
+    if (!nav->dragging) {
+        return;
+    }
+
+    // dragging right turns right (clockwise seen from above), dragging up looks up
+    nav->yaw -= (f32)(xpos - nav->cursor_x) * PREVIEW_TURN_RATE;
+    nav->pitch -= (f32)(ypos - nav->cursor_y) * PREVIEW_TURN_RATE;
+    nav->pitch = clampf(nav->pitch, -radiansf(89.0f), radiansf(89.0f));
+
+    nav->cursor_x = xpos;
+    nav->cursor_y = ypos;
+    nav->moved    = true;
+}
+
 const char* glGetErrorString(GLenum err)
 {
     switch (err) {
@@ -327,38 +481,209 @@ const char* glGetErrorString(GLenum err)
         }                                                                   \
     } while (0)
 
-RenderCtx* SetupRender(Stopwatch* sw, size_t res_w, size_t res_h)
+// Draws the image texture over the window with a full screen triangle, scaled by the exposure: the texture is sRGB so
+// it's sampled as linear, and the result is encoded back to sRGB (the image is already clamped to [0, 1], so lowering
+// the exposure can't bring back blown out highlights)
+intern const char* g_preview_vertex_src =
+    "#version 130\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    uv          = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+intern const char* g_preview_fragment_src =
+    "#version 130\n"
+    "uniform sampler2D image;\n"
+    "uniform float exposure;\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    vec3 linear = texture(image, uv).rgb * exposure;\n"
+    "    vec3 srgb   = mix(linear * 12.92, 1.055 * pow(linear, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, linear));\n"
+    "    color       = vec4(srgb, 1.0);\n"
+    "}\n";
+
+intern GLuint Preview_CompileShader(GLenum type, const char* src)
 {
-    point3 lookFrom    = (point3){20, -20, 20};
-    point3 lookAt      = (point3){0, 0, 6};
-    vec3   vup         = (vec3){0, 0, 1};
-    f32    focusDist   = vmag(vsub(lookFrom, lookAt));
-    f32    aperature   = 0.0f;
-    f32    aspectRatio = (f32)res_w / (f32)res_h;
-    f32    vFov        = 40.0f;
+    GLuint shader = glCreateShader(type);
+    GL_CHECK(glShaderSource(shader, 1, &src, NULL));
+    GL_CHECK(glCompileShader(shader));
+
+    GLint compiled;
+    GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+    if (!compiled) {
+        char info_log[1024];
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        ABORT("Failed to compile preview shader :: %s", info_log);
+    }
 
-    size_t imageWidth  = res_w;
-    size_t imageHeight = res_h;
+    return shader;
+}
 
-    ImageRGB* img = (ImageRGB*)calloc(1, sizeof(ImageRGB));
-    if (img == NULL) {
-        ABORT("Failed to create image container");
+intern GLuint Preview_Program(void)
+{
+    GLuint vertex   = Preview_CompileShader(GL_VERTEX_SHADER, g_preview_vertex_src);
+    GLuint fragment = Preview_CompileShader(GL_FRAGMENT_SHADER, g_preview_fragment_src);
+
+    GLuint program = glCreateProgram();
+    GL_CHECK(glAttachShader(program, vertex));
+    GL_CHECK(glAttachShader(program, fragment));
+    GL_CHECK(glLinkProgram(program));
+
+    GLint linked;
+    GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (!linked) {
+        char info_log[1024];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        ABORT("Failed to link preview shader :: %s", info_log);
     }
 
-    if (!ImageRGB_Load_Empty(img, imageWidth, imageHeight)) {
-        ABORT("Failed to create image buffer");
+    GL_CHECK(glDeleteShader(vertex));
+    GL_CHECK(glDeleteShader(fragment));
+
+    return program;
+}
+
+// Copies the tiles finished since the last frame into the unpack buffer (each at its place in the image) and updates
+// just those rectangles of the texture from it, so each frame only moves what changed and the texture uploads are
+// queued without the driver reading from (or waiting on) the image the workers publish to
+// The caller alternates between two buffers, so filling this frame's doesn't wait on the last frame's uploads
+intern void Preview_Upload(RenderCtx* ctx, GLuint unpack_buffer)
+{
+    size_t res_w = ctx->img->res.width;
+    size_t res_h = ctx->img->res.height;
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpack_buffer));
+
+    // until a poll comes back short (drained), a buffer that's mapped again after its uploads are queued is orphaned
+    // by the invalidate instead of stalling on them
+    RenderRect tiles[256];
+    size_t     num_tiles;
+
+    do {
+        num_tiles = Render_Poll_Tiles(ctx, tiles, lengthof(tiles));
+        if (num_tiles == 0) {
+            break;
+        }
+
+        RGB* staging = (RGB*)glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER,
+            0,
+            res_w * res_h * sizeof(RGB),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staging == NULL) {
+            ABORT("Failed to map the preview unpack buffer");
+        }
+
+        for (size_t ii = 0; ii < num_tiles; ii++) {
+            RenderRect* tile = &tiles[ii];
+
+            for (size_t yy = tile->y; yy < tile->y + tile->h; yy++) {
+                size_t offset = yy * res_w + tile->x;
+                memcpy(&staging[offset], &ctx->img->pix[offset], tile->w * sizeof(RGB));
+            }
+        }
+
+        GL_CHECK(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+        for (size_t ii = 0; ii < num_tiles; ii++) {
+            RenderRect* tile   = &tiles[ii];
+            size_t      offset = (tile->y * res_w + tile->x) * sizeof(RGB);
+
+            GL_CHECK(glTexSubImage2D(
+                GL_TEXTURE_2D,
+                0,
+                tile->x,
+                tile->y,
+                tile->w,
+                tile->h,
+                GL_BGR,
+                GL_UNSIGNED_BYTE,
+                (const void*)offset));
+        }
+    } while (num_tiles == lengthof(tiles));
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+// Preview thread: redraws the window RENDER_FPS times a second until told to shut down, it only ever reads the image
+// and the tile queue, so a slow display (or a blocking swap) holds up nothing but itself
+intern void Preview_Thread(void* arg)
+{
+    Preview*   preview = (Preview*)arg;
+    RenderCtx* ctx     = preview->ctx;
+    size_t     res_w   = ctx->img->res.width;
+    size_t     res_h   = ctx->img->res.height;
+
+    glfwMakeContextCurrent(preview->window);
+    glfwSwapInterval(0);
+
+    GLenum err = glewInit();
+    if (err != GLEW_OK) {
+        ABORT("Error initializing GLEW");
     }
 
-    g_img = img;
+    // setup texture
+    GLuint gl_texture;
+    GL_CHECK(glGenTextures(1, &gl_texture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, gl_texture));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ROW_LENGTH, res_w));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, res_w, res_h, 0, GL_BGR, GL_UNSIGNED_BYTE, ctx->img->pix));
+
+    // setup the unpack buffers, allocated once for the whole image
+    GLuint gl_unpack_buffers[2];
+    GL_CHECK(glGenBuffers(2, gl_unpack_buffers));
+    for (size_t ii = 0; ii < lengthof(gl_unpack_buffers); ii++) {
+        GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl_unpack_buffers[ii]));
+        GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, res_w * res_h * sizeof(RGB), NULL, GL_STREAM_DRAW));
+    }
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
 
-    Camera* cam = Camera_New(lookFrom, lookAt, vup, aspectRatio, vFov, aperature, focusDist);
-    if (cam == NULL) {
-        ABORT("Failed to create camera");
+    // setup shader
+    GLuint gl_program  = Preview_Program();
+    GLint  gl_image    = glGetUniformLocation(gl_program, "image");
+    GLint  gl_exposure = glGetUniformLocation(gl_program, "exposure");
+
+    GLuint gl_vertex_array;
+    GL_CHECK(glGenVertexArrays(1, &gl_vertex_array));
+
+    for (size_t frame = 0; !__atomic_load_n(&preview->shutdown, __ATOMIC_ACQUIRE); frame++) {
+        Preview_Upload(ctx, gl_unpack_buffers[frame % lengthof(gl_unpack_buffers)]);
+
+        f32 exposure = exp2f(0.5f * (f32)__atomic_load_n(&preview->exposure, __ATOMIC_RELAXED));
+
+        GL_CHECK(glViewport(0, 0, res_w, res_h));
+        GL_CHECK(glUseProgram(gl_program));
+        GL_CHECK(glUniform1i(gl_image, 0));
+        GL_CHECK(glUniform1f(gl_exposure, exposure));
+        GL_CHECK(glBindVertexArray(gl_vertex_array));
+        GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
+        glfwSwapBuffers(preview->window);
+
+        SleepMS(1000 / RENDER_FPS);
     }
 
-    Skybox* skybox = Skybox_Import_BMP("assets/skybox2");
-    if (skybox == NULL) {
-        ABORT("Failed to load skybox");
+    GL_CHECK(glDeleteVertexArrays(1, &gl_vertex_array));
+    GL_CHECK(glDeleteProgram(gl_program));
+    GL_CHECK(glDeleteBuffers(2, gl_unpack_buffers));
+    GL_CHECK(glDeleteTextures(1, &gl_texture));
+
+    glfwMakeContextCurrent(NULL);
+}
+
+RenderCtx* SetupRender(Stopwatch* sw, Camera* cam, Skybox* skybox, size_t res_w, size_t res_h)
+{
+    ImageRGB* img = (ImageRGB*)calloc(1, sizeof(ImageRGB));
+    if (img == NULL) {
+        ABORT("Failed to create image container");
+    }
+
+    if (!ImageRGB_Load_Empty(img, res_w, res_h)) {
+        ABORT("Failed to create image buffer");
     }
 
     Scene* scene = Scene_New(skybox);
@@ -379,9 +704,16 @@ int main(int argc, char** argv)
         ABORT("Failed to create stopwatch");
     }
 
-    u64 samples_per_pixel = 32;
-    u64 max_ray_bounces   = 8;
-    u64 num_threads       = NUM_HYPERTHREADS;
+    u64  samples_per_pixel = 32;
+    u64  max_ray_bounces   = 8;
+    u64  num_threads       = NUM_HYPERTHREADS;
+    u64  tile_size         = RENDER_TILE_W_PX;
+    f32  adaptive_error    = 0.0f;
+    bool wavefront         = false;
+    bool sort_rays         = false;
+
+    const char* envmap_path  = NULL;
+    const char* sampler_name = "sobol";
 
     size_t res_w = 1280;
     size_t res_h = 720;
@@ -390,21 +722,64 @@ int main(int argc, char** argv)
         samples_per_pixel = atol(argv[1]);
     if (argc > 2)
         max_ray_bounces = atol(argv[2]);
+    if (argc > 3)
+        tile_size = atol(argv[3]);
+    if (argc > 4)
+        adaptive_error = (f32)atof(argv[4]);
+    if (argc > 5)
+        wavefront = strcmp(argv[5], "wavefront") == 0 || strcmp(argv[5], "wavefront-sorted") == 0;
+    if (argc > 5)
+        sort_rays = strcmp(argv[5], "wavefront-sorted") == 0;
+    if (argc > 6 && strcmp(argv[6], "-") != 0)
+        envmap_path = argv[6];
+    if (argc > 7)
+        sampler_name = argv[7];
+
+    SamplerType sampler;
+    if (strcmp(sampler_name, "random") == 0) {
+        sampler = SAMPLER_RANDOM;
+    } else if (strcmp(sampler_name, "stratified") == 0) {
+        sampler = SAMPLER_STRATIFIED;
+    } else if (strcmp(sampler_name, "sobol") == 0) {
+        sampler = SAMPLER_SOBOL;
+    } else {
+        ABORT("Unknown sampler '%s' (expected random, stratified or sobol)", sampler_name);
+    }
 
     printf(
         "Render settings:\n"
-        "%zux%zu\n" U64_DEC_FMT " threads\n" U64_DEC_FMT " samples per pixel\n" U64_DEC_FMT " max ray bounces\n\n",
+        "%zux%zu\n" U64_DEC_FMT " threads\n" U64_DEC_FMT " samples per pixel\n" U64_DEC_FMT
+        " max ray bounces\n" U64_DEC_FMT "px tiles\n%.4f adaptive error threshold\n%s mode\n%s sampler\n%s sky\n\n",
         res_w,
         res_h,
         num_threads,
         samples_per_pixel,
-        max_ray_bounces);
+        max_ray_bounces,
+        tile_size,
+        adaptive_error,
+        wavefront ? (sort_rays ? "wavefront (sorted secondary rays)" : "wavefront") : "path",
+        sampler_name,
+        envmap_path ? envmap_path : "assets/skybox2");
 
     // setup and start the render
-    RenderCtx* ctx = SetupRender(sw, res_w, res_h);
+    f32        aspect_ratio = (f32)res_w / (f32)res_h;
+    Navigation nav          = Navigation_Make((point3){20, -20, 20}, (point3){0, 0, 6}, 40.0f);
+
+    Skybox* skybox = envmap_path ? Skybox_Import_HDR(envmap_path) : Skybox_Import_BMP("assets/skybox2");
+    if (skybox == NULL) {
+        ABORT("Failed to load skybox");
+    }
+
+    RenderCtx* ctx = SetupRender(sw, Navigation_Camera(&nav, aspect_ratio), skybox, res_w, res_h);
+    Render_Set_TileSize(ctx, tile_size, tile_size);
+    Render_Set_Mode(ctx, wavefront ? RENDER_MODE_WAVEFRONT : RENDER_MODE_PATH);
+    Render_Set_RaySorting(ctx, sort_rays);
+    Render_Set_Sampler(ctx, sampler);
+    Render_Set_Adaptive(ctx, RENDER_ADAPTIVE_MIN_SPP, RENDER_ADAPTIVE_STEP_SPP, adaptive_error);
+    Render_Set_Threads(ctx, num_threads);
+    Render_Set_Progressive(ctx, true, PREVIEW_SCALE);
 
-    // create GLFW/GLEW and setup the window
-    // TODO: move all this GL/window init into a separate function
+    // create GLFW and setup the window, the GL context is handed to the preview thread
     glfwSetErrorCallback(glfw_error_handler);
     if (!glfwInit()) {
         ABORT("Failed to initialize GLFW");
@@ -418,13 +793,18 @@ int main(int argc, char** argv)
         ABORT("Failed to create GLFW window");
     }
 
-    glfwMakeContextCurrent(gl_window);
-    glfwSetKeyCallback(gl_window, glfw_input_handler);
+    Preview preview = {
+        .window   = gl_window,
+        .ctx      = ctx,
+        .exposure = 0,
+        .shutdown = false,
+        .nav      = nav,
+    };
 
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        ABORT("Error initializing GLEW");
-    }
+    glfwSetWindowUserPointer(gl_window, &preview);
+    glfwSetKeyCallback(gl_window, glfw_input_handler);
+    glfwSetMouseButtonCallback(gl_window, glfw_mouse_button_handler);
+    glfwSetCursorPosCallback(gl_window, glfw_cursor_handler);
 
     printf("Starting :: Render\n");
     Stopwatch_Start(sw);
@@ -433,32 +813,29 @@ int main(int argc, char** argv)
     // TODO: I think we want to do this here
     signal(SIGINT, InterruptHandler);
 
-    // setup texture
-    GLuint gl_texture;
-    GL_CHECK(glGenTextures(1, &gl_texture));
-    GL_CHECK(glBindTexture(GL_TEXTURE_2D, gl_texture));
-    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, res_w, res_h, 0, GL_BGR, GL_UNSIGNED_BYTE, ctx->img->pix));
-
-    // setup framebuffer
-    GLuint gl_framebuffer;
-    GL_CHECK(glGenFramebuffers(1, &gl_framebuffer));
-    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, gl_framebuffer));
-    GL_CHECK(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gl_texture, 0));
-
-    glfwSwapInterval(0);
+    Thread* preview_thread = Thread_New();
+    if (preview_thread == NULL || !Thread_Spawn(preview_thread, Preview_Thread, &preview)) {
+        ABORT("Failed to start the preview thread");
+    }
 
+    // handle window events (+/- and 0 change the exposure, WASD/QE and the mouse move the camera, ESC closes the
+    // window) until the window is closed
     bool last_render_state = false;
-    while (!glfwWindowShouldClose(gl_window)) {
-        // copy texture to framebuffer
-        GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, res_w, res_h, GL_BGR, GL_UNSIGNED_BYTE, ctx->img->pix));
-
-        // update frame buffer
-        GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, gl_framebuffer));
-        GL_CHECK(glBlitFramebuffer(0, 0, res_w, res_h, 0, 0, res_w, res_h, GL_COLOR_BUFFER_BIT, GL_LINEAR));
-        glfwSwapBuffers(gl_window);
+    while (!glfwWindowShouldClose(gl_window) && !g_interrupted) {
+        // the events since the last check are folded into one restart, the old job is cancelled and waited for so
+        // the camera isn't freed under workers still using it
+        if (preview.nav.moved) {
+            preview.nav.moved = false;
+
+            Camera* old_cam = ctx->cam;
+            Render_Cancel(ctx);
+            Render_Set_Job(ctx, ctx->scene, ctx->img, Navigation_Camera(&preview.nav, aspect_ratio));
+            free(old_cam);
+
+            Stopwatch_Start(sw);
+            Render_Start(ctx, samples_per_pixel, max_ray_bounces);
+            last_render_state = false;
+        }
 
         // timing
         bool cur_render_state = Render_Done(ctx);
@@ -466,20 +843,53 @@ int main(int argc, char** argv)
             Stopwatch_Stop(sw);
             i64 time_elapsed_ms = Stopwatch_Elapsed(sw, STOPWATCH_MILISECONDS);
             printf(
-                "Finished :: Render :: (" I64_DEC_FMT "%s)\n\n",
+                "Finished :: Render :: (" I64_DEC_FMT "%s)\n",
                 time_elapsed_ms,
                 STOPWATCH_TIMESCALE_UNIT(STOPWATCH_MILISECONDS));
+
+            u64 uniform_samples = (u64)res_w * res_h * samples_per_pixel;
+            printf(
+                U64_DEC_FMT " samples in %zu passes (%.1f%% of uniform sampling)\n\n",
+                ctx->stats.samples,
+                ctx->stats.passes,
+                100.0 * ctx->stats.samples / (f64)uniform_samples);
         }
         last_render_state = cur_render_state;
 
-        // poll events and wait
-        glfwPollEvents();
-        SleepMS(1000 / RENDER_FPS);
+        glfwWaitEventsTimeout(1.0 / RENDER_FPS);
     }
 
-    if (ExportImage(ctx->img, "output.bmp")) {
-        return EXIT_SUCCESS;
+    __atomic_store_n(&preview.shutdown, true, __ATOMIC_RELEASE);
+    Thread_Join(preview_thread);
+    Thread_Delete(preview_thread);
+
+    glfwDestroyWindow(gl_window);
+    glfwTerminate();
+
+    // closing the window before the render is done keeps what's there like an interrupt does, the workers are
+    // stopped first so no tile is exported half written
+    bool partial = g_interrupted || !Render_Done(ctx);
+    Render_Cancel(ctx);
+    Render_Wait(ctx);
+
+    if (partial) {
+        printf("\nExporting partial image to disk\n");
     }
 
-    return EXIT_FAILURE;
+    bool exported = ExportImage(ctx->img, partial ? "partial.bmp" : "output.bmp");
+
+    Scene*    scene = ctx->scene;
+    ImageRGB* img   = ctx->img;
+    Camera*   cam   = ctx->cam;
+
+    Render_Delete(ctx);
+    Scene_Delete(scene);
+    Skybox_Delete(skybox);
+    free(skybox);
+    free(cam);
+    ImageRGB_Unload(img);
+    free(img);
+    Stopwatch_Delete(sw);
+
+    return exported ? EXIT_SUCCESS : EXIT_FAILURE;
 }
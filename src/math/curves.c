@@ -0,0 +1,57 @@
+#include "curves.h"
+
+#include <stdint.h>
+
+/* ---- Hilbert Curve ---- */
+
+intern inline void Hilbert_Rotate(u32 side, u32* xx, u32* yy, u32 rx, u32 ry)
+{
+    if (ry == 0) {
+        if (rx == 1) {
+            *xx = side - 1 - *xx;
+            *yy = side - 1 - *yy;
+        }
+
+        u32 tmp = *xx;
+        *xx     = *yy;
+        *yy     = tmp;
+    }
+}
+
+// See: https://en.wikipedia.org/wiki/Hilbert_curve#Applications_and_mapping_algorithms
+void Hilbert_ToXY(u32 side, u64 dist, u32* xx, u32* yy)
+{
+    u64 tt = dist;
+
+    *xx = 0;
+    *yy = 0;
+
+    for (u32 ss = 1; ss < side; ss *= 2) {
+        u32 rx = 1 & (u32)(tt / 2);
+        u32 ry = 1 & (u32)(tt ^ rx);
+
+        Hilbert_Rotate(ss, xx, yy, rx, ry);
+
+        *xx += ss * rx;
+        *yy += ss * ry;
+        tt /= 4;
+    }
+}
+
+/* ---- Morton Curve ---- */
+
+// Spreads the low 10 bits of x out so there are 2 zero bits between each of them
+intern inline u32 Morton_Spread3(u32 xx)
+{
+    xx &= 0x000003FF;
+    xx = (xx | (xx << 16)) & 0xFF0000FF;
+    xx = (xx | (xx << 8)) & 0x0300F00F;
+    xx = (xx | (xx << 4)) & 0x030C30C3;
+    xx = (xx | (xx << 2)) & 0x09249249;
+    return xx;
+}
+
+u32 Morton_Encode3(u32 xx, u32 yy, u32 zz)
+{
+    return Morton_Spread3(xx) | (Morton_Spread3(yy) << 1) | (Morton_Spread3(zz) << 2);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Maps a distance along a hilbert curve filling a (side x side) square to its (x, y) position
+// NOTE: side must be a power of 2
+void Hilbert_ToXY(u32 side, u64 dist, u32* xx, u32* yy);
+
+// Interleaves the low 10 bits of x, y and z into a 30 bit morton code (x in the lowest bit)
+u32 Morton_Encode3(u32 xx, u32 yy, u32 zz);
@@ -0,0 +1,166 @@
+#include "distribution.h"
+
+#include <stdlib.h>
+
+#include "math/math.h"
+
+/* ---- 1D ---- */
+
+bool Distribution1D_Init(Distribution1D* dist, const f32* func, size_t count)
+{
+    dist->func = (f32*)malloc(count * sizeof(f32));
+    if (dist->func == NULL) {
+        goto error_Func;
+    }
+
+    dist->cdf = (f32*)malloc((count + 1) * sizeof(f32));
+    if (dist->cdf == NULL) {
+        goto error_CDF;
+    }
+
+    dist->count  = count;
+    dist->cdf[0] = 0.0f;
+
+    for (size_t ii = 0; ii < count; ii++) {
+        dist->func[ii]    = func[ii];
+        dist->cdf[ii + 1] = dist->cdf[ii] + func[ii] / (f32)count;
+    }
+
+    dist->integral = dist->cdf[count];
+
+    if (dist->integral <= 0.0f) {
+        // nothing to prefer, fall back to uniform
+        for (size_t ii = 1; ii <= count; ii++) {
+            dist->cdf[ii] = (f32)ii / (f32)count;
+        }
+    } else {
+        for (size_t ii = 1; ii <= count; ii++) {
+            dist->cdf[ii] /= dist->integral;
+        }
+    }
+
+    return true;
+
+error_CDF:
+    free(dist->func);
+error_Func:
+    return false;
+}
+
+void Distribution1D_Uninit(Distribution1D* dist)
+{
+    free(dist->func);
+    free(dist->cdf);
+}
+
+// Density of the piece relative to uniform
+intern inline f32 Distribution1D_PieceDensity(Distribution1D* dist, size_t offset)
+{
+    if (dist->integral <= 0.0f) {
+        return 1.0f;
+    }
+
+    return dist->func[offset] / dist->integral;
+}
+
+f32 Distribution1D_Sample(Distribution1D* dist, f32 u, f32* pdf, size_t* offset)
+{
+    // last cdf entry <= u
+    size_t lo = 0;
+    size_t hi = dist->count;
+
+    while (lo + 1 < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (dist->cdf[mid] <= u) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *offset = lo;
+    *pdf    = Distribution1D_PieceDensity(dist, lo);
+
+    f32 width = dist->cdf[lo + 1] - dist->cdf[lo];
+    f32 du    = width > 0.0f ? (u - dist->cdf[lo]) / width : 0.0f;
+
+    return minf(((f32)lo + du) / (f32)dist->count, 1.0f - EPSILON);
+}
+
+/* ---- 2D ---- */
+
+bool Distribution2D_Init(Distribution2D* dist, const f32* func, size_t width, size_t height)
+{
+    f32*   row_integrals = NULL;
+    size_t rows_done     = 0;
+
+    dist->width  = width;
+    dist->height = height;
+
+    dist->conditional = (Distribution1D*)malloc(height * sizeof(Distribution1D));
+    if (dist->conditional == NULL) {
+        goto error_Conditional;
+    }
+
+    row_integrals = (f32*)malloc(height * sizeof(f32));
+    if (row_integrals == NULL) {
+        goto error_RowIntegrals;
+    }
+
+    for (; rows_done < height; rows_done++) {
+        if (!Distribution1D_Init(&dist->conditional[rows_done], &func[rows_done * width], width)) {
+            goto error_Rows;
+        }
+
+        row_integrals[rows_done] = dist->conditional[rows_done].integral;
+    }
+
+    if (!Distribution1D_Init(&dist->marginal, row_integrals, height)) {
+        goto error_Rows;
+    }
+
+    free(row_integrals);
+    return true;
+
+error_Rows:
+    for (size_t ii = 0; ii < rows_done; ii++) {
+        Distribution1D_Uninit(&dist->conditional[ii]);
+    }
+    free(row_integrals);
+error_RowIntegrals:
+    free(dist->conditional);
+error_Conditional:
+    return false;
+}
+
+void Distribution2D_Uninit(Distribution2D* dist)
+{
+    for (size_t ii = 0; ii < dist->height; ii++) {
+        Distribution1D_Uninit(&dist->conditional[ii]);
+    }
+
+    free(dist->conditional);
+    Distribution1D_Uninit(&dist->marginal);
+}
+
+point2 Distribution2D_Sample(Distribution2D* dist, point2 u, f32* pdf)
+{
+    f32    pdf_v, pdf_u;
+    size_t row, column;
+
+    f32 v  = Distribution1D_Sample(&dist->marginal, u.v, &pdf_v, &row);
+    f32 uu = Distribution1D_Sample(&dist->conditional[row], u.u, &pdf_u, &column);
+
+    *pdf = pdf_v * pdf_u;
+    return (point2){.u = uu, .v = v};
+}
+
+f32 Distribution2D_PDF(Distribution2D* dist, point2 uv)
+{
+    size_t column = MIN((size_t)(clampf(uv.u, 0.0f, 1.0f) * dist->width), dist->width - 1);
+    size_t row    = MIN((size_t)(clampf(uv.v, 0.0f, 1.0f) * dist->height), dist->height - 1);
+
+    return Distribution1D_PieceDensity(&dist->marginal, row)
+           * Distribution1D_PieceDensity(&dist->conditional[row], column);
+}
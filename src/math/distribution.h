@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "math/vec.h"
+
+// Piecewise constant distributions for importance sampling tabulated functions (e.g. the luminance of an image)
+// see: https://pbr-book.org/3ed-2018/Monte_Carlo_Integration/2D_Sampling_with_Multidimensional_Transformations
+
+// Distribution over [0, 1) proportional to func, func[ii] covers [ii / count, (ii + 1) / count)
+typedef struct {
+    f32*   func;
+    f32*   cdf; // count + 1 entries
+    size_t count;
+    f32    integral;
+} Distribution1D;
+
+// Distribution over [0, 1)^2 proportional to func (width x height, row major), picks a row (v) then a column (u)
+typedef struct {
+    Distribution1D* conditional; // one per row
+    Distribution1D  marginal;
+    size_t          width, height;
+} Distribution2D;
+
+bool Distribution1D_Init(Distribution1D* dist, const f32* func, size_t count);
+void Distribution1D_Uninit(Distribution1D* dist);
+
+// Maps a uniform u to a sample in [0, 1), also giving its density and the index of the piece it landed in
+f32 Distribution1D_Sample(Distribution1D* dist, f32 u, f32* pdf, size_t* offset);
+
+bool Distribution2D_Init(Distribution2D* dist, const f32* func, size_t width, size_t height);
+void Distribution2D_Uninit(Distribution2D* dist);
+
+point2 Distribution2D_Sample(Distribution2D* dist, point2 u, f32* pdf);
+f32    Distribution2D_PDF(Distribution2D* dist, point2 uv);
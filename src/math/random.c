@@ -84,6 +84,22 @@ void Random_Seed(u64 s1, u64 s2)
     jump();
 }
 
+intern inline u64 SplitMix64(u64 x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Reproducible seed for one of many streams under a key (e.g. a unit of work within a render), so the values drawn
+// depend on the work rather than on which thread does it or what it did before
+void Random_Seed_Stream(u64 key, u64 stream)
+{
+    u64 mixed = SplitMix64(key ^ SplitMix64(stream));
+    Random_Seed(mixed, SplitMix64(mixed));
+}
+
 // WARNING: non-deterministic runtime
 void Random_Seed_HighEntropy(void)
 {
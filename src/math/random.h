@@ -6,6 +6,7 @@
 
 void Random_Seed(u64 s1, u64 s2);
 void Random_Seed_HighEntropy(void);
+void Random_Seed_Stream(u64 key, u64 stream);
 
 f32 Random_Unilateral(void);
 f32 Random_Bilateral(void);
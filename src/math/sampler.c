@@ -0,0 +1,263 @@
+#include "sampler.h"
+
+#include <math.h>
+
+#include "math/math.h"
+#include "math/random.h"
+
+intern thread_local Sampler* g_sampler = NULL;
+
+/* ---- Hashing ---- */
+
+// see: https://nullprogram.com/blog/2018/07/31/ (lowbias32)
+intern inline u32 Hash_Mix(u32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+intern inline u32 Hash_Combine(u32 seed, u32 value)
+{
+    return Hash_Mix(seed ^ Hash_Mix(value + 0x9E3779B9u));
+}
+
+// [0, 1) from the top 24 bits
+intern inline f32 Sampler_ToUnit(u32 bits)
+{
+    return (f32)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+/* ---- Stratified ---- */
+
+// Permutation of [0, len) picked by seed, see: https://graphics.pixar.com/library/MultiJitteredSampling/paper.pdf
+intern u32 Permute(u32 ii, u32 len, u32 seed)
+{
+    u32 mask = len - 1;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+
+    do {
+        ii ^= seed;
+        ii *= 0xE170893Du;
+        ii ^= seed >> 16;
+        ii ^= (ii & mask) >> 4;
+        ii ^= seed >> 8;
+        ii *= 0x0929EB3Fu;
+        ii ^= seed >> 23;
+        ii ^= (ii & mask) >> 1;
+        ii *= 1 | seed >> 27;
+        ii *= 0x6935FA69u;
+        ii ^= (ii & mask) >> 11;
+        ii *= 0x74DCB303u;
+        ii ^= (ii & mask) >> 2;
+        ii *= 0x9E501CC3u;
+        ii ^= (ii & mask) >> 2;
+        ii *= 0xC860A3DFu;
+        ii &= mask;
+        ii ^= ii >> 5;
+    } while (ii >= len);
+
+    return (ii + seed) % len;
+}
+
+/* ---- Random ---- */
+
+intern inline f32 Random_Sample(Sampler* sampler, u32 seed)
+{
+    return Sampler_ToUnit(Hash_Combine(seed, sampler->index));
+}
+
+/* ---- Stratified ---- */
+
+intern inline f32 Stratified_Sample(Sampler* sampler, u32 seed)
+{
+    u32 stratum = Permute(sampler->index, sampler->num_samples, seed);
+    f32 jitter  = Sampler_ToUnit(Hash_Combine(seed, sampler->index));
+
+    return minf((stratum + jitter) / (f32)sampler->num_samples, 1.0f - EPSILON);
+}
+
+/* ---- Sobol ---- */
+
+// see: https://jcgt.org/published/0009/04/01/paper.pdf (Practical Hash-based Owen Scrambling)
+
+intern inline u32 Sobol_Dim0(u32 index)
+{
+    return __builtin_bitreverse32(index);
+}
+
+intern inline u32 Sobol_Dim1(u32 index)
+{
+    u32 result = 0;
+    for (u32 v = 1u << 31; index; index >>= 1, v ^= v >> 1) {
+        if (index & 1) {
+            result ^= v;
+        }
+    }
+
+    return result;
+}
+
+intern inline u32 LaineKarras_Permutation(u32 x, u32 seed)
+{
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return x;
+}
+
+intern inline u32 NestedUniformScramble(u32 x, u32 seed)
+{
+    x = __builtin_bitreverse32(x);
+    x = LaineKarras_Permutation(x, seed);
+    x = __builtin_bitreverse32(x);
+    return x;
+}
+
+// Each dimension shuffles the sample order independently, so every dimension (or pair) is a well spread set on its own
+// without needing high dimensional Sobol matrices
+intern inline u32 Sobol_ShuffledIndex(Sampler* sampler, u32 seed)
+{
+    return NestedUniformScramble(sampler->index, Hash_Combine(seed, 0));
+}
+
+/* ---- Sampler ---- */
+
+Sampler Sampler_Make(SamplerType type, u32 seed, u32 pixel_x, u32 pixel_y, u32 index, u32 num_samples)
+{
+    return (Sampler){
+        .type          = type,
+        .seed          = Hash_Combine(Hash_Combine(Hash_Mix(seed), pixel_x), pixel_y),
+        .index         = index,
+        .num_samples   = num_samples,
+        .dimension     = 0,
+        .dimension_end = SAMPLER_DIMS_CAMERA,
+        .fallback      = 0,
+    };
+}
+
+void Sampler_Bind(Sampler* sampler)
+{
+    g_sampler = sampler;
+}
+
+void Sampler_StartBounce(u32 bounce)
+{
+    if (g_sampler == NULL) {
+        return;
+    }
+
+    g_sampler->dimension     = SAMPLER_DIMS_CAMERA + bounce * SAMPLER_DIMS_PER_BOUNCE;
+    g_sampler->dimension_end = g_sampler->dimension + SAMPLER_DIMS_PER_BOUNCE;
+}
+
+// Seed of the next dimension and the type of sampling it gets, draws past the dimensions the sampler was given get
+// their own seeds (so they're never reused) and plain uniform values
+intern inline SamplerType Sampler_NextDimension(Sampler* sampler, u32* seed)
+{
+    if (sampler->dimension >= sampler->dimension_end) {
+        *seed = Hash_Combine(sampler->seed, 0x80000000u | sampler->fallback++);
+        return SAMPLER_RANDOM;
+    }
+
+    *seed = Hash_Combine(sampler->seed, sampler->dimension++);
+
+    // the stratified sampler only has strata for the samples it was told about
+    if (sampler->type == SAMPLER_STRATIFIED && sampler->index >= sampler->num_samples) {
+        return SAMPLER_RANDOM;
+    }
+
+    return sampler->type;
+}
+
+f32 Sampler_1D(void)
+{
+    if (g_sampler == NULL) {
+        return Random_Unilateral();
+    }
+
+    u32 seed;
+    switch (Sampler_NextDimension(g_sampler, &seed)) {
+        case SAMPLER_STRATIFIED: {
+            return Stratified_Sample(g_sampler, seed);
+        } break;
+
+        case SAMPLER_SOBOL: {
+            u32 index = Sobol_ShuffledIndex(g_sampler, seed);
+            return Sampler_ToUnit(NestedUniformScramble(Sobol_Dim0(index), Hash_Combine(seed, 1)));
+        } break;
+
+        case SAMPLER_RANDOM: {
+            return Random_Sample(g_sampler, seed);
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+point2 Sampler_2D(void)
+{
+    if (g_sampler == NULL) {
+        return (point2){.u = Random_Unilateral(), .v = Random_Unilateral()};
+    }
+
+    u32 seed;
+    switch (Sampler_NextDimension(g_sampler, &seed)) {
+        case SAMPLER_STRATIFIED: {
+            return (point2){
+                .u = Stratified_Sample(g_sampler, Hash_Combine(seed, 1)),
+                .v = Stratified_Sample(g_sampler, Hash_Combine(seed, 2)),
+            };
+        } break;
+
+        case SAMPLER_SOBOL: {
+            u32 index = Sobol_ShuffledIndex(g_sampler, seed);
+            return (point2){
+                .u = Sampler_ToUnit(NestedUniformScramble(Sobol_Dim0(index), Hash_Combine(seed, 1))),
+                .v = Sampler_ToUnit(NestedUniformScramble(Sobol_Dim1(index), Hash_Combine(seed, 2))),
+            };
+        } break;
+
+        case SAMPLER_RANDOM: {
+            return (point2){
+                .u = Random_Sample(g_sampler, Hash_Combine(seed, 1)),
+                .v = Random_Sample(g_sampler, Hash_Combine(seed, 2)),
+            };
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+// Concentric mapping, keeps the stratification of the square
+// see: https://psgraphics.blogspot.com/2011/01/improved-code-for-concentric-map.html
+vec2 Sampler_InDisc(f32 radius)
+{
+    point2 uv = Sampler_2D();
+    f32    a  = 2.0f * uv.u - 1.0f;
+    f32    b  = 2.0f * uv.v - 1.0f;
+
+    if (a == 0.0f && b == 0.0f) {
+        return (vec2){.x = 0.0f, .y = 0.0f};
+    }
+
+    f32 r, phi;
+    if (a * a > b * b) {
+        r   = a;
+        phi = (PI32 / 4.0f) * (b / a);
+    } else {
+        r   = b;
+        phi = (PI32 / 2.0f) - (PI32 / 4.0f) * (a / b);
+    }
+
+    return (vec2){.x = radius * r * cosf(phi), .y = radius * r * sinf(phi)};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "math/vec.h"
+
+// Sample values for the renderer, handed out per pixel, per sample, per dimension so that the samples of a pixel are
+// spread evenly over each dimension (rather than independently drawn like Random_Unilateral)
+// A sampler is bound to the calling thread, code deep in the path (materials, lights) draws from whichever sampler is
+// bound, and from Random_Unilateral if none is
+// Every value is a pure function of (seed, pixel, sample index, dimension), so a render doesn't depend on which thread
+// took which sample
+
+typedef enum {
+    SAMPLER_RANDOM,     // independent uniform draws (hashed, not from the thread's generator)
+    SAMPLER_STRATIFIED, // one jittered stratum per sample in each dimension (2D draws are latin hypercube samples)
+    SAMPLER_SOBOL,      // Owen scrambled Sobol (0, 2)-sequence, padded across dimensions, progressive in the index
+} SamplerType;
+
+// Dimensions are handed out in order, each bounce gets its own fixed range of them so the same decision on different
+// samples of a pixel draws from the same dimension, draws past the end of the range fall back to SAMPLER_RANDOM
+#define SAMPLER_DIMS_CAMERA     (2) // pixel position, lens position
+#define SAMPLER_DIMS_PER_BOUNCE (6) // light pick, light tree, point on light, lobe pick, bsdf direction, fresnel
+
+typedef struct {
+    SamplerType type;
+    u32         seed;        // per render and pixel
+    u32         index;       // sample index within the pixel
+    u32         num_samples; // samples the pixel gets in total (the strata count for SAMPLER_STRATIFIED)
+    u32         dimension;
+    u32         dimension_end;
+    u32         fallback; // draws made past the end of a dimension range so far
+} Sampler;
+
+// Starts sample index of a pixel, with the camera dimensions up next
+Sampler Sampler_Make(SamplerType type, u32 seed, u32 pixel_x, u32 pixel_y, u32 index, u32 num_samples);
+
+// Binds the sampler to the calling thread (NULL unbinds), the sampler must outlive the binding
+void Sampler_Bind(Sampler* sampler);
+
+// Moves the bound sampler to the dimensions of a bounce of the path
+void Sampler_StartBounce(u32 bounce);
+
+f32    Sampler_1D(void);
+point2 Sampler_2D(void);
+
+// Uniform point in a disc, from a 2D draw
+vec2 Sampler_InDisc(f32 radius);
@@ -0,0 +1,180 @@
+#include "platform/net.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+typedef struct Socket {
+    int fd;
+} Socket;
+
+intern Socket* Socket_Wrap(int fd)
+{
+    Socket* sock = (Socket*)malloc(sizeof(Socket));
+    if (sock == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    sock->fd = fd;
+    return sock;
+}
+
+// Applies to both ends of a connection
+intern void Socket_Configure(int fd)
+{
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    int keepalive = 1;
+    int idle      = DIST_KEEPALIVE_IDLE_S;
+    int interval  = DIST_KEEPALIVE_INTERVAL_S;
+    int probes    = DIST_KEEPALIVE_PROBES;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+}
+
+Socket* Socket_Listen(u16 port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    // a restarted coordinator shouldn't have to wait out TIME_WAIT on its port
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl(INADDR_ANY);
+    addr.sin_port           = htons(port);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    return Socket_Wrap(fd);
+}
+
+Socket* Socket_Accept(Socket* listener, u64 timeout_ms)
+{
+    struct pollfd pfd = {.fd = listener->fd, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, (int)timeout_ms) <= 0) {
+        return NULL;
+    }
+
+    int fd = accept(listener->fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    Socket_Configure(fd);
+
+    return Socket_Wrap(fd);
+}
+
+Socket* Socket_Connect(const char* host, u16 port)
+{
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", (unsigned)port);
+
+    struct addrinfo hints = {0};
+    hints.ai_family       = AF_UNSPEC;
+    hints.ai_socktype     = SOCK_STREAM;
+
+    struct addrinfo* addrs;
+    if (getaddrinfo(host, port_str, &hints, &addrs) != 0) {
+        return NULL;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* addr = addrs; addr != NULL; addr = addr->ai_next) {
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(addrs);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    Socket_Configure(fd);
+
+    return Socket_Wrap(fd);
+}
+
+void Socket_Close(Socket* sock)
+{
+    close(sock->fd);
+    free(sock);
+}
+
+void Socket_Shutdown(Socket* sock)
+{
+    shutdown(sock->fd, SHUT_RDWR);
+}
+
+bool Socket_SetRecvTimeout(Socket* sock, u64 timeout_ms)
+{
+    struct timeval timeout = {
+        .tv_sec  = (time_t)(timeout_ms / 1000),
+        .tv_usec = (suseconds_t)(timeout_ms % 1000) * 1000,
+    };
+
+    return setsockopt(sock->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+bool Socket_Send(Socket* sock, const void* data, size_t size)
+{
+    const u8* bytes = (const u8*)data;
+
+    while (size > 0) {
+        // a peer that died shouldn't take this process down with SIGPIPE
+        ssize_t sent = send(sock->fd, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+
+    return true;
+}
+
+bool Socket_Recv(Socket* sock, void* data, size_t size)
+{
+    u8* bytes = (u8*)data;
+
+    while (size > 0) {
+        ssize_t received = recv(sock->fd, bytes, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+
+        bytes += received;
+        size -= (size_t)received;
+    }
+
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "platform/numa.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+// Reads a sysfs list (e.g. "0-7,16-23") into a set
+intern bool Numa_ReadList(const char* path, cpu_set_t* set)
+{
+    CPU_ZERO(set);
+
+    FILE* fd = fopen(path, "r");
+    if (fd == NULL) {
+        return false;
+    }
+
+    unsigned first, last;
+    bool     read_any = false;
+
+    while (fscanf(fd, "%u", &first) == 1) {
+        last = first;
+
+        int sep = fgetc(fd);
+        if (sep == '-') {
+            if (fscanf(fd, "%u", &last) != 1) {
+                break;
+            }
+
+            sep = fgetc(fd);
+        }
+
+        for (unsigned ii = first; ii <= last && ii < CPU_SETSIZE; ii++) {
+            CPU_SET(ii, set);
+        }
+
+        read_any = true;
+
+        if (sep != ',') {
+            break;
+        }
+    }
+
+    fclose(fd);
+    return read_any;
+}
+
+// The OS's id for the node'th node with processors, -1 if there's no such node
+intern int Numa_NodeId(size_t node)
+{
+    cpu_set_t nodes;
+    if (!Numa_ReadList("/sys/devices/system/node/has_cpu", &nodes)) {
+        return -1;
+    }
+
+    for (int id = 0; id < CPU_SETSIZE; id++) {
+        if (CPU_ISSET(id, &nodes) && node-- == 0) {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+intern bool Numa_NodeCPUSet(size_t node, cpu_set_t* cpus)
+{
+    int id = Numa_NodeId(node);
+    if (id < 0) {
+        return false;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+
+    return Numa_ReadList(path, cpus);
+}
+
+size_t Numa_NodeCount(void)
+{
+    cpu_set_t nodes;
+    if (!Numa_ReadList("/sys/devices/system/node/has_cpu", &nodes)) {
+        return 1;
+    }
+
+    return MAX((size_t)CPU_COUNT(&nodes), (size_t)1);
+}
+
+size_t Numa_NodeCPUs(size_t node)
+{
+    cpu_set_t cpus;
+    if (!Numa_NodeCPUSet(node, &cpus)) {
+        return 0;
+    }
+
+    return CPU_COUNT(&cpus);
+}
+
+bool Numa_Bind(size_t node)
+{
+    cpu_set_t cpus;
+    if (!Numa_NodeCPUSet(node, &cpus)) {
+        return false;
+    }
+
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+void* Numa_Alloc(size_t size)
+{
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void Numa_Free(void* ptr, size_t size)
+{
+    if (ptr != NULL) {
+        munmap(ptr, size);
+    }
+}
@@ -1,6 +1,11 @@
 #include "platform/profiling.h"
 
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <time.h>
+#include <unistd.h>
 
 typedef struct Stopwatch {
     struct timespec start_time;
@@ -58,3 +63,87 @@ i64 Stopwatch_Elapsed(Stopwatch* stopwatch, Stopwatch_Timescale timescale)
             return -1;
     }
 }
+
+typedef struct PerfCounter {
+    int fd_references;
+    int fd_misses;
+} PerfCounter;
+
+intern int PerfCounter_Open(u64 config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    // calling thread, any cpu
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounter* PerfCounter_New(void)
+{
+    PerfCounter* counter = (PerfCounter*)calloc(1, sizeof(PerfCounter));
+    if (counter == NULL) {
+        goto error_Counter;
+    }
+
+    counter->fd_references = PerfCounter_Open(PERF_COUNT_HW_CACHE_REFERENCES);
+    if (counter->fd_references < 0) {
+        goto error_References;
+    }
+
+    counter->fd_misses = PerfCounter_Open(PERF_COUNT_HW_CACHE_MISSES);
+    if (counter->fd_misses < 0) {
+        goto error_Misses;
+    }
+
+    return counter;
+
+error_Misses:
+    close(counter->fd_references);
+error_References:
+    free(counter);
+error_Counter:
+    return NULL;
+}
+
+void PerfCounter_Delete(PerfCounter* counter)
+{
+    close(counter->fd_misses);
+    close(counter->fd_references);
+    free(counter);
+}
+
+void PerfCounter_Start(PerfCounter* counter)
+{
+    ioctl(counter->fd_references, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter->fd_misses, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter->fd_references, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(counter->fd_misses, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void PerfCounter_Stop(PerfCounter* counter)
+{
+    ioctl(counter->fd_misses, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(counter->fd_references, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+PerfCounts PerfCounter_Read(PerfCounter* counter)
+{
+    PerfCounts counts = {.cache_references = 0, .cache_misses = 0};
+
+    if (read(counter->fd_references, &counts.cache_references, sizeof(u64)) != sizeof(u64)) {
+        counts.cache_references = 0;
+    }
+
+    if (read(counter->fd_misses, &counts.cache_misses, sizeof(u64)) != sizeof(u64)) {
+        counts.cache_misses = 0;
+    }
+
+    return counts;
+}
@@ -8,6 +8,14 @@ typedef struct Thread {
     pthread_attr_t thread_attr;
 } Thread;
 
+typedef struct Mutex {
+    pthread_mutex_t mutex;
+} Mutex;
+
+typedef struct Condition {
+    pthread_cond_t cond;
+} Condition;
+
 typedef struct ThreadArg {
     void* user_arg;
     void (*user_func)(void* arg);
@@ -86,3 +94,81 @@ void Thread_Kill(Thread* thread)
     // TODO: change to pthread_kill
     pthread_cancel(thread->thread);
 }
+
+Mutex* Mutex_New(void)
+{
+    Mutex* mutex = (Mutex*)calloc(1, sizeof(Mutex));
+    if (mutex == NULL) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&mutex->mutex, NULL)) {
+        free(mutex);
+        return NULL;
+    }
+
+    return mutex;
+}
+
+void Mutex_Delete(Mutex* mutex)
+{
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+void Mutex_Lock(Mutex* mutex)
+{
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void Mutex_Unlock(Mutex* mutex)
+{
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+Condition* Condition_New(void)
+{
+    Condition* cond = (Condition*)calloc(1, sizeof(Condition));
+    if (cond == NULL) {
+        return NULL;
+    }
+
+    if (pthread_cond_init(&cond->cond, NULL)) {
+        free(cond);
+        return NULL;
+    }
+
+    return cond;
+}
+
+void Condition_Delete(Condition* cond)
+{
+    pthread_cond_destroy(&cond->cond);
+    free(cond);
+}
+
+void Condition_Wait(Condition* cond, Mutex* mutex)
+{
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+void Condition_Signal(Condition* cond)
+{
+    pthread_cond_signal(&cond->cond);
+}
+
+void Condition_Broadcast(Condition* cond)
+{
+    pthread_cond_broadcast(&cond->cond);
+}
+
+void* Aligned_Alloc(size_t alignment, size_t size)
+{
+    // aligned_alloc wants a size that's a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void Aligned_Free(void* ptr)
+{
+    free(ptr);
+}
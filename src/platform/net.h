@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Blocking TCP streams, just what the distributed renderer needs
+// Connections are kept alive (see DIST_KEEPALIVE_IDLE_S), so a peer that goes away without closing them fails the
+// send/recv waiting on it rather than leaving it blocked
+typedef struct Socket Socket;
+
+Socket* Socket_Listen(u16 port); // on every interface
+Socket* Socket_Accept(Socket* listener, u64 timeout_ms); // NULL if nothing connected within the timeout (or on error)
+Socket* Socket_Connect(const char* host, u16 port);
+void    Socket_Close(Socket* sock);
+
+// Fails any send/recv blocked on the socket (from another thread), it still has to be closed afterwards
+void Socket_Shutdown(Socket* sock);
+
+// Fails a recv that waits longer than timeout_ms for data (0 waits forever), the socket should be closed after one
+bool Socket_SetRecvTimeout(Socket* sock, u64 timeout_ms);
+
+// Both transfer all size bytes or fail (the peer closing the connection is a failure)
+bool Socket_Send(Socket* sock, const void* data, size_t size);
+bool Socket_Recv(Socket* sock, void* data, size_t size);
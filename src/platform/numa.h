@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// NUMA topology and memory placement, a machine without NUMA (or whose topology can't be read) is a single node
+// Nodes are numbered from 0 to Numa_NodeCount() - 1 in the order the OS lists them, only nodes with processors count
+size_t Numa_NodeCount(void);
+size_t Numa_NodeCPUs(size_t node); // number of logical processors on the node
+
+// Restricts the calling thread to the node's processors, memory it touches first is then placed on the node
+bool Numa_Bind(size_t node);
+
+// Page aligned memory straight from the OS, its pages aren't placed until they're first written (so they land on the
+// node of the thread that does it), size must be the same when it's freed
+void* Numa_Alloc(size_t size);
+void  Numa_Free(void* ptr, size_t size);
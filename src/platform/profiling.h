@@ -15,6 +15,20 @@ void       Stopwatch_Start(Stopwatch* stopwatch);
 void       Stopwatch_Stop(Stopwatch* stopwatch);
 i64        Stopwatch_Elapsed(Stopwatch* stopwatch, Stopwatch_Timescale timescale);
 
+// Hardware cache counters for the calling thread, used to measure memory behaviour (e.g. kd-tree traversal)
+typedef struct PerfCounter PerfCounter;
+
+typedef struct {
+    u64 cache_references;
+    u64 cache_misses;
+} PerfCounts;
+
+PerfCounter* PerfCounter_New(void); // NULL if the platform doesn't expose hardware counters
+void         PerfCounter_Delete(PerfCounter* counter);
+void         PerfCounter_Start(PerfCounter* counter);
+void         PerfCounter_Stop(PerfCounter* counter);
+PerfCounts   PerfCounter_Read(PerfCounter* counter);
+
 intern const char* Stopwatch_Units[] = {
     [STOPWATCH_SECONDS]      = "s",
     [STOPWATCH_MILISECONDS]  = "ms",
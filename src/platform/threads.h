@@ -3,7 +3,9 @@
 #include <stdbool.h>
 #include <stddef.h>
 
-typedef struct Thread Thread;
+typedef struct Thread    Thread;
+typedef struct Mutex     Mutex;
+typedef struct Condition Condition;
 
 Thread* Thread_New(void);
 void    Thread_Delete(Thread* thread);
@@ -12,3 +14,20 @@ bool Thread_Spawn(Thread* thread, void (*entry)(void* arg), void* thread_arg);
 bool Thread_Set_StackSize(Thread* thread, size_t stack_size);
 void Thread_Join(Thread* thread);
 void Thread_Kill(Thread* thread);
+
+Mutex* Mutex_New(void);
+void   Mutex_Delete(Mutex* mutex);
+
+void Mutex_Lock(Mutex* mutex);
+void Mutex_Unlock(Mutex* mutex);
+
+Condition* Condition_New(void);
+void       Condition_Delete(Condition* cond);
+
+void Condition_Wait(Condition* cond, Mutex* mutex);
+void Condition_Signal(Condition* cond);
+void Condition_Broadcast(Condition* cond);
+
+// Memory aligned to alignment (a power of 2), freed with Aligned_Free since the Windows CRT has no aligned_alloc
+void* Aligned_Alloc(size_t alignment, size_t size);
+void  Aligned_Free(void* ptr);
@@ -0,0 +1,206 @@
+#include "platform/net.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+// needs winsock2.h first
+#include <mstcpip.h>
+
+typedef struct Socket {
+    SOCKET handle;
+} Socket;
+
+// winsock has to be started before anything else touches it, it's left running until the process exits
+intern bool Net_Init(void)
+{
+    static bool initialized = false;
+    if (initialized) {
+        return true;
+    }
+
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        return false;
+    }
+
+    initialized = true;
+    return true;
+}
+
+intern Socket* Socket_Wrap(SOCKET handle)
+{
+    Socket* sock = (Socket*)malloc(sizeof(Socket));
+    if (sock == NULL) {
+        closesocket(handle);
+        return NULL;
+    }
+
+    sock->handle = handle;
+    return sock;
+}
+
+// Applies to both ends of a connection
+intern void Socket_Configure(SOCKET handle)
+{
+    BOOL nodelay = TRUE;
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+
+    struct tcp_keepalive keepalive = {
+        .onoff             = 1,
+        .keepalivetime     = DIST_KEEPALIVE_IDLE_S * 1000,
+        .keepaliveinterval = DIST_KEEPALIVE_INTERVAL_S * 1000,
+    };
+
+    // the probe count is fixed by the system (10 since Vista)
+    DWORD returned;
+    WSAIoctl(handle, SIO_KEEPALIVE_VALS, &keepalive, sizeof(keepalive), NULL, 0, &returned, NULL, NULL);
+}
+
+Socket* Socket_Listen(u16 port)
+{
+    if (!Net_Init()) {
+        return NULL;
+    }
+
+    SOCKET handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == INVALID_SOCKET) {
+        return NULL;
+    }
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl(INADDR_ANY);
+    addr.sin_port           = htons(port);
+
+    if (bind(handle, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(handle, SOMAXCONN) != 0) {
+        closesocket(handle);
+        return NULL;
+    }
+
+    return Socket_Wrap(handle);
+}
+
+Socket* Socket_Accept(Socket* listener, u64 timeout_ms)
+{
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(listener->handle, &readable);
+
+    struct timeval timeout = {
+        .tv_sec  = (long)(timeout_ms / 1000),
+        .tv_usec = (long)(timeout_ms % 1000) * 1000,
+    };
+
+    if (select(0, &readable, NULL, NULL, &timeout) <= 0) {
+        return NULL;
+    }
+
+    SOCKET handle = accept(listener->handle, NULL, NULL);
+    if (handle == INVALID_SOCKET) {
+        return NULL;
+    }
+
+    Socket_Configure(handle);
+
+    return Socket_Wrap(handle);
+}
+
+Socket* Socket_Connect(const char* host, u16 port)
+{
+    if (!Net_Init()) {
+        return NULL;
+    }
+
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", (unsigned)port);
+
+    struct addrinfo hints = {0};
+    hints.ai_family       = AF_UNSPEC;
+    hints.ai_socktype     = SOCK_STREAM;
+    hints.ai_protocol     = IPPROTO_TCP;
+
+    struct addrinfo* addrs;
+    if (getaddrinfo(host, port_str, &hints, &addrs) != 0) {
+        return NULL;
+    }
+
+    SOCKET handle = INVALID_SOCKET;
+    for (struct addrinfo* addr = addrs; addr != NULL; addr = addr->ai_next) {
+        handle = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (handle == INVALID_SOCKET) {
+            continue;
+        }
+
+        if (connect(handle, addr->ai_addr, (int)addr->ai_addrlen) == 0) {
+            break;
+        }
+
+        closesocket(handle);
+        handle = INVALID_SOCKET;
+    }
+
+    freeaddrinfo(addrs);
+
+    if (handle == INVALID_SOCKET) {
+        return NULL;
+    }
+
+    Socket_Configure(handle);
+
+    return Socket_Wrap(handle);
+}
+
+void Socket_Close(Socket* sock)
+{
+    closesocket(sock->handle);
+    free(sock);
+}
+
+void Socket_Shutdown(Socket* sock)
+{
+    shutdown(sock->handle, SD_BOTH);
+}
+
+bool Socket_SetRecvTimeout(Socket* sock, u64 timeout_ms)
+{
+    DWORD timeout = (DWORD)timeout_ms;
+    return setsockopt(sock->handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout)) == 0;
+}
+
+bool Socket_Send(Socket* sock, const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+
+    while (size > 0) {
+        int chunk = (int)MIN(size, (size_t)INT32_MAX);
+        int sent  = send(sock->handle, bytes, chunk, 0);
+        if (sent <= 0) {
+            return false;
+        }
+
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+
+    return true;
+}
+
+bool Socket_Recv(Socket* sock, void* data, size_t size)
+{
+    char* bytes = (char*)data;
+
+    while (size > 0) {
+        int chunk    = (int)MIN(size, (size_t)INT32_MAX);
+        int received = recv(sock->handle, bytes, chunk, 0);
+        if (received <= 0) {
+            return false;
+        }
+
+        bytes += received;
+        size -= (size_t)received;
+    }
+
+    return true;
+}
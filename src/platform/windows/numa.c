@@ -0,0 +1,66 @@
+#include "platform/numa.h"
+
+#include <windows.h>
+
+// The processors of the node'th node that has any
+intern bool Numa_NodeAffinity(size_t node, GROUP_AFFINITY* affinity)
+{
+    ULONG highest;
+    if (!GetNumaHighestNodeNumber(&highest)) {
+        return false;
+    }
+
+    for (ULONG id = 0; id <= highest; id++) {
+        if (GetNumaNodeProcessorMaskEx((USHORT)id, affinity) && affinity->Mask != 0 && node-- == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t Numa_NodeCount(void)
+{
+    size_t         count = 0;
+    GROUP_AFFINITY affinity;
+
+    while (Numa_NodeAffinity(count, &affinity)) {
+        count += 1;
+    }
+
+    return MAX(count, (size_t)1);
+}
+
+size_t Numa_NodeCPUs(size_t node)
+{
+    GROUP_AFFINITY affinity;
+    if (!Numa_NodeAffinity(node, &affinity)) {
+        return 0;
+    }
+
+    return __builtin_popcountll(affinity.Mask);
+}
+
+bool Numa_Bind(size_t node)
+{
+    GROUP_AFFINITY affinity;
+    if (!Numa_NodeAffinity(node, &affinity)) {
+        return false;
+    }
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+}
+
+void* Numa_Alloc(size_t size)
+{
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void Numa_Free(void* ptr, size_t size)
+{
+    (void)size;
+
+    if (ptr != NULL) {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+}
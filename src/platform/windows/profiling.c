@@ -58,3 +58,34 @@ i64 Stopwatch_Elapsed(Stopwatch* stopwatch, Stopwatch_Timescale timescale)
 
     return 0;
 }
+
+// TODO: hardware counters on windows need a kernel driver (or ETW with admin rights), unsupported for now
+typedef struct PerfCounter {
+    u8 unused;
+} PerfCounter;
+
+PerfCounter* PerfCounter_New(void)
+{
+    return NULL;
+}
+
+void PerfCounter_Delete(PerfCounter* counter)
+{
+    free(counter);
+}
+
+void PerfCounter_Start(PerfCounter* counter)
+{
+    (void)counter;
+}
+
+void PerfCounter_Stop(PerfCounter* counter)
+{
+    (void)counter;
+}
+
+PerfCounts PerfCounter_Read(PerfCounter* counter)
+{
+    (void)counter;
+    return (PerfCounts){.cache_references = 0, .cache_misses = 0};
+}
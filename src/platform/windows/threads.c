@@ -1,5 +1,6 @@
 #include "platform/threads.h"
 
+#include <malloc.h>
 #include <stdlib.h>
 #include <windows.h>
 
@@ -8,6 +9,14 @@ typedef struct ThreadArg {
     void (*user_func)(void* arg);
 } ThreadArg;
 
+typedef struct Mutex {
+    SRWLOCK lock;
+} Mutex;
+
+typedef struct Condition {
+    CONDITION_VARIABLE cond;
+} Condition;
+
 typedef struct Thread {
     HANDLE     handle;
     size_t     stack_size;
@@ -83,3 +92,73 @@ void Thread_Kill(Thread* thread)
     TerminateThread(thread, 0);
     free(thread->arg);
 }
+
+Mutex* Mutex_New(void)
+{
+    Mutex* mutex = (Mutex*)calloc(1, sizeof(Mutex));
+    if (mutex == NULL) {
+        return NULL;
+    }
+
+    InitializeSRWLock(&mutex->lock);
+
+    return mutex;
+}
+
+void Mutex_Delete(Mutex* mutex)
+{
+    // NOTE: SRW locks don't need to be destroyed
+    free(mutex);
+}
+
+void Mutex_Lock(Mutex* mutex)
+{
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void Mutex_Unlock(Mutex* mutex)
+{
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+Condition* Condition_New(void)
+{
+    Condition* cond = (Condition*)calloc(1, sizeof(Condition));
+    if (cond == NULL) {
+        return NULL;
+    }
+
+    InitializeConditionVariable(&cond->cond);
+
+    return cond;
+}
+
+void Condition_Delete(Condition* cond)
+{
+    free(cond);
+}
+
+void Condition_Wait(Condition* cond, Mutex* mutex)
+{
+    SleepConditionVariableSRW(&cond->cond, &mutex->lock, INFINITE, 0);
+}
+
+void Condition_Signal(Condition* cond)
+{
+    WakeConditionVariable(&cond->cond);
+}
+
+void Condition_Broadcast(Condition* cond)
+{
+    WakeAllConditionVariable(&cond->cond);
+}
+
+void* Aligned_Alloc(size_t alignment, size_t size)
+{
+    return _aligned_malloc(size, alignment);
+}
+
+void Aligned_Free(void* ptr)
+{
+    _aligned_free(ptr);
+}
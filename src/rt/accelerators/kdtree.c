@@ -450,6 +450,36 @@ void KDTree_Delete(KDTree* tree)
     free(tree);
 }
 
+KDTree* KDTree_Copy(KDTree* tree, Object* objs_from, Object* objs_to)
+{
+    KDTree* copy = (KDTree*)malloc(sizeof(KDTree));
+    if (copy == NULL) {
+        ABORT("Failed to alloc KDTree");
+    }
+
+    copy->nodes   = Vector_New(KDNode)(tree->nodes->length);
+    copy->objPtrs = Vector_New(ObjectPtr)(tree->objPtrs->length);
+
+    if (copy->nodes == NULL || copy->objPtrs == NULL) {
+        ABORT("Failed to create kd-tree vectors");
+    }
+
+    if (!Vector_Copy(tree->nodes, copy->nodes)) {
+        ABORT("Failed to copy kd-tree nodes");
+    }
+
+    for (size_t ii = 0; ii < tree->objPtrs->length; ii++) {
+        if (!Vector_Push(copy->objPtrs, objs_to + (tree->objPtrs->at[ii] - objs_from))) {
+            ABORT("Failed to copy kd-tree object pointers");
+        }
+    }
+
+    copy->worldBox  = tree->worldBox;
+    copy->rootIndex = tree->rootIndex;
+
+    return copy;
+}
+
 intern bool CheckHitLeafNode(KDTree* tree, KDLeaf* leaf, Ray* ray, Object** objHit, HitInfo* hit, f32 tMax);
 
 intern bool
@@ -575,3 +605,90 @@ bool KDTree_HitAt(KDTree* tree, Ray* ray, Object** objHit, HitInfo* hit)
     KDNode* root = &tree->nodes->at[tree->rootIndex];
     return CheckHitNextNode(tree, root, ray, objHit, hit, INF);
 }
+
+intern bool CheckOccludedInternalNode(KDTree* tree, KDInternal* node, Ray* ray, Axis axis, f32 tMax);
+
+intern bool CheckOccludedLeafNode(KDTree* tree, KDLeaf* leaf, Ray* ray, f32 tMax)
+{
+    for (size_t ii = 0; ii < leaf->len; ii++) {
+        HitInfo hit;
+        Object* obj = tree->objPtrs->at[leaf->objIndex + ii];
+
+        if (Surface_HitAt(&obj->surface, ray, RT_EPSILON, tMax, &hit)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+intern bool CheckOccludedNextNode(KDTree* tree, KDNode* node, Ray* ray, f32 tMax)
+{
+    switch (node->type) {
+        case KD_INTERNAL_X:
+        case KD_INTERNAL_Y:
+        case KD_INTERNAL_Z: {
+            return CheckOccludedInternalNode(tree, &node->inode, ray, (Axis)node->type, tMax);
+        }
+
+        case KD_LEAF: {
+            return CheckOccludedLeafNode(tree, &node->leaf, ray, tMax);
+        } break;
+    };
+
+    return false;
+}
+
+// Same walk as CheckHitInternalNode, but any hit under tMax ends it, the far side is only skipped when the plane is
+// past tMax
+intern bool CheckOccludedInternalNode(KDTree* tree, KDInternal* node, Ray* ray, Axis axis, f32 tMax)
+{
+    f32 split = node->split;
+
+    KDNode* left  = &tree->nodes->at[node->leftIndex];
+    KDNode* right = (KDNode*)node->right;
+
+    if (unlikely(fabsf(ray->dir.elem[axis]) < RT_EPSILON)) {
+        // ray parallel to plane, check the origin to see which side ray falls on
+        if (ray->origin.elem[axis] >= split) {
+            return CheckOccludedNextNode(tree, right, ray, tMax);
+        } else {
+            return CheckOccludedNextNode(tree, left, ray, tMax);
+        }
+    }
+
+    f32 tIntersect = split * ray->cache.invDir.elem[axis] - ray->cache.originDivDir.elem[axis];
+
+    if (tIntersect < RT_EPSILON) {
+        // ray doesn't intersect plane at valid t, check the origin to see which side ray falls on
+        if (likely(ray->origin.elem[axis] > split)) {
+            return CheckOccludedNextNode(tree, right, ray, tMax);
+        } else if (likely(ray->origin.elem[axis] < split)) {
+            return CheckOccludedNextNode(tree, left, ray, tMax);
+        } else {
+            // ray intersects the plane at the origin, eval the ray later and see what side it's on
+            f32 rayAt = Ray_At(ray, 100.0f).elem[axis];
+
+            if (rayAt >= split) {
+                return CheckOccludedNextNode(tree, right, ray, tMax);
+            } else {
+                return CheckOccludedNextNode(tree, left, ray, tMax);
+            }
+        }
+    }
+
+    KDNode* originSide   = ray->origin.elem[axis] >= split ? right : left;
+    KDNode* oppositeSide = ray->origin.elem[axis] >= split ? left : right;
+
+    if (CheckOccludedNextNode(tree, originSide, ray, minf(tMax, tIntersect))) {
+        return true;
+    }
+
+    return tIntersect <= tMax && CheckOccludedNextNode(tree, oppositeSide, ray, tMax);
+}
+
+bool KDTree_Occluded(KDTree* tree, Ray* ray, f32 tMax)
+{
+    KDNode* root = &tree->nodes->at[tree->rootIndex];
+    return CheckOccludedNextNode(tree, root, ray, tMax);
+}
@@ -8,4 +8,11 @@ typedef struct KDTree KDTree;
 
 KDTree* KDTree_New(Object* objs, size_t len);
 void    KDTree_Delete(KDTree* tree);
+
+// Copies the tree for a copy of the objects it was built over (objs_to has the objects of objs_from at the same
+// indices), the copy's memory is placed by the calling thread
+KDTree* KDTree_Copy(KDTree* tree, Object* objs_from, Object* objs_to);
 bool    KDTree_HitAt(KDTree* tree, Ray* ray, Object** objHit, HitInfo* hit);
+
+// Any-hit traversal for shadow rays, true as soon as an object is hit closer than tMax
+bool KDTree_Occluded(KDTree* tree, Ray* ray, f32 tMax);
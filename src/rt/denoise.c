@@ -0,0 +1,382 @@
+#include "denoise.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "math/math.h"
+#include "platform/threads.h"
+
+// Edge-stopping parameters: the normal weight is max(0, cos)^(2^DENOISE_NORMAL_POWER_LOG2), depths may differ by
+// DENOISE_SIGMA_DEPTH of the pixel's depth per pixel of step, and luminances by DENOISE_SIGMA_LUMINANCE times the
+// pixel's standard error
+#define DENOISE_NORMAL_POWER_LOG2 (7)
+#define DENOISE_SIGMA_DEPTH       (0.05f)
+#define DENOISE_SIGMA_LUMINANCE   (4.0f)
+
+// Albedo channels are clamped to this before the radiance is divided by them
+#define DENOISE_ALBEDO_FLOOR (0.01f)
+
+// Rows a thread claims at a time
+#define DENOISE_ROWS_PER_CLAIM (4)
+
+// illum (2 x 3), var (2), lum (2), normal (3), depth, mask
+#define DENOISE_NUM_PLANES (15)
+
+// Scratch rows per thread: sums (3), sum of weights, sum of variances, inverse sigmas (2)
+#define DENOISE_NUM_ROWS (7)
+
+// B3 spline, the a-trous kernel is its outer product
+intern const f32 Denoise_Kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+// Structure of arrays copy of the image, so the filter's inner loops run over contiguous floats and vectorize, the
+// illumination (radiance / albedo), its variance and luminance are ping-ponged between iterations
+typedef struct {
+    size_t width, height;
+
+    f32* illum[2][3];
+    f32* var[2];
+    f32* lum[2];
+    f32* nx;
+    f32* ny;
+    f32* nz;
+    f32* depth;
+    f32* mask; // 1 for pixels with samples, 0 otherwise
+
+    size_t num_iterations;
+
+    // threads claim rows from next_row, and meet at a barrier after each iteration
+    Mutex*     lock;
+    Condition* iteration_done;
+    size_t     num_threads;
+    size_t     num_arrived;
+    u64        barrier_gen;
+    size_t     next_row;
+} Denoiser;
+
+typedef struct {
+    f32* sum[3];
+    f32* sum_w;
+    f32* sum_var;
+    f32* inv_sigma_l;
+    f32* inv_sigma_z;
+} DenoiseRows;
+
+// exp(-x) for x >= 0 as (1 + x/16)^-16, close enough for a weight and unlike expf it vectorizes
+intern inline f32 Denoise_ExpNeg(f32 x)
+{
+    f32 e = 1.0f / (1.0f + x * (1.0f / 16.0f));
+    e *= e;
+    e *= e;
+    e *= e;
+    e *= e;
+    return e;
+}
+
+// Same as Color_Luminance
+intern inline f32 Denoise_Luminance(f32 r, f32 g, f32 b)
+{
+    return sqrtf(r * r + g * g + b * b) * (1.0f / sqrtf(3.0f));
+}
+
+intern Color Denoise_ClampAlbedo(Color albedo)
+{
+    return (Color){
+        .r = maxf(albedo.r, DENOISE_ALBEDO_FLOOR),
+        .g = maxf(albedo.g, DENOISE_ALBEDO_FLOOR),
+        .b = maxf(albedo.b, DENOISE_ALBEDO_FLOOR),
+    };
+}
+
+intern void Denoiser_Load(Denoiser* dn, DenoiseImage* image)
+{
+    size_t num_pixels = dn->width * dn->height;
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        vec3 normal = image->normal[ii];
+        f32  len    = vmag(normal);
+
+        if (image->variance[ii] < 0.0f || len == 0.0f) {
+            // left as they are and ignored by their neighbours
+            dn->illum[0][0][ii] = 0.0f;
+            dn->illum[0][1][ii] = 0.0f;
+            dn->illum[0][2][ii] = 0.0f;
+            dn->var[0][ii]      = 0.0f;
+            dn->lum[0][ii]      = 0.0f;
+            dn->nx[ii]          = 0.0f;
+            dn->ny[ii]          = 0.0f;
+            dn->nz[ii]          = 0.0f;
+            dn->depth[ii]       = 0.0f;
+            dn->mask[ii]        = 0.0f;
+            continue;
+        }
+
+        Color albedo   = Denoise_ClampAlbedo(image->albedo[ii]);
+        f32   lum_gain = 1.0f / Color_Luminance(albedo);
+        Color illum    = image->radiance[ii];
+
+        dn->illum[0][0][ii] = illum.r / albedo.r;
+        dn->illum[0][1][ii] = illum.g / albedo.g;
+        dn->illum[0][2][ii] = illum.b / albedo.b;
+        dn->var[0][ii]      = image->variance[ii] * lum_gain * lum_gain;
+        dn->lum[0][ii]      = Denoise_Luminance(dn->illum[0][0][ii], dn->illum[0][1][ii], dn->illum[0][2][ii]);
+        dn->nx[ii]          = normal.x / len;
+        dn->ny[ii]          = normal.y / len;
+        dn->nz[ii]          = normal.z / len;
+        dn->depth[ii]       = image->depth[ii];
+        dn->mask[ii]        = 1.0f;
+    }
+}
+
+intern void Denoiser_Store(Denoiser* dn, DenoiseImage* image, size_t src)
+{
+    size_t num_pixels = dn->width * dn->height;
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        if (dn->mask[ii] == 0.0f) {
+            continue;
+        }
+
+        Color albedo = Denoise_ClampAlbedo(image->albedo[ii]);
+
+        image->radiance[ii] = (Color){
+            .r = dn->illum[src][0][ii] * albedo.r,
+            .g = dn->illum[src][1][ii] * albedo.g,
+            .b = dn->illum[src][2][ii] * albedo.b,
+        };
+    }
+}
+
+// One a-trous iteration of row yy from the src planes into the others, the taps are step pixels apart
+// Each tap is a pass over the whole row (clipped to the taps that land in the image), so the inner loop has no
+// branches and reads every plane contiguously
+intern void Denoiser_FilterRow(Denoiser* dn, DenoiseRows* rows, size_t yy, size_t step, size_t src)
+{
+    size_t width = dn->width;
+    size_t row   = yy * width;
+    size_t dst   = src ^ 1;
+
+    const f32* r     = dn->illum[src][0];
+    const f32* g     = dn->illum[src][1];
+    const f32* b     = dn->illum[src][2];
+    const f32* var   = dn->var[src];
+    const f32* lum   = dn->lum[src];
+    const f32* nx    = dn->nx;
+    const f32* ny    = dn->ny;
+    const f32* nz    = dn->nz;
+    const f32* depth = dn->depth;
+    const f32* mask  = dn->mask;
+
+    f32* sum_r       = rows->sum[0];
+    f32* sum_g       = rows->sum[1];
+    f32* sum_b       = rows->sum[2];
+    f32* sum_w       = rows->sum_w;
+    f32* sum_var     = rows->sum_var;
+    f32* inv_sigma_l = rows->inv_sigma_l;
+    f32* inv_sigma_z = rows->inv_sigma_z;
+
+    for (size_t xx = 0; xx < width; xx++) {
+        size_t p = row + xx;
+
+        sum_r[xx]       = 0.0f;
+        sum_g[xx]       = 0.0f;
+        sum_b[xx]       = 0.0f;
+        sum_w[xx]       = 0.0f;
+        sum_var[xx]     = 0.0f;
+        inv_sigma_l[xx] = 1.0f / (DENOISE_SIGMA_LUMINANCE * sqrtf(var[p]) + RT_EPSILON);
+        inv_sigma_z[xx] = 1.0f / (DENOISE_SIGMA_DEPTH * (f32)step * depth[p] + RT_EPSILON);
+    }
+
+    for (i64 ky = -2; ky <= 2; ky++) {
+        i64 qy = (i64)yy + ky * (i64)step;
+        if (qy < 0 || qy >= (i64)dn->height) {
+            continue;
+        }
+
+        for (i64 kx = -2; kx <= 2; kx++) {
+            i64 offset = kx * (i64)step;
+            if (offset >= (i64)width || -offset >= (i64)width) {
+                continue;
+            }
+
+            size_t x0    = offset < 0 ? (size_t)-offset : 0;
+            size_t x1    = offset > 0 ? width - (size_t)offset : width;
+            size_t q_row = (size_t)qy * width + (size_t)offset; // wraps for negative offsets, q_row + x0 doesn't
+            f32    h     = Denoise_Kernel[ky + 2] * Denoise_Kernel[kx + 2];
+
+            // too many planes for the compiler to check for overlaps at runtime, so it's told none of them do
+#pragma clang loop vectorize(assume_safety)
+            for (size_t xx = x0; xx < x1; xx++) {
+                size_t p = row + xx;
+                size_t q = q_row + xx;
+
+                f32 cos_n = nx[p] * nx[q] + ny[p] * ny[q] + nz[p] * nz[q];
+                f32 w_n   = cos_n > 0.0f ? cos_n : 0.0f;
+                for (size_t ii = 0; ii < DENOISE_NORMAL_POWER_LOG2; ii++) {
+                    w_n *= w_n;
+                }
+
+                f32 d_z = fabsf(depth[p] - depth[q]) * inv_sigma_z[xx];
+                f32 d_l = fabsf(lum[p] - lum[q]) * inv_sigma_l[xx];
+                f32 w   = h * w_n * mask[q] * Denoise_ExpNeg(d_z + d_l);
+
+                sum_r[xx] += w * r[q];
+                sum_g[xx] += w * g[q];
+                sum_b[xx] += w * b[q];
+                sum_w[xx] += w;
+                sum_var[xx] += w * w * var[q];
+            }
+        }
+    }
+
+    for (size_t xx = 0; xx < width; xx++) {
+        size_t p = row + xx;
+
+        // pixels nothing was blended into (no samples, or escaped rays) keep their value
+        if (mask[p] == 0.0f || sum_w[xx] == 0.0f) {
+            dn->illum[dst][0][p] = r[p];
+            dn->illum[dst][1][p] = g[p];
+            dn->illum[dst][2][p] = b[p];
+            dn->var[dst][p]      = var[p];
+            dn->lum[dst][p]      = lum[p];
+            continue;
+        }
+
+        f32 inv_w = 1.0f / sum_w[xx];
+
+        dn->illum[dst][0][p] = sum_r[xx] * inv_w;
+        dn->illum[dst][1][p] = sum_g[xx] * inv_w;
+        dn->illum[dst][2][p] = sum_b[xx] * inv_w;
+        dn->var[dst][p]      = sum_var[xx] * inv_w * inv_w;
+        dn->lum[dst][p]      = Denoise_Luminance(dn->illum[dst][0][p], dn->illum[dst][1][p], dn->illum[dst][2][p]);
+    }
+}
+
+// The last thread to arrive rewinds the row cursor for the next iteration
+intern void Denoiser_Barrier(Denoiser* dn)
+{
+    Mutex_Lock(dn->lock);
+
+    u64 generation = dn->barrier_gen;
+    dn->num_arrived += 1;
+
+    if (dn->num_arrived == dn->num_threads) {
+        dn->num_arrived = 0;
+        dn->next_row    = 0;
+        dn->barrier_gen += 1;
+        Condition_Broadcast(dn->iteration_done);
+    } else {
+        while (dn->barrier_gen == generation) {
+            Condition_Wait(dn->iteration_done, dn->lock);
+        }
+    }
+
+    Mutex_Unlock(dn->lock);
+}
+
+intern void Denoiser_Worker(void* arg)
+{
+    Denoiser* dn = (Denoiser*)arg;
+
+    f32* scratch = (f32*)malloc(DENOISE_NUM_ROWS * dn->width * sizeof(f32));
+    if (scratch == NULL) {
+        ABORT("Failed to allocate denoiser rows");
+    }
+
+    DenoiseRows rows = {
+        .sum         = {&scratch[0 * dn->width], &scratch[1 * dn->width], &scratch[2 * dn->width]},
+        .sum_w       = &scratch[3 * dn->width],
+        .sum_var     = &scratch[4 * dn->width],
+        .inv_sigma_l = &scratch[5 * dn->width],
+        .inv_sigma_z = &scratch[6 * dn->width],
+    };
+
+    for (size_t iteration = 0; iteration < dn->num_iterations; iteration++) {
+        size_t step = (size_t)1 << iteration;
+        size_t src  = iteration & 1;
+
+        while (true) {
+            size_t y0 = __atomic_fetch_add(&dn->next_row, DENOISE_ROWS_PER_CLAIM, __ATOMIC_RELAXED);
+            if (y0 >= dn->height) {
+                break;
+            }
+
+            size_t y1 = MIN(y0 + DENOISE_ROWS_PER_CLAIM, dn->height);
+            for (size_t yy = y0; yy < y1; yy++) {
+                Denoiser_FilterRow(dn, &rows, yy, step, src);
+            }
+        }
+
+        Denoiser_Barrier(dn);
+    }
+
+    free(scratch);
+}
+
+void Denoise_Run(DenoiseImage* image, size_t num_iterations, size_t num_threads)
+{
+    size_t num_pixels = image->width * image->height;
+    if (num_pixels == 0 || num_iterations == 0) {
+        return;
+    }
+
+    f32* planes = (f32*)malloc(DENOISE_NUM_PLANES * num_pixels * sizeof(f32));
+    if (planes == NULL) {
+        ABORT("Failed to allocate denoiser planes");
+    }
+
+    Denoiser dn = {
+        .width          = image->width,
+        .height         = image->height,
+        .illum          = {
+            {&planes[0 * num_pixels], &planes[1 * num_pixels], &planes[2 * num_pixels]},
+            {&planes[3 * num_pixels], &planes[4 * num_pixels], &planes[5 * num_pixels]},
+        },
+        .var            = {&planes[6 * num_pixels], &planes[7 * num_pixels]},
+        .lum            = {&planes[8 * num_pixels], &planes[9 * num_pixels]},
+        .nx             = &planes[10 * num_pixels],
+        .ny             = &planes[11 * num_pixels],
+        .nz             = &planes[12 * num_pixels],
+        .depth          = &planes[13 * num_pixels],
+        .mask           = &planes[14 * num_pixels],
+        .num_iterations = num_iterations,
+        .lock           = Mutex_New(),
+        .iteration_done = Condition_New(),
+        .num_threads    = MAX(num_threads, (size_t)1),
+        .num_arrived    = 0,
+        .barrier_gen    = 0,
+        .next_row       = 0,
+    };
+
+    if (dn.lock == NULL || dn.iteration_done == NULL) {
+        ABORT("Failed to create denoiser barrier");
+    }
+
+    Denoiser_Load(&dn, image);
+
+    // the calling thread is the first of the threads
+    Thread** helpers = (Thread**)calloc(dn.num_threads, sizeof(Thread*));
+    if (helpers == NULL) {
+        ABORT("Failed to allocate denoiser threads");
+    }
+
+    for (size_t ii = 1; ii < dn.num_threads; ii++) {
+        helpers[ii] = Thread_New();
+        if (helpers[ii] == NULL || !Thread_Spawn(helpers[ii], Denoiser_Worker, &dn)) {
+            ABORT("Failed to start denoiser thread");
+        }
+    }
+
+    Denoiser_Worker(&dn);
+
+    for (size_t ii = 1; ii < dn.num_threads; ii++) {
+        Thread_Join(helpers[ii]);
+        Thread_Delete(helpers[ii]);
+    }
+
+    Denoiser_Store(&dn, image, num_iterations & 1);
+
+    free(helpers);
+    Condition_Delete(dn.iteration_done);
+    Mutex_Delete(dn.lock);
+    free(planes);
+}
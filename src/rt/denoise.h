@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "gfx/color.h"
+#include "math/vec.h"
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) for a finished render, guided by what each pixel's
+// camera rays first hit (see PathGuide) and by each pixel's own noise estimate (like SVGF, Schied et al. 2017):
+// every iteration blends each pixel with a 5x5 ring of neighbours twice as far apart as the last, weighted down where
+// the normals or depths differ, or where the luminance differs by more than the pixels' noise can explain
+// The radiance is divided by the albedo before filtering and multiplied back after, so texture detail isn't blurred
+// away with the noise
+typedef struct {
+    size_t width, height;
+
+    Color*       radiance; // each pixel's estimate, replaced by the filtered one
+    const Color* albedo;
+    const vec3*  normal;   // zero where the camera rays escaped, those pixels are left as they are
+    const f32*   depth;
+    const f32*   variance; // of each pixel's mean luminance, negative for pixels without samples (left as they are and
+                           // ignored by their neighbours)
+} DenoiseImage;
+
+// Filters the image in place with num_threads threads (the calling thread being one of them)
+void Denoise_Run(DenoiseImage* image, size_t num_iterations, size_t num_threads);
@@ -0,0 +1,399 @@
+#include "distributed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform/threads.h"
+
+#define DIST_MAGIC   ("RTDIST")
+#define DIST_VERSION (1)
+
+// First message from the coordinator on every connection
+typedef struct {
+    char    magic[8];
+    u32     version;
+    u32     job_size; // sizeof(DistJob), guards against a worker from a different build
+    DistJob job;
+} DistHello;
+
+// Samples [first_sample, first_sample + num_samples) of every pixel, num_samples = 0 tells the worker it's done
+// A worker answers a task with the same task followed by the sum and sample count of every pixel
+typedef struct {
+    u32 first_sample;
+    u32 num_samples;
+} DistTask;
+
+typedef enum {
+    CHUNK_QUEUED,
+    CHUNK_ASSIGNED,
+    CHUNK_DONE,
+} ChunkState;
+
+// Shared by the connection threads, only touched under the lock
+typedef struct {
+    DistJob*   job;
+    Mutex*     lock;
+    Condition* changed;
+
+    ChunkState* chunks;
+    size_t      num_chunks;
+    size_t      num_done;
+    size_t      spp_done;
+    bool        stopping;
+
+    Color* sums;
+    u32*   counts;
+    size_t num_pixels;
+} Coordinator;
+
+// One thread per worker process, it feeds the worker chunks until there are none left or the worker goes away
+typedef struct {
+    Coordinator* coord;
+    Socket*      sock;
+    Thread*      thread;
+    size_t       index;
+} Connection;
+
+struct DistWorker {
+    Socket* sock;
+    DistJob job;
+    Color*  sums;
+    u32*    counts;
+};
+
+intern bool Dist_Cancelled(volatile sig_atomic_t* cancel)
+{
+    return cancel != NULL && *cancel;
+}
+
+intern DistTask Coordinator_Task(Coordinator* coord, size_t chunk)
+{
+    u32 first_sample = (u32)chunk * DIST_CHUNK_SPP;
+
+    return (DistTask){
+        .first_sample = first_sample,
+        .num_samples  = MIN((u32)DIST_CHUNK_SPP, coord->job->samples_per_pixel - first_sample),
+    };
+}
+
+// Waits for a queued chunk and assigns it to the caller, returns false once the render is done or stopping
+intern bool Coordinator_Claim(Coordinator* coord, size_t* chunk)
+{
+    Mutex_Lock(coord->lock);
+
+    while (!coord->stopping && coord->num_done < coord->num_chunks) {
+        for (size_t ii = 0; ii < coord->num_chunks; ii++) {
+            if (coord->chunks[ii] == CHUNK_QUEUED) {
+                coord->chunks[ii] = CHUNK_ASSIGNED;
+                *chunk            = ii;
+
+                Mutex_Unlock(coord->lock);
+                return true;
+            }
+        }
+
+        // everything left is assigned, if one of those workers dies its chunk comes back here
+        Condition_Wait(coord->changed, coord->lock);
+    }
+
+    Mutex_Unlock(coord->lock);
+    return false;
+}
+
+intern void Coordinator_Requeue(Coordinator* coord, size_t chunk)
+{
+    Mutex_Lock(coord->lock);
+    coord->chunks[chunk] = CHUNK_QUEUED;
+    Condition_Broadcast(coord->changed);
+    Mutex_Unlock(coord->lock);
+}
+
+intern void Coordinator_Merge(Coordinator* coord, size_t chunk, Color* sums, u32* counts)
+{
+    DistTask task = Coordinator_Task(coord, chunk);
+
+    Mutex_Lock(coord->lock);
+
+    for (size_t ii = 0; ii < coord->num_pixels; ii++) {
+        coord->sums[ii] = vadd(coord->sums[ii], sums[ii]);
+        coord->counts[ii] += counts[ii];
+    }
+
+    coord->chunks[chunk] = CHUNK_DONE;
+    coord->num_done += 1;
+    coord->spp_done += task.num_samples;
+
+    printf("%zu/%zu chunks done, %zu spp\n", coord->num_done, coord->num_chunks, coord->spp_done);
+
+    Condition_Broadcast(coord->changed);
+    Mutex_Unlock(coord->lock);
+}
+
+intern bool Coordinator_Finished(Coordinator* coord)
+{
+    Mutex_Lock(coord->lock);
+    bool finished = coord->num_done == coord->num_chunks;
+    Mutex_Unlock(coord->lock);
+
+    return finished;
+}
+
+intern void Dist_Serve(void* arg)
+{
+    Connection*  conn  = (Connection*)arg;
+    Coordinator* coord = conn->coord;
+    size_t       chunk;
+
+    DistHello hello = {
+        .magic    = {0},
+        .version  = DIST_VERSION,
+        .job_size = sizeof(DistJob),
+        .job      = *coord->job,
+    };
+    memcpy(hello.magic, DIST_MAGIC, sizeof(DIST_MAGIC));
+
+    Color* sums   = (Color*)malloc(coord->num_pixels * sizeof(Color));
+    u32*   counts = (u32*)malloc(coord->num_pixels * sizeof(u32));
+
+    // a worker that's hung or cut off would otherwise hold on to its chunk forever
+    if (sums == NULL || counts == NULL || !Socket_SetRecvTimeout(conn->sock, DIST_REPLY_TIMEOUT_MS)
+        || !Socket_Send(conn->sock, &hello, sizeof(hello))) {
+        goto cleanup;
+    }
+
+    while (Coordinator_Claim(coord, &chunk)) {
+        DistTask task = Coordinator_Task(coord, chunk);
+        DistTask reply;
+
+        bool received = Socket_Send(conn->sock, &task, sizeof(task)) && Socket_Recv(conn->sock, &reply, sizeof(reply))
+                        && reply.first_sample == task.first_sample && reply.num_samples == task.num_samples
+                        && Socket_Recv(conn->sock, sums, coord->num_pixels * sizeof(Color))
+                        && Socket_Recv(conn->sock, counts, coord->num_pixels * sizeof(u32));
+
+        if (!received) {
+            printf(
+                "Lost worker %zu, requeueing samples %u-%u\n",
+                conn->index,
+                task.first_sample,
+                task.first_sample + task.num_samples - 1);
+            Coordinator_Requeue(coord, chunk);
+            Socket_Shutdown(conn->sock);
+            goto cleanup;
+        }
+
+        Coordinator_Merge(coord, chunk, sums, counts);
+    }
+
+    // nothing left to hand out, the worker can exit (if it's still there to hear it)
+    {
+        DistTask done = {.first_sample = 0, .num_samples = 0};
+        Socket_Send(conn->sock, &done, sizeof(done));
+    }
+
+cleanup:
+    free(counts);
+    free(sums);
+}
+
+bool Dist_Coordinate(DistJob* job, u16 port, ImageRGB* img, RenderStats* stats, volatile sig_atomic_t* cancel)
+{
+    bool        finished  = false;
+    size_t      num_conns = 0;
+    Connection* conns     = (Connection*)calloc(DIST_MAX_WORKERS, sizeof(Connection));
+    Socket*     listener  = NULL;
+
+    Coordinator coord = {
+        .job        = job,
+        .lock       = Mutex_New(),
+        .changed    = Condition_New(),
+        .chunks     = NULL,
+        .num_chunks = (job->samples_per_pixel + DIST_CHUNK_SPP - 1) / DIST_CHUNK_SPP,
+        .num_done   = 0,
+        .spp_done   = 0,
+        .stopping   = false,
+        .sums       = NULL,
+        .counts     = NULL,
+        .num_pixels = (size_t)job->res_w * job->res_h,
+    };
+
+    // calloc leaves every chunk queued and every sum at 0
+    coord.chunks = (ChunkState*)calloc(coord.num_chunks, sizeof(ChunkState));
+    coord.sums   = (Color*)calloc(coord.num_pixels, sizeof(Color));
+    coord.counts = (u32*)calloc(coord.num_pixels, sizeof(u32));
+
+    if (conns == NULL || coord.lock == NULL || coord.changed == NULL || coord.chunks == NULL || coord.sums == NULL
+        || coord.counts == NULL) {
+        ABORT("Failed to allocate distributed render state");
+    }
+
+    listener = Socket_Listen(port);
+    if (listener == NULL) {
+        printf("Failed to listen on port %u\n", (unsigned)port);
+        goto cleanup;
+    }
+
+    printf("Waiting for workers on port %u, %zu chunks of %u spp\n", (unsigned)port, coord.num_chunks, DIST_CHUNK_SPP);
+
+    while (!Coordinator_Finished(&coord) && !Dist_Cancelled(cancel)) {
+        Socket* sock = Socket_Accept(listener, DIST_ACCEPT_POLL_MS);
+        if (sock == NULL) {
+            continue;
+        }
+
+        if (num_conns == DIST_MAX_WORKERS) {
+            Socket_Close(sock);
+            continue;
+        }
+
+        Connection* conn = &conns[num_conns];
+        conn->coord      = &coord;
+        conn->sock       = sock;
+        conn->index      = num_conns;
+        conn->thread     = Thread_New();
+
+        if (conn->thread == NULL || !Thread_Spawn(conn->thread, Dist_Serve, conn)) {
+            ABORT("Failed to start worker connection thread");
+        }
+
+        num_conns += 1;
+        printf("Worker %zu connected\n", conn->index);
+    }
+
+    // idle connections wake up and send their workers home, a cancelled render also cuts off the ones mid chunk
+    Mutex_Lock(coord.lock);
+    coord.stopping = true;
+    Condition_Broadcast(coord.changed);
+    Mutex_Unlock(coord.lock);
+
+    for (size_t ii = 0; ii < num_conns; ii++) {
+        if (Dist_Cancelled(cancel)) {
+            Socket_Shutdown(conns[ii].sock);
+        }
+
+        Thread_Join(conns[ii].thread);
+        Thread_Delete(conns[ii].thread);
+        Socket_Close(conns[ii].sock);
+    }
+
+    *stats = (RenderStats){.samples = 0, .passes = coord.num_done, .spp = coord.spp_done};
+
+    for (size_t yy = 0; yy < job->res_h; yy++) {
+        for (size_t xx = 0; xx < job->res_w; xx++) {
+            size_t pixel = yy * job->res_w + xx;
+
+            if (coord.counts[pixel] > 0) {
+                ImageRGB_SetPixel(img, xx, yy, RGB_FromColor(vdiv(coord.sums[pixel], (f32)coord.counts[pixel])));
+                stats->samples += coord.counts[pixel];
+            }
+        }
+    }
+
+    finished = coord.num_done == coord.num_chunks;
+
+cleanup:
+    if (listener) {
+        Socket_Close(listener);
+    }
+
+    free(coord.counts);
+    free(coord.sums);
+    free(coord.chunks);
+    Condition_Delete(coord.changed);
+    Mutex_Delete(coord.lock);
+    free(conns);
+
+    return finished;
+}
+
+void Dist_Disconnect(DistWorker* worker)
+{
+    if (worker->sock) {
+        Socket_Close(worker->sock);
+    }
+
+    free(worker->counts);
+    free(worker->sums);
+    free(worker);
+}
+
+DistWorker* Dist_Connect(const char* host, u16 port, DistJob* job)
+{
+    DistWorker* worker = (DistWorker*)calloc(1, sizeof(DistWorker));
+    if (worker == NULL) {
+        return NULL;
+    }
+
+    worker->sock = Socket_Connect(host, port);
+
+    DistHello hello;
+    if (worker->sock == NULL || !Socket_Recv(worker->sock, &hello, sizeof(hello))
+        || memcmp(hello.magic, DIST_MAGIC, sizeof(DIST_MAGIC)) != 0 || hello.version != DIST_VERSION
+        || hello.job_size != sizeof(DistJob)
+        || (hello.job.sampler != SAMPLER_RANDOM && hello.job.sampler != SAMPLER_STRATIFIED
+            && hello.job.sampler != SAMPLER_SOBOL)
+        || (hello.job.mode != RENDER_MODE_PATH && hello.job.mode != RENDER_MODE_WAVEFRONT)) {
+        Dist_Disconnect(worker);
+        return NULL;
+    }
+
+    // the paths came off the wire
+    hello.job.scene_path[DIST_PATH_MAX - 1]  = '\0';
+    hello.job.envmap_path[DIST_PATH_MAX - 1] = '\0';
+
+    size_t num_pixels = (size_t)hello.job.res_w * hello.job.res_h;
+    worker->job       = hello.job;
+    worker->sums      = (Color*)malloc(num_pixels * sizeof(Color));
+    worker->counts    = (u32*)malloc(num_pixels * sizeof(u32));
+
+    if (worker->sums == NULL || worker->counts == NULL) {
+        Dist_Disconnect(worker);
+        return NULL;
+    }
+
+    *job = hello.job;
+    return worker;
+}
+
+// ctx must render into an image of the job's resolution, the job's seed, sampler and mode replace the context's
+bool Dist_Work(DistWorker* worker, RenderCtx* ctx, volatile sig_atomic_t* cancel)
+{
+    DistJob* job        = &worker->job;
+    size_t   num_pixels = (size_t)job->res_w * job->res_h;
+
+    Render_Set_Seed(ctx, job->seed);
+    Render_Set_Sampler(ctx, (SamplerType)job->sampler);
+    Render_Set_Mode(ctx, (RenderMode)job->mode);
+    Render_Set_RaySorting(ctx, job->sort_rays);
+
+    // every chunk has to come back with all of its samples, so nothing may cut a render short
+    Render_Set_Adaptive(ctx, ctx->adaptive.min_spp, ctx->adaptive.step_spp, 0.0f);
+    Render_Set_TimeBudget(ctx, 0, ctx->time_budget.pass_spp);
+    Render_Set_Checkpoint(ctx, NULL, 0);
+
+    while (!Dist_Cancelled(cancel)) {
+        DistTask task;
+        if (!Socket_Recv(worker->sock, &task, sizeof(task))) {
+            return false;
+        }
+
+        if (task.num_samples == 0) {
+            return true;
+        }
+
+        Render_Set_SampleRange(ctx, task.first_sample, job->samples_per_pixel);
+        Render_Start(ctx, task.num_samples, job->max_ray_depth);
+        Render_Wait(ctx);
+        Render_Read_Samples(ctx, worker->sums, worker->counts);
+
+        if (!Socket_Send(worker->sock, &task, sizeof(task))
+            || !Socket_Send(worker->sock, worker->sums, num_pixels * sizeof(Color))
+            || !Socket_Send(worker->sock, worker->counts, num_pixels * sizeof(u32))) {
+            return false;
+        }
+
+        printf("Rendered samples %u-%u\n", task.first_sample, task.first_sample + task.num_samples - 1);
+    }
+
+    return false;
+}
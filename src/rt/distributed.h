@@ -0,0 +1,46 @@
+#pragma once
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gfx/image.h"
+#include "platform/net.h"
+#include "rt/renderer.h"
+
+// Renders one image across processes (on this machine or others): a coordinator splits each pixel's samples into
+// chunks of DIST_CHUNK_SPP and hands them out to worker processes over TCP, each worker loads the scene itself,
+// renders its chunks with Render_Set_SampleRange and sends back the radiance sums, which the coordinator adds up
+// Chunks held by a worker that disconnects, dies or stops answering (see DIST_REPLY_TIMEOUT_MS) go back in the queue
+// for the others, so the image only needs one worker to stay up, and since a sample's value only depends on the seed,
+// pixel and sample index, the result doesn't depend on which worker rendered which chunk
+// NOTE: messages are sent as the raw structs, so every machine involved must run the same build on the same
+// architecture (the handshake checks the version and struct sizes, not endianness)
+#define DIST_PATH_MAX (1024)
+
+// Everything a worker needs to set up the same render as every other worker, the scene and envmap paths have to
+// resolve on each worker's machine
+typedef struct {
+    u32 res_w, res_h;
+    u32 samples_per_pixel;
+    u32 max_ray_depth;
+    u32 mode;
+    u32 sort_rays;
+    u32 sampler;
+    u64 seed;
+
+    char scene_path[DIST_PATH_MAX];
+    char envmap_path[DIST_PATH_MAX]; // empty for the default skybox
+} DistJob;
+
+typedef struct DistWorker DistWorker;
+
+// Serves job on port until every chunk is in (or cancel is set), then writes the image, returns false if the port
+// can't be listened on or the render was cancelled (img then has whatever chunks made it)
+bool Dist_Coordinate(DistJob* job, u16 port, ImageRGB* img, RenderStats* stats, volatile sig_atomic_t* cancel);
+
+// A worker connects and receives the job, sets up a render context for it, then renders chunks until the coordinator
+// is done with it (true) or the connection fails or cancel is set (false)
+DistWorker* Dist_Connect(const char* host, u16 port, DistJob* job);
+bool        Dist_Work(DistWorker* worker, RenderCtx* ctx, volatile sig_atomic_t* cancel);
+void        Dist_Disconnect(DistWorker* worker);
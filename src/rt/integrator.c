@@ -0,0 +1,113 @@
+#include "integrator.h"
+
+#include <math.h>
+
+PathVertex Integrator_CameraVertex(Ray* camera_ray)
+{
+    return (PathVertex){
+        .position      = camera_ray->origin,
+        .light_sampled = false,
+        .bsdf_pdf      = 0.0f,
+    };
+}
+
+PathGuide Integrator_Guide(Scene* scene, Ray* camera_ray, Object* obj, HitInfo* hit)
+{
+    if (obj == NULL) {
+        return (PathGuide){
+            .albedo   = Scene_Get_SkyColor(scene, camera_ray->dir),
+            .normal   = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+            .depth    = 0.0f,
+            .material = 0,
+        };
+    }
+
+    return (PathGuide){
+        .albedo   = Material_Albedo(Object_Material(obj), hit),
+        .normal   = hit->unitNormal,
+        .depth    = hit->tIntersect,
+        .material = 1 + Scene_MaterialID(scene, obj->material),
+    };
+}
+
+PathVertex Integrator_ScatterVertex(Object* obj, Ray* ray_in, HitInfo* hit, Ray* ray_out, bool light_sampled)
+{
+    return (PathVertex){
+        .position      = hit->position,
+        .light_sampled = light_sampled,
+        .bsdf_pdf      = light_sampled ? Material_PDF(Object_Material(obj), ray_in, hit, ray_out->dir) : 0.0f,
+    };
+}
+
+// Power heuristic (beta = 2) weight of the strategy with pdf_a against the one with pdf_b
+intern inline f32 PowerHeuristic(f32 pdf_a, f32 pdf_b)
+{
+    f32 a_2 = pdf_a * pdf_a;
+    f32 b_2 = pdf_b * pdf_b;
+
+    // an infinite pdf means a (near) delta lobe, which light sampling can't compete with
+    if (isinf(a_2)) {
+        return 1.0f;
+    } else if (isinf(b_2)) {
+        return 0.0f;
+    }
+
+    return a_2 / (a_2 + b_2);
+}
+
+f32 Integrator_EmissionWeight(Scene* scene, PathVertex* prev, Object* obj, HitInfo* hit)
+{
+    if (!prev->light_sampled) {
+        return 1.0f;
+    }
+
+    f32 light_pdf = Scene_LightPDF(scene, prev->position, obj, hit);
+    if (light_pdf <= 0.0f) {
+        return 1.0f;
+    }
+
+    return PowerHeuristic(prev->bsdf_pdf, light_pdf);
+}
+
+f32 Integrator_SkyWeight(Scene* scene, PathVertex* prev, vec3 dir)
+{
+    if (!prev->light_sampled) {
+        return 1.0f;
+    }
+
+    f32 sky_pdf = Scene_SkyPDF(scene, dir);
+    if (sky_pdf <= 0.0f) {
+        return 1.0f;
+    }
+
+    return PowerHeuristic(prev->bsdf_pdf, sky_pdf);
+}
+
+bool Integrator_SampleDirect(Scene* scene, Object* obj, Ray* ray_in, HitInfo* hit, ShadowRay* shadow)
+{
+    if (!Scene_HasLights(scene) || !Material_Evaluable(Object_Material(obj))) {
+        return false;
+    }
+
+    shadow->dist    = 0.0f;
+    shadow->contrib = COLOR_BLACK;
+
+    LightSample sample;
+    if (!Scene_SampleLight(scene, hit->position, &sample)) {
+        return true;
+    }
+
+    Color bsdf_cos = Material_Eval(Object_Material(obj), ray_in, hit, sample.dir);
+    if (vequ(bsdf_cos, 0.0f)) {
+        return true;
+    }
+
+    f32 bsdf_pdf = Material_PDF(Object_Material(obj), ray_in, hit, sample.dir);
+    f32 weight   = PowerHeuristic(sample.pdf, bsdf_pdf);
+
+    shadow->ray     = Ray_Make(hit->position, sample.dir);
+    shadow->dist    = sample.dist;
+    shadow->contrib = vmul(Color_Tint(bsdf_cos, sample.radiance), weight / sample.pdf);
+
+    return true;
+}
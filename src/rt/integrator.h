@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "gfx/color.h"
+#include "rt/ray.h"
+#include "world/object.h"
+#include "world/scene.h"
+
+// Pieces of the path tracing estimator shared by the path and wavefront render modes
+
+// What the next vertex of a path needs to know about the previous one
+typedef struct {
+    point3 position;
+    bool   light_sampled; // direct light was sampled here, so lights hit by the bounce ray share the credit with it
+    f32    bsdf_pdf;      // solid angle pdf of the bounce direction, only set if light_sampled
+} PathVertex;
+
+// Occlusion test for a light sample, contrib is what the path gains if nothing is in the way
+typedef struct {
+    Ray   ray;
+    f32   dist;
+    Color contrib;
+} ShadowRay;
+
+// What a camera ray first sees, averaged over a pixel's samples these guide the denoiser (see rt/denoise.h) and are
+// written out as AOVs
+typedef struct {
+    Color albedo;
+    vec3  normal;   // zero if the ray escaped the scene
+    f32   depth;    // distance along the ray, zero if it escaped the scene
+    u32   material; // 1 + Scene_MaterialID of the object's own material (overrides aside), zero if the ray escaped
+} PathGuide;
+
+PathVertex Integrator_CameraVertex(Ray* camera_ray);
+
+// obj/hit are the camera ray's closest hit, NULL if it escaped (the albedo is then the sky's color)
+PathGuide Integrator_Guide(Scene* scene, Ray* camera_ray, Object* obj, HitInfo* hit);
+PathVertex Integrator_ScatterVertex(Object* obj, Ray* ray_in, HitInfo* hit, Ray* ray_out, bool light_sampled);
+
+// MIS weight of the light emitted by the hit object when it was found by the previous vertex's bounce ray
+f32 Integrator_EmissionWeight(Scene* scene, PathVertex* prev, Object* obj, HitInfo* hit);
+
+// MIS weight of the sky seen by a bounce ray that escaped the scene
+f32 Integrator_SkyWeight(Scene* scene, PathVertex* prev, vec3 dir);
+
+// Samples a light for the direct lighting at a hit (next event estimation), weighted against finding the same light by
+// the bounce ray (multiple importance sampling with the power heuristic). Returns false if the material can't be light
+// sampled, otherwise the vertex counts as light sampled even if the sample itself contributes nothing
+// NOTE: contrib isn't multiplied by the path throughput and is black when there's nothing to trace
+bool Integrator_SampleDirect(Scene* scene, Object* obj, Ray* ray_in, HitInfo* hit, ShadowRay* shadow);
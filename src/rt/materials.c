@@ -6,6 +6,7 @@
 #include "gfx/color.h"
 #include "math/math.h"
 #include "math/random.h"
+#include "math/sampler.h"
 #include "math/vec.h"
 
 // TODO: I think we might be able to remove a lot of the uses of fabsf in the Disney BRDFs
@@ -273,8 +274,9 @@ BRDF_Diffuse(Color base_color, vec3 w_in, vec3 w_out, vec3 shading_normal, f32 r
 
 intern inline vec3 CosWeightedHemisphere_Sample(vec3 unit_normal)
 {
-    f32 epsilon_0 = Random_Unilateral();
-    f32 epsilon_1 = Random_Unilateral();
+    point2 epsilon   = Sampler_2D();
+    f32    epsilon_0 = epsilon.u;
+    f32    epsilon_1 = epsilon.v;
 
     f32 sin_theta = sqrtf(1.0f - epsilon_0);
     f32 cos_theta = sqrtf(epsilon_0);
@@ -321,6 +323,35 @@ bool Material_Disney_Diffuse_Bounce(
     return true;
 }
 
+Color Material_Disney_Diffuse_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    vec3 shading_normal = hit->unitNormal;
+    f32  cos_out        = vdot(shading_normal, ray_dir_out);
+
+    if (cos_out <= 0.0f) {
+        return COLOR_BLACK;
+    }
+
+    Color albedo = Texture_ColorAt(mat->albedo, hit->uv);
+    vec3  w_in   = vmul(-1.0f, ray_in->dir);
+
+    Color brdf_diffuse = BRDF_Diffuse(albedo, w_in, ray_dir_out, shading_normal, mat->roughness, mat->subsurface);
+    return vmul(brdf_diffuse, cos_out);
+}
+
+intern inline f32 CosWeightedHemisphere_PDF(vec3 unit_normal, vec3 w_out)
+{
+    return maxf(0.0f, vdot(unit_normal, w_out)) / PI32;
+}
+
+f32 Material_Disney_Diffuse_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    (void)mat;
+    (void)ray_in;
+
+    return CosWeightedHemisphere_PDF(hit->unitNormal, ray_dir_out);
+}
+
 /* ---- Disney Metal ---- */
 
 Material Material_Disney_Metal_Make(Texture* albedo, f32 roughness, f32 anistropic)
@@ -436,9 +467,8 @@ intern inline vec3 GGXVNDF_Sample(vec3 Ve, f32 alpha_x, f32 alpha_y, f32 U1, f32
 
 intern inline vec3 Disney_Metal_SampleNormal(vec3 w_in, f32 a_x, f32 a_y)
 {
-    f32  u1            = Random_Unilateral();
-    f32  u2            = Random_Unilateral();
-    vec3 w_micronormal = GGXVNDF_Sample(w_in, a_x, a_y, u1, u2);
+    point2 u             = Sampler_2D();
+    vec3   w_micronormal = GGXVNDF_Sample(w_in, a_x, a_y, u.u, u.v);
 
     return w_micronormal;
 }
@@ -491,6 +521,67 @@ bool Material_Disney_Metal_Bounce(
     return true;
 }
 
+intern inline void Disney_Alpha(Material_Disney_BSDF* mat, f32* a_x, f32* a_y)
+{
+    f32 aspect = sqrtf(1.0f - 0.9f * mat->anistropic);
+    f32 a_min  = 0.0001f;
+
+    *a_x = maxf(a_min, POWF(mat->roughness, 2) / aspect);
+    *a_y = maxf(a_min, POWF(mat->roughness, 2) * aspect);
+}
+
+// NOTE: the bounce returns F * G_m1(w_out), which is f * cos / pdf for f = F * D * G_m2 / (4 * cos_in * cos_out) and
+// the visible normal pdf G_m1(w_in) * D / (4 * cos_in), so the eval and pdf below are those two
+Color Material_Disney_Metal_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 a_x, a_y;
+    Disney_Alpha(mat, &a_x, &a_y);
+
+    basis3 normal_to_world = vec3_OrthonormalBasis(hit->unitNormal);
+    basis3 world_to_normal = vec3_OrthonormalBasis_Inverse(normal_to_world);
+
+    vec3 w_in  = vec3_Reorient(vmul(-1.0f, ray_in->dir), world_to_normal);
+    vec3 w_out = vec3_Reorient(ray_dir_out, world_to_normal);
+
+    if (w_in.z <= 0.0f || w_out.z <= 0.0f) {
+        return COLOR_BLACK;
+    }
+
+    vec3  w_micronormal = HalfVector(w_in, w_out);
+    Color albedo        = Texture_ColorAt(mat->albedo, hit->uv);
+    Color brdf          = BRDF_Disney_Metal(
+        albedo,
+        w_out,
+        w_micronormal,
+        mat->weights.metallic,
+        mat->specular,
+        mat->specular_tint,
+        a_x,
+        a_y,
+        mat->eta);
+
+    return vmul(brdf, G_m1(w_in, a_x, a_y) * D_m(w_micronormal, a_x, a_y) / (4.0f * w_in.z));
+}
+
+f32 Material_Disney_Metal_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 a_x, a_y;
+    Disney_Alpha(mat, &a_x, &a_y);
+
+    basis3 normal_to_world = vec3_OrthonormalBasis(hit->unitNormal);
+    basis3 world_to_normal = vec3_OrthonormalBasis_Inverse(normal_to_world);
+
+    vec3 w_in  = vec3_Reorient(vmul(-1.0f, ray_in->dir), world_to_normal);
+    vec3 w_out = vec3_Reorient(ray_dir_out, world_to_normal);
+
+    if (w_in.z <= 0.0f || w_out.z <= 0.0f) {
+        return 0.0f;
+    }
+
+    vec3 w_micronormal = HalfVector(w_in, w_out);
+    return G_m1(w_in, a_x, a_y) * D_m(w_micronormal, a_x, a_y) / (4.0f * w_in.z);
+}
+
 /* ---- Disney Clearcoat BRDF ---- */
 
 Material Material_Disney_Clearcoat_Make(f32 gloss)
@@ -563,8 +654,9 @@ intern inline f32 BRDF_Disney_Clearcoat(vec3 w_in, vec3 w_out, vec3 w_micronorma
 
 intern inline vec3 Disney_Clearcoat_SampleNormal(f32 a_g)
 {
-    f32 u_0 = Random_Unilateral();
-    f32 u_1 = Random_Unilateral();
+    point2 u   = Sampler_2D();
+    f32    u_0 = u.u;
+    f32    u_1 = u.v;
 
     f32 a_g_2 = POWF(a_g, 2);
 
@@ -634,6 +726,54 @@ bool Material_Disney_Clearcoat_Bounce(
     return true;
 }
 
+// NOTE: the bounce cancels D_c and the 1/4 between the BRDF and the pdf, the eval and pdf put them back
+intern inline f32 Disney_Clearcoat_EvalPDF(
+    Material_Disney_BSDF* mat,
+    Ray*                  ray_in,
+    HitInfo*              hit,
+    vec3                  ray_dir_out,
+    f32*                  pdf)
+{
+    f32 a_g = (1.0f - mat->clearcoat_gloss) * 0.1f + mat->clearcoat_gloss * 0.001f;
+
+    basis3 normal_to_world = vec3_OrthonormalBasis(hit->unitNormal);
+    basis3 world_to_normal = vec3_OrthonormalBasis_Inverse(normal_to_world);
+
+    vec3 w_in  = vec3_Reorient(vmul(-1.0f, ray_in->dir), world_to_normal);
+    vec3 w_out = vec3_Reorient(ray_dir_out, world_to_normal);
+
+    if (w_in.z <= 0.0f || w_out.z <= 0.0f) {
+        *pdf = 0.0f;
+        return 0.0f;
+    }
+
+    vec3 w_macronormal = vec(0.0f, 0.0f, 1.0f);
+    vec3 w_micronormal = HalfVector(w_in, w_out);
+
+    f32 d_c     = D_c(w_micronormal, a_g);
+    f32 brdf    = BRDF_Disney_Clearcoat(w_in, w_out, w_micronormal, w_macronormal, a_g);
+    f32 inv_pdf = Disney_Clearcoat_SampleNormal_InvPDF(w_out, w_micronormal, w_macronormal, a_g);
+
+    *pdf = 0.25f * d_c / inv_pdf;
+    return 0.25f * d_c * brdf;
+}
+
+Color Material_Disney_Clearcoat_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 pdf;
+    f32 brdf = Disney_Clearcoat_EvalPDF(mat, ray_in, hit, ray_dir_out, &pdf);
+
+    return vec(brdf, brdf, brdf);
+}
+
+f32 Material_Disney_Clearcoat_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 pdf;
+    Disney_Clearcoat_EvalPDF(mat, ray_in, hit, ray_dir_out, &pdf);
+
+    return pdf;
+}
+
 /* ---- Disney Glass ---- */
 
 Material Material_Disney_Glass_Make(Texture* albedo, f32 roughness, f32 anistropic, f32 eta)
@@ -712,9 +852,8 @@ intern inline Color BRDF_Disney_Glass(Color base_color, vec3 w_out, f32 a_x, f32
 intern inline vec3 Disney_Glass_SampleNormal(vec3 w_in, f32 a_x, f32 a_y)
 {
     // TODO: might need to clamp roughness to [0.01, 1.0] to avoid numerical precision issues
-    f32  u0            = Random_Unilateral();
-    f32  u1            = Random_Unilateral();
-    vec3 w_micronormal = GGXVNDF_Sample(w_in, a_x, a_y, u0, u1);
+    point2 u             = Sampler_2D();
+    vec3   w_micronormal = GGXVNDF_Sample(w_in, a_x, a_y, u.u, u.v);
 
     return w_micronormal;
 }
@@ -753,7 +892,7 @@ bool Material_Disney_Glass_Bounce(
         f32 micronormal_dot_in = vdot(w_micronormal, w_in);
         f32 f_g                = Fresnel_Achromatic_IncidentOnly(micronormal_dot_in, eta);
 
-        f32 u2 = Random_Unilateral();
+        f32 u2 = Sampler_1D();
         if (u2 <= f_g) {
             w_out     = vec3_Reflect(vmul(-1.0f, w_in), w_micronormal);
             reflected = true;
@@ -778,6 +917,76 @@ bool Material_Disney_Glass_Bounce(
     return true;
 }
 
+// NOTE: like the bounce, this treats the glass weights (albedo or sqrt(albedo) times G_g1(w_out)) as f * cos / pdf
+// the pdf is that of picking the micronormal from the visible normals, then reflecting or refracting by Fresnel
+intern inline Color Disney_Glass_EvalPDF(
+    Material_Disney_BSDF* mat,
+    Ray*                  ray_in,
+    HitInfo*              hit,
+    vec3                  ray_dir_out,
+    f32*                  pdf)
+{
+    f32 a_x, a_y;
+    Disney_Alpha(mat, &a_x, &a_y);
+
+    f32 eta = hit->frontFace ? 1.0f / mat->eta : mat->eta;
+
+    basis3 normal_to_world = vec3_OrthonormalBasis(hit->unitNormal);
+    basis3 world_to_normal = vec3_OrthonormalBasis_Inverse(normal_to_world);
+
+    vec3 w_in  = vec3_Reorient(vmul(-1.0f, ray_in->dir), world_to_normal);
+    vec3 w_out = vec3_Reorient(ray_dir_out, world_to_normal);
+
+    *pdf = 0.0f;
+
+    if (w_in.z <= 0.0f || w_out.z == 0.0f) {
+        return COLOR_BLACK;
+    }
+
+    bool reflected = w_out.z > 0.0f;
+
+    // the micronormal that maps w_in onto w_out, pointing to the same side as the macronormal
+    vec3 w_micronormal = reflected ? HalfVector(w_in, w_out) : vnorm(vmul(-1.0f, vadd(vmul(w_in, eta), w_out)));
+    if (w_micronormal.z < 0.0f) {
+        w_micronormal = vmul(-1.0f, w_micronormal);
+    }
+
+    f32 micronormal_dot_in  = vdot(w_micronormal, w_in);
+    f32 micronormal_dot_out = vdot(w_micronormal, w_out);
+
+    // the visible normal sampler never picks a micronormal facing away from w_in, and a refraction has to cross it
+    if (micronormal_dot_in <= 0.0f || (!reflected && micronormal_dot_out >= 0.0f)) {
+        return COLOR_BLACK;
+    }
+
+    f32 f_g       = Fresnel_Achromatic_IncidentOnly(micronormal_dot_in, eta);
+    f32 pdf_micro = G_g1(w_in, a_x, a_y) * micronormal_dot_in * D_g(w_micronormal, a_x, a_y) / w_in.z;
+
+    if (reflected) {
+        *pdf = f_g * pdf_micro / (4.0f * micronormal_dot_in);
+    } else {
+        f32 jacobian = fabsf(micronormal_dot_out) / POWF(eta * micronormal_dot_in + micronormal_dot_out, 2);
+        *pdf         = (1.0f - f_g) * pdf_micro * jacobian;
+    }
+
+    Color albedo = Texture_ColorAt(mat->albedo, hit->uv);
+    return vmul(BRDF_Disney_Glass(albedo, w_out, a_x, a_y, reflected), *pdf);
+}
+
+Color Material_Disney_Glass_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 pdf;
+    return Disney_Glass_EvalPDF(mat, ray_in, hit, ray_dir_out, &pdf);
+}
+
+f32 Material_Disney_Glass_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 pdf;
+    Disney_Glass_EvalPDF(mat, ray_in, hit, ray_dir_out, &pdf);
+
+    return pdf;
+}
+
 /* ---- Disney Sheen ---- */
 
 Material Material_Disney_Sheen_Make(Texture* albedo, f32 sheen_tint)
@@ -825,6 +1034,32 @@ bool Material_Disney_Sheen_Bounce(
     return true;
 }
 
+// NOTE: matches the bounce above, which treats BRDF_Disney_Sheen as the BRDF and cosine samples it
+Color Material_Disney_Sheen_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    f32 cos_out = vdot(hit->unitNormal, ray_dir_out);
+
+    if (cos_out <= 0.0f) {
+        return COLOR_BLACK;
+    }
+
+    vec3 w_in          = vmul(-1.0f, ray_in->dir);
+    vec3 w_micronormal = HalfVector(w_in, ray_dir_out);
+
+    Color albedo     = Texture_ColorAt(mat->albedo, hit->uv);
+    Color brdf_color = BRDF_Disney_Sheen(albedo, ray_dir_out, w_micronormal, mat->sheen_tint);
+
+    return vmul(brdf_color, cos_out);
+}
+
+f32 Material_Disney_Sheen_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    (void)mat;
+    (void)ray_in;
+
+    return CosWeightedHemisphere_PDF(hit->unitNormal, ray_dir_out);
+}
+
 /* ---- Disney BSDF ---- */
 
 Material Material_Disney_BSDF_Make(
@@ -865,6 +1100,34 @@ Material Material_Disney_BSDF_Make(
     };
 }
 
+typedef struct {
+    f32 diffuse, sheen, metal, clearcoat, glass;
+    f32 total;
+} Disney_LobeWeights;
+
+// Odds of the bounce picking each lobe (relative to total)
+intern inline Disney_LobeWeights Disney_BSDF_LobeWeights(Material_Disney_BSDF* mat, HitInfo* hit)
+{
+    // TODO: this could be precomputed
+    Disney_LobeWeights weights;
+    if (hit->frontFace) {
+        weights.diffuse   = (1.0f - mat->weights.specular) * (1.0f - mat->weights.metallic);
+        weights.sheen     = (1.0f - mat->weights.metallic) * mat->weights.sheen;
+        weights.metal     = (1.0f - mat->weights.specular * (1.0f - mat->weights.metallic));
+        weights.clearcoat = 0.25f * mat->weights.clearcoat;
+        weights.glass     = (1.0f - mat->weights.metallic) * mat->weights.specular;
+    } else {
+        weights.diffuse   = 0.0f;
+        weights.sheen     = 0.0f;
+        weights.metal     = 0.0f;
+        weights.clearcoat = 0.0f;
+        weights.glass     = (1.0f - mat->weights.metallic) * mat->weights.specular;
+    }
+
+    weights.total = weights.diffuse + weights.sheen + weights.metal + weights.clearcoat + weights.glass;
+    return weights;
+}
+
 bool Material_Disney_BSDF_Bounce(
     Material_Disney_BSDF* mat,
     Ray*                  ray_in,
@@ -873,34 +1136,19 @@ bool Material_Disney_BSDF_Bounce(
     Color*                emitted_color,
     Ray*                  ray_out)
 {
-    // TODO: this could be precomputed
-    f32 weight_diffuse, weight_sheen, weight_metal, weight_clearcoat, weight_glass;
-    if (hit->frontFace) {
-        weight_diffuse   = (1.0f - mat->weights.specular) * (1.0f - mat->weights.metallic);
-        weight_sheen     = (1.0f - mat->weights.metallic) * mat->weights.sheen;
-        weight_metal     = (1.0f - mat->weights.specular * (1.0f - mat->weights.metallic));
-        weight_clearcoat = 0.25f * mat->weights.clearcoat;
-        weight_glass     = (1.0f - mat->weights.metallic) * mat->weights.specular;
-    } else {
-        weight_diffuse   = 0.0f;
-        weight_sheen     = 0.0f;
-        weight_metal     = 0.0f;
-        weight_clearcoat = 0.0f;
-        weight_glass     = (1.0f - mat->weights.metallic) * mat->weights.specular;
-    }
+    Disney_LobeWeights weights = Disney_BSDF_LobeWeights(mat, hit);
 
-    f32 total_weight = weight_diffuse + weight_sheen + weight_metal + weight_clearcoat + weight_glass;
-    f32 sel_interval = Random_Unilateral() * total_weight;
+    f32 sel_interval = Sampler_1D() * weights.total;
 
     typedef struct {
         f32 lower, upper;
     } RngInterval;
 
-    RngInterval diffuse   = {0.0f, weight_diffuse};
-    RngInterval sheen     = {diffuse.upper, diffuse.upper + weight_sheen};
-    RngInterval metal     = {sheen.upper, sheen.upper + weight_metal};
-    RngInterval clearcoat = {metal.upper, metal.upper + weight_clearcoat};
-    RngInterval glass     = {clearcoat.upper, clearcoat.upper + weight_glass};
+    RngInterval diffuse   = {0.0f, weights.diffuse};
+    RngInterval sheen     = {diffuse.upper, diffuse.upper + weights.sheen};
+    RngInterval metal     = {sheen.upper, sheen.upper + weights.metal};
+    RngInterval clearcoat = {metal.upper, metal.upper + weights.clearcoat};
+    RngInterval glass     = {clearcoat.upper, clearcoat.upper + weights.glass};
 
     if (diffuse.lower <= sel_interval && sel_interval < diffuse.upper) {
         return Material_Disney_Diffuse_Bounce(mat, ray_in, hit, surface_color, emitted_color, ray_out);
@@ -922,3 +1170,59 @@ bool Material_Disney_BSDF_Bounce(
         return false;
     }
 }
+
+// NOTE: the bounce samples a single lobe and returns that lobe's weight, so the BSDF it's estimating is the average of
+// the lobes by how often they're picked, and the pdf of a direction is the same average of the lobe pdfs
+Color Material_Disney_BSDF_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    Disney_LobeWeights weights = Disney_BSDF_LobeWeights(mat, hit);
+    if (weights.total <= 0.0f) {
+        return COLOR_BLACK;
+    }
+
+    Color eval = COLOR_BLACK;
+    if (weights.diffuse > 0.0f) {
+        eval = vadd(eval, vmul(Material_Disney_Diffuse_Eval(mat, ray_in, hit, ray_dir_out), weights.diffuse));
+    }
+    if (weights.sheen > 0.0f) {
+        eval = vadd(eval, vmul(Material_Disney_Sheen_Eval(mat, ray_in, hit, ray_dir_out), weights.sheen));
+    }
+    if (weights.metal > 0.0f) {
+        eval = vadd(eval, vmul(Material_Disney_Metal_Eval(mat, ray_in, hit, ray_dir_out), weights.metal));
+    }
+    if (weights.clearcoat > 0.0f) {
+        eval = vadd(eval, vmul(Material_Disney_Clearcoat_Eval(mat, ray_in, hit, ray_dir_out), weights.clearcoat));
+    }
+    if (weights.glass > 0.0f) {
+        eval = vadd(eval, vmul(Material_Disney_Glass_Eval(mat, ray_in, hit, ray_dir_out), weights.glass));
+    }
+
+    return vdiv(eval, weights.total);
+}
+
+f32 Material_Disney_BSDF_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    Disney_LobeWeights weights = Disney_BSDF_LobeWeights(mat, hit);
+    if (weights.total <= 0.0f) {
+        return 0.0f;
+    }
+
+    f32 pdf = 0.0f;
+    if (weights.diffuse > 0.0f) {
+        pdf += weights.diffuse * Material_Disney_Diffuse_PDF(mat, ray_in, hit, ray_dir_out);
+    }
+    if (weights.sheen > 0.0f) {
+        pdf += weights.sheen * Material_Disney_Sheen_PDF(mat, ray_in, hit, ray_dir_out);
+    }
+    if (weights.metal > 0.0f) {
+        pdf += weights.metal * Material_Disney_Metal_PDF(mat, ray_in, hit, ray_dir_out);
+    }
+    if (weights.clearcoat > 0.0f) {
+        pdf += weights.clearcoat * Material_Disney_Clearcoat_PDF(mat, ray_in, hit, ray_dir_out);
+    }
+    if (weights.glass > 0.0f) {
+        pdf += weights.glass * Material_Disney_Glass_PDF(mat, ray_in, hit, ray_dir_out);
+    }
+
+    return pdf / weights.total;
+}
@@ -204,3 +204,19 @@ bool Material_Disney_BSDF_Bounce(
     Color*                surface_color,
     Color*                emitted_color,
     Ray*                  ray_out);
+
+// Eval gives the BSDF times the cosine term for a given outgoing direction, PDF gives the solid angle density of the
+// bounce picking that direction, both are consistent with the bounce (f * cos / pdf is what the bounce returns)
+Color Material_Disney_Diffuse_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+Color Material_Disney_Metal_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+Color Material_Disney_Clearcoat_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+Color Material_Disney_Glass_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+Color Material_Disney_Sheen_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+Color Material_Disney_BSDF_Eval(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+
+f32 Material_Disney_Diffuse_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32 Material_Disney_Metal_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32 Material_Disney_Clearcoat_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32 Material_Disney_Glass_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32 Material_Disney_Sheen_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32 Material_Disney_BSDF_PDF(Material_Disney_BSDF* mat, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
@@ -1,25 +1,238 @@
 #include "renderer.h"
 
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "math/curves.h"
 #include "math/math.h"
 #include "math/random.h"
+#include "math/sampler.h"
+#include "platform/numa.h"
+#include "platform/profiling.h"
 #include "platform/threads.h"
+#include "rt/denoise.h"
+#include "rt/integrator.h"
+#include "rt/wavefront.h"
 
 typedef struct {
     size_t w, h;
     size_t x, y;
 } Tile;
 
-typedef union {
-    u8 taken8;
-} WorkUnit;
+#define Vector_Type Tile
+#include "ctl/containers/vector.h"
+
+#define Vector_Type u32
+#include "ctl/containers/vector.h"
 
-#define Vector_Type WorkUnit
-// #define Vector_Malloc(bytes) aligned_alloc(alignof(WorkUnit), bytes)
+#define Vector_Type f32
 #include "ctl/containers/vector.h"
 
+// Tiles are handed out in hilbert curve order through a single shared cursor, so a thread only does one atomic RMW
+// per tile it renders, and consecutively claimed tiles are spatially close (better kd-tree and texture cache reuse)
+// A render restricted to regions only gets the parts of the tile grid inside them (a grid tile can be cut into
+// several pieces where regions overlap it), the rest of the image is left as it was
+// A queue split into bands (one per NUMA node, see Render_Set_Numa) orders the tiles by horizontal band of the image
+// first, each band has a cursor of its own and the workers of a node claim from their band until it runs dry before
+// helping with the others
+typedef struct {
+    // keep each cursor on its own cache line since every worker of the band hammers it
+    alignas(SZ_CACHE_LINE) size_t next;
+    size_t end; // the band's tiles are active[next, end)
+} TileCursor;
+
+typedef struct {
+    Vector(Tile) order;
+
+    // indices into order of the tiles that still need samples in the current pass, and the error estimate of every
+    // tile after its last pass (written by whichever worker rendered it)
+    Vector(u32) active;
+    Vector(f32) error;
+
+    size_t img_w, img_h;
+    size_t tile_w, tile_h;
+
+    RenderRect regions[RENDER_MAX_REGIONS];
+    size_t     num_regions;
+
+    u64 layout; // bumped whenever the order is rebuilt
+
+    size_t     num_bands;
+    TileCursor bands[NUMA_MAX_NODES];
+} TileQueue;
+
+// Running per-pixel estimate, the radiance sum gives the pixel's value and the luminance mean/M2 (Welford's online
+// variance) give the error used to decide if the pixel needs more samples
+// The guide sums (what the camera rays first hit) are only accumulated for jobs that are denoised or write AOVs
+typedef struct {
+    Color sum;
+    f32   lum_mean;
+    f32   lum_m2;
+    u32   samples;
+
+    Color albedo_sum;
+    vec3  normal_sum;
+    f32   depth_sum;
+    u32   material; // of the pixel's first sample, IDs don't average
+} PixelAccum;
+
+// Rectangles of the image workers have finished writing, for the preview (or anything else copying the image while it
+// renders) to pick up with Render_Poll_Tiles instead of rereading the whole image
+// A bounded queue with a sequence number per slot (Vyukov's), so workers publish a tile with one CAS and never wait on
+// the consumer, when it falls behind the queue is marked overflowed and the next poll returns the whole image
+typedef struct {
+    u64        seq;
+    RenderRect rect;
+} CommitSlot;
+
+typedef struct {
+    CommitSlot* slots;
+
+    alignas(SZ_CACHE_LINE) u64 head; // next slot to publish into
+    alignas(SZ_CACHE_LINE) u64 tail; // next slot to consume
+    alignas(SZ_CACHE_LINE) bool overflowed;
+} CommitQueue;
+
+typedef struct {
+    Camera*   cam;
+    Scene*    scene;
+    ImageRGB* img;
+
+    RenderMode  mode;
+    SamplerType sampler;
+    u32         seed;
+    bool        sort_rays;
+    bool        denoise;
+    bool        guided; // the guide sums are accumulated, for denoising or AOVs
+    size_t      samples_per_pixel;
+    size_t      max_ray_depth;
+    u64         epoch; // the context's epoch when the job was started
+
+    // samples are numbered from first_sample in every pixel, out of total_samples for the whole image
+    u32 first_sample;
+    u32 total_samples;
+
+    struct {
+        bool   enabled;
+        size_t min_spp;
+        size_t step_spp;
+        f32    threshold;
+    } adaptive;
+
+    struct {
+        bool   enabled;
+        i64    budget_us;
+        size_t pass_spp;
+    } time_budget;
+
+    struct {
+        const char* path; // NULL if the job isn't checkpointed
+        i64         interval_us;
+    } checkpoint;
+
+    struct {
+        bool   enabled;
+        size_t preview_scale;
+    } progressive;
+
+    struct {
+        RenderTileCallback tile;
+        RenderDoneCallback done;
+        void*              user;
+    } callbacks;
+
+    MaterialOverride overrides[RENDER_MAX_OVERRIDES];
+    size_t           num_overrides;
+} RenderJob;
+
+typedef struct {
+    RenderCtx* ctx;
+    size_t     index;
+    size_t     node; // NUMA node the worker is bound to, and the tile band it claims from first
+} RenderWorkerArg;
+
+// Per worker buffers for wavefront mode, only allocated once a worker gets a wavefront job
+typedef struct {
+    Wavefront* wf;
+    Ray*       rays;
+    Sampler*   samplers;
+    Color*     radiance;
+    PathGuide* guides;
+} WavefrontBatch;
+
+// Per worker copy of the tile being rendered: its estimates are copied in, sampled and resolved to pixels here, then
+// copied back to the shared accum and image a row at a time
+// Neighbouring tiles share cache lines at their edges (most of a narrow tile's lines), so samples added in place by
+// different workers kept bouncing those lines between cores, now each worker only writes its own lines until the tile
+// is done
+typedef struct {
+    PixelAccum* accum;
+    RGB*        pix;
+    Color*      radiance; // the tile's mean radiance, for the tile callback
+    size_t      len;
+} TileBuffer;
+
+// Workers live as long as the render context, between renders they sleep on job_ready until Render_Start bumps the
+// job generation, the last worker to finish a job marks the context finished and wakes anyone in Render_Wait
+// A job is rendered in passes, workers meet at a barrier after each pass and the last one to arrive decides which
+// tiles (if any) get samples in the next pass
+typedef struct RenderPool {
+    Mutex*     lock;
+    Condition* job_ready;
+    Condition* job_done;
+    Condition* pass_ready;
+
+    u64    generation;
+    size_t num_busy;
+    bool   shutdown;
+
+    RenderJob   job;
+    TileQueue   tiles;
+    CommitQueue commits;
+
+    // pass state, only touched under the lock
+    u64    pass;
+    size_t pass_spp;
+    size_t pass_scale; // pixel block size the pass samples once, more than 1 for a progressive job's preview pass
+    size_t pass_spp_done;
+    size_t num_arrived;
+    bool   job_complete;
+
+    // time budgeted jobs: started when the job starts, lapped at the end of each pass
+    Stopwatch* clock;
+    i64        pass_start_us;
+    u64        pass_start_samples;
+    i64        checkpoint_us;
+
+    PixelAccum* accum;
+    size_t      accum_len;
+
+    // a pool spread over NUMA nodes (see Render_Set_Numa) gives each node a replica of the scene and allocates accum
+    // from the OS so its rows can be placed on the node whose band covers them
+    size_t num_nodes;
+    Scene* replicas[NUMA_MAX_NODES];
+    Scene* replica_source; // the scene the replicas are copies of, NULL if they have to be rebuilt
+    u64    accum_layout;   // tile layout the accum rows were placed for
+
+    size_t           num_threads;
+    Thread**         threads;
+    RenderWorkerArg* thread_args;
+} RenderPool;
+
+// Buffers for rendering on the calling thread (see Render_Now), kept between renders like the pool's
+typedef struct RenderLocal {
+    TileQueue      tiles;
+    PixelAccum*    accum;
+    size_t         accum_len;
+    WavefrontBatch batch;
+    TileBuffer     tile_buf;
+} RenderLocal;
+
+intern void RenderPool_Delete(RenderPool* pool);
+intern void RenderLocal_Delete(RenderLocal* local);
+
 RenderCtx* Render_New(Scene* scene, ImageRGB* img, Camera* cam)
 {
     RenderCtx* ctx = (RenderCtx*)malloc(sizeof(*ctx));
@@ -32,243 +245,2253 @@ RenderCtx* Render_New(Scene* scene, ImageRGB* img, Camera* cam)
     ctx->scene = scene;
     ctx->img   = img;
 
-    ctx->waiter_args   = NULL;
-    ctx->waiter_thread = NULL;
+    ctx->pool        = NULL;
+    ctx->local       = NULL;
+    ctx->last_local  = false;
+    ctx->num_threads = NUM_HYPERTHREADS;
+    ctx->numa        = false;
+
+    ctx->tile_size.w = RENDER_TILE_W_PX;
+    ctx->tile_size.h = RENDER_TILE_H_PX;
+
+    ctx->mode      = RENDER_MODE_PATH;
+    ctx->sampler   = SAMPLER_SOBOL;
+    ctx->seed      = RENDER_DEFAULT_SEED;
+    ctx->sort_rays = false;
+    ctx->denoise   = false;
+    ctx->aovs      = false;
+
+    ctx->adaptive.min_spp   = RENDER_ADAPTIVE_MIN_SPP;
+    ctx->adaptive.step_spp  = RENDER_ADAPTIVE_STEP_SPP;
+    ctx->adaptive.threshold = 0.0f;
+
+    ctx->time_budget.budget_ms = 0;
+    ctx->time_budget.pass_spp  = RENDER_BUDGET_PASS_SPP;
 
+    ctx->checkpoint.path        = NULL;
+    ctx->checkpoint.interval_ms = 0;
+
+    ctx->region.num_rects = 0;
+    ctx->overrides.count  = 0;
+
+    ctx->sample_range.first = 0;
+    ctx->sample_range.total = 0;
+
+    ctx->progressive.enabled       = false;
+    ctx->progressive.preview_scale = 1;
+
+    ctx->callbacks.tile = NULL;
+    ctx->callbacks.done = NULL;
+    ctx->callbacks.user = NULL;
+
+    ctx->stats = (RenderStats){.samples = 0, .passes = 0, .spp = 0};
+
+    ctx->epoch    = 0;
     ctx->finished = true;
 
     return ctx;
 }
 
-// TODO: rethink this part of the API, we should be able to reuse a render context (I think)
 void Render_Delete(RenderCtx* ctx)
 {
-    if (ctx->waiter_thread) {
-        Thread_Delete(ctx->waiter_thread);
+    if (ctx->pool) {
+        Render_Wait(ctx);
+        RenderPool_Delete(ctx->pool);
+    }
+
+    if (ctx->local) {
+        RenderLocal_Delete(ctx->local);
     }
 
-    free(ctx->waiter_args);
     free(ctx);
 }
 
-intern Color RayColor(Scene* scene, Ray* ray, size_t depth)
+// guide (if not NULL) is set to what the camera ray first sees, depth must be at least 1
+intern Color RayColor(Scene* scene, Ray* ray, size_t depth, PathGuide* guide)
 {
-    if (depth == 0) {
-        return COLOR_BLACK;
-    }
+    Color      radiance   = COLOR_BLACK;
+    Color      throughput = COLOR_WHITE;
+    PathVertex prev       = Integrator_CameraVertex(ray);
+    Ray        cur        = *ray;
+
+    for (size_t bounce = 0; bounce < depth; bounce++) {
+        Sampler_StartBounce((u32)bounce);
+
+        Object* objHit = NULL;
+        HitInfo hit;
+
+        bool hit_any = Scene_ClosestHit(scene, &cur, &objHit, &hit);
 
-    Object* objHit = NULL;
-    HitInfo hit;
+        if (bounce == 0 && guide != NULL) {
+            *guide = Integrator_Guide(scene, &cur, hit_any ? objHit : NULL, &hit);
+        }
+
+        if (!hit_any) {
+            Color sky = vmul(Scene_Get_SkyColor(scene, cur.dir), Integrator_SkyWeight(scene, &prev, cur.dir));
+            radiance  = Color_BrightenBy(radiance, Color_Tint(throughput, sky));
+            break;
+        }
 
-    if (Scene_ClosestHit(scene, ray, &objHit, &hit)) {
         Ray   bouncedRay;
         Color surfaceColor;
         Color emittedColor;
+        bool  bounced = Material_Bounce(Object_Material(objHit), &cur, &hit, &surfaceColor, &emittedColor, &bouncedRay);
 
-        if (Material_Bounce(objHit->material, ray, &hit, &surfaceColor, &emittedColor, &bouncedRay)) {
-            return Color_BrightenBy(emittedColor, Color_Tint(surfaceColor, RayColor(scene, &bouncedRay, depth - 1)));
-        } else {
-            return emittedColor;
+        f32 emission_weight = Integrator_EmissionWeight(scene, &prev, objHit, &hit);
+
+        radiance = Color_BrightenBy(radiance, Color_Tint(throughput, vmul(emittedColor, emission_weight)));
+
+        if (!bounced) {
+            break;
+        }
+
+        // direct light shares its credit with what the next bounce would find, so it needs a next bounce
+        ShadowRay shadow;
+        bool      light_sampled = bounce + 1 < depth && Integrator_SampleDirect(scene, objHit, &cur, &hit, &shadow);
+
+        if (light_sampled && shadow.dist > 0.0f && !Scene_Occluded(scene, &shadow.ray, shadow.dist)) {
+            radiance = Color_BrightenBy(radiance, Color_Tint(throughput, shadow.contrib));
         }
+
+        prev       = Integrator_ScatterVertex(objHit, &cur, &hit, &bouncedRay, light_sampled);
+        throughput = Color_Tint(throughput, surfaceColor);
+        cur        = bouncedRay;
     }
 
-    return Scene_Get_SkyColor(scene, ray->dir);
+    return radiance;
 }
 
-typedef struct {
-    RenderCtx*        ctx;
-    Vector(WorkUnit)* work;
+// Draws the camera dimensions (pixel position then lens position) of the bound sampler
+intern Ray CameraRay(Camera* cam, size_t image_width, size_t image_height, size_t xx, size_t yy)
+{
+    point2 jitter              = Sampler_2D();
+    f32    horizontal_fraction = (xx + jitter.x) / (f32)(image_width - 1);
+    f32    vertical_fraction   = (yy + jitter.y) / (f32)(image_height - 1);
 
-    struct {
-        size_t samples_per_pixel;
-        size_t max_ray_depth;
-    } params;
-} RenderThreadArg;
+    return Camera_GetRay(cam, horizontal_fraction, vertical_fraction);
+}
+
+intern inline void PixelAccum_Add(PixelAccum* acc, Color color)
+{
+    acc->sum = vadd(acc->sum, color);
+    acc->samples += 1;
 
-intern RGB RenderPixel(
-    Camera* cam,
-    Scene*  scene,
-    size_t  samples_per_pixel,
-    size_t  max_ray_bounces,
-    size_t  image_width,
-    size_t  image_height,
-    size_t  xx,
-    size_t  yy)
+    f32 lum   = Color_Luminance(color);
+    f32 delta = lum - acc->lum_mean;
+    acc->lum_mean += delta / (f32)acc->samples;
+    acc->lum_m2 += delta * (lum - acc->lum_mean);
+}
+
+// Called before the sample's PixelAccum_Add, so the first sample's material is the one kept
+intern inline void PixelAccum_AddGuide(PixelAccum* acc, PathGuide* guide)
 {
-    Color cum_color = vec(0, 0, 0);
+    if (acc->samples == 0) {
+        acc->material = guide->material;
+    }
 
-    for (size_t samples = 0; samples < samples_per_pixel; samples++) {
-        f32 horizontal_fraction = (xx + Random_Unilateral()) / (f32)(image_width - 1);
-        f32 vertical_fraction   = (yy + Random_Unilateral()) / (f32)(image_height - 1);
+    acc->albedo_sum = vadd(acc->albedo_sum, guide->albedo);
+    acc->normal_sum = vadd(acc->normal_sum, guide->normal);
+    acc->depth_sum += guide->depth;
+}
 
-        Ray   ray       = Camera_GetRay(cam, horizontal_fraction, vertical_fraction);
-        Color ray_color = RayColor(scene, &ray, max_ray_bounces);
-        cum_color       = vadd(cum_color, ray_color);
+// Relative standard error of the pixel's mean luminance, dark pixels are measured against a floor so they don't
+// demand samples forever for noise that can't be seen
+intern f32 PixelAccum_Error(PixelAccum* acc)
+{
+    if (acc->samples < 2) {
+        return INF;
     }
 
-    Color avg_color = vdiv(cum_color, samples_per_pixel);
-    return RGB_FromColor(avg_color);
+    f32 variance = acc->lum_m2 / (f32)(acc->samples - 1);
+    f32 std_err  = sqrtf(variance / (f32)acc->samples);
+
+    return std_err / maxf(acc->lum_mean, RENDER_ADAPTIVE_LUMINANCE_FLOOR);
 }
 
-intern void RenderTile(Camera* cam, Scene* scene, ImageRGB* img, Tile* tile, size_t spp, size_t md)
+// Traces one path at a time through RayColor, accum is the tile's own copy of its estimates (see TileBuffer)
+intern void SampleTile_Path(RenderJob* job, PixelAccum* accum, Tile* tile, size_t spp)
 {
+    ImageRGB* img = job->img;
+
     for (size_t yy = tile->y; yy < tile->y + tile->h; yy++) {
         for (size_t xx = tile->x; xx < tile->x + tile->w; xx++) {
-            RGB pixel = RenderPixel(cam, scene, spp, md, img->res.width, img->res.height, xx, yy);
-            ImageRGB_SetPixel(img, xx, yy, pixel);
+            PixelAccum* acc = &accum[(yy - tile->y) * tile->w + (xx - tile->x)];
+
+            for (size_t samples = 0; samples < spp; samples++) {
+                Sampler sampler = Sampler_Make(
+                    job->sampler,
+                    job->seed,
+                    xx,
+                    yy,
+                    job->first_sample + acc->samples,
+                    job->total_samples);
+                Sampler_Bind(&sampler);
+
+                Ray       ray = CameraRay(job->cam, img->res.width, img->res.height, xx, yy);
+                PathGuide guide;
+                Color     color = RayColor(job->scene, &ray, job->max_ray_depth, job->guided ? &guide : NULL);
+
+                if (job->guided) {
+                    PixelAccum_AddGuide(acc, &guide);
+                }
+
+                PixelAccum_Add(acc, color);
+            }
         }
     }
+
+    Sampler_Bind(NULL);
 }
 
-intern bool AtomicClaimTile(RenderCtx* ctx, Vector(WorkUnit)* work, size_t x, size_t y)
+// Generates the tile's camera rays a batch at a time and traces each batch through the wavefront stages, accum is the
+// tile's own copy of its estimates
+intern void SampleTile_Wavefront(RenderJob* job, PixelAccum* accum, Tile* tile, size_t spp, WavefrontBatch* batch)
 {
-    // convert (x, y) tile coords to the (array, bit) index
-    size_t tile_w      = RENDER_TILE_W_PX;
-    size_t num_tiles_w = (ctx->img->res.width + tile_w - 1) / tile_w;
+    ImageRGB* img        = job->img;
+    size_t    batch_size = Wavefront_BatchSize(batch->wf);
+    size_t    num_paths  = tile->w * tile->h * spp;
 
-    size_t linear_index = y * num_tiles_w + x;
-    size_t array_index  = linear_index / 8;
-    size_t bit_index    = linear_index % 8;
+    // paths are numbered pixel-major within the tile, so path / spp is the tile-local pixel
+    for (size_t first = 0; first < num_paths; first += batch_size) {
+        size_t num_rays = MIN(batch_size, num_paths - first);
 
-    u8 claim_mask = 1 << bit_index;
-    if (!(claim_mask & __atomic_fetch_or(&work->at[array_index].taken8, claim_mask, __ATOMIC_RELAXED))) {
-        return true;
-    } else {
-        return false;
+        for (size_t ii = 0; ii < num_rays; ii++) {
+            size_t pixel = (first + ii) / spp;
+            size_t xx    = tile->x + pixel % tile->w;
+            size_t yy    = tile->y + pixel / tile->w;
+
+            // the pixel's samples in this batch haven't been added yet, so its sample index is offset by the path's
+            u32 index = job->first_sample + accum[pixel].samples + (u32)((first + ii) % spp);
+
+            batch->samplers[ii] = Sampler_Make(job->sampler, job->seed, xx, yy, index, job->total_samples);
+            Sampler_Bind(&batch->samplers[ii]);
+
+            batch->rays[ii] = CameraRay(job->cam, img->res.width, img->res.height, xx, yy);
+        }
+
+        Sampler_Bind(NULL);
+
+        Wavefront_Trace(
+            batch->wf,
+            job->scene,
+            batch->samplers,
+            batch->rays,
+            batch->radiance,
+            job->guided ? batch->guides : NULL,
+            num_rays,
+            job->max_ray_depth);
+
+        for (size_t ii = 0; ii < num_rays; ii++) {
+            PixelAccum* acc = &accum[(first + ii) / spp];
+
+            if (job->guided) {
+                PixelAccum_AddGuide(acc, &batch->guides[ii]);
+            }
+
+            PixelAccum_Add(acc, batch->radiance[ii]);
+        }
     }
 }
 
-intern void Render_Worker(void* arg)
+intern void TileBuffer_Reserve(TileBuffer* buf, size_t num_pixels)
+{
+    if (buf->len >= num_pixels) {
+        return;
+    }
+
+    Aligned_Free(buf->accum);
+    Aligned_Free(buf->pix);
+    Aligned_Free(buf->radiance);
+
+    buf->accum    = (PixelAccum*)Aligned_Alloc(SZ_CACHE_LINE, num_pixels * sizeof(PixelAccum));
+    buf->pix      = (RGB*)Aligned_Alloc(SZ_CACHE_LINE, num_pixels * sizeof(RGB));
+    buf->radiance = (Color*)Aligned_Alloc(SZ_CACHE_LINE, num_pixels * sizeof(Color));
+    buf->len      = num_pixels;
+
+    if (buf->accum == NULL || buf->pix == NULL || buf->radiance == NULL) {
+        ABORT("Failed to allocate tile buffer");
+    }
+}
+
+intern void TileBuffer_Uninit(TileBuffer* buf)
+{
+    Aligned_Free(buf->accum);
+    Aligned_Free(buf->pix);
+    Aligned_Free(buf->radiance);
+
+    buf->accum    = NULL;
+    buf->pix      = NULL;
+    buf->radiance = NULL;
+    buf->len      = 0;
+}
+
+// Adds spp samples to every pixel of the tile and returns the worst pixel error in it
+intern f32 RenderTile(RenderJob* job, PixelAccum* accum, Tile* tile, size_t spp, WavefrontBatch* batch, TileBuffer* buf)
+{
+    ImageRGB* img = job->img;
+
+    TileBuffer_Reserve(buf, tile->w * tile->h);
+
+    for (size_t row = 0; row < tile->h; row++) {
+        PixelAccum* src = &accum[(tile->y + row) * img->res.width + tile->x];
+        memcpy(&buf->accum[row * tile->w], src, tile->w * sizeof(PixelAccum));
+    }
+
+    // whatever still draws from the thread's generator (the legacy materials) gets a stream of its own per tile and
+    // pass, so the image doesn't depend on which worker claims the tile
+    size_t corner = tile->y * img->res.width + tile->x;
+    Random_Seed_Stream(job->seed, ((u64)corner << 32) | (job->first_sample + buf->accum[0].samples));
+
+    switch (job->mode) {
+        case RENDER_MODE_PATH: {
+            SampleTile_Path(job, buf->accum, tile, spp);
+        } break;
+
+        case RENDER_MODE_WAVEFRONT: {
+            SampleTile_Wavefront(job, buf->accum, tile, spp, batch);
+        } break;
+    }
+
+    f32 max_error = 0.0f;
+
+    for (size_t yy = tile->y; yy < tile->y + tile->h; yy++) {
+        for (size_t xx = tile->x; xx < tile->x + tile->w; xx++) {
+            size_t      pixel = (yy - tile->y) * tile->w + (xx - tile->x);
+            PixelAccum* acc   = &buf->accum[pixel];
+
+            if (acc->samples > 0) {
+                buf->pix[pixel] = RGB_FromColor(vdiv(acc->sum, (f32)acc->samples));
+            } else {
+                buf->pix[pixel] = ImageRGB_GetPixel(img, xx, yy);
+            }
+
+            if (job->adaptive.enabled) {
+                max_error = maxf(max_error, PixelAccum_Error(acc));
+            }
+        }
+    }
+
+    for (size_t row = 0; row < tile->h; row++) {
+        PixelAccum* dst = &accum[(tile->y + row) * img->res.width + tile->x];
+        memcpy(dst, &buf->accum[row * tile->w], tile->w * sizeof(PixelAccum));
+    }
+
+    ImageRGB_SetRect(img, tile->x, tile->y, tile->w, tile->h, buf->pix);
+
+    return max_error;
+}
+
+// Low resolution preview of the tile (see Render_Set_Progressive): one path through the top left pixel of each
+// scale x scale block fills the whole block of the image, nothing is added to the accum
+// The paths are few enough that they're traced one at a time whatever the job's mode
+intern void PreviewTile(RenderJob* job, Tile* tile, size_t scale, TileBuffer* buf)
 {
-    Random_Seed_HighEntropy();
-
-    RenderThreadArg* args = (RenderThreadArg*)arg;
-
-    Vector(WorkUnit)* work  = args->work;
-    RenderCtx*        ctx   = args->ctx;
-    ImageRGB*         img   = ctx->img;
-    Camera*           cam   = ctx->cam;
-    Scene*            scene = ctx->scene;
-
-    size_t spp = args->params.samples_per_pixel;
-    size_t md  = args->params.max_ray_depth;
-
-    // convert (x, y) tile coords to the (array, bit) index
-    size_t tile_w      = RENDER_TILE_W_PX;
-    size_t tile_h      = RENDER_TILE_H_PX;
-    size_t num_tiles_w = (img->res.width + tile_w - 1) / tile_w;
-    size_t num_tiles_h = (img->res.height + tile_h - 1) / tile_h;
-
-    // iterate over the tiles, try to claim them, if claimed render the tile
-    for (size_t yy = 0; yy < num_tiles_h; yy++) {
-        for (size_t xx = 0; xx < num_tiles_w; xx++) {
-            if (AtomicClaimTile(ctx, work, xx, yy)) {
-                Tile tile = {
-                    .x = xx * tile_w,
-                    .y = yy * tile_h,
-                    .w = MIN(tile_w, img->res.width - xx * tile_w),
-                    .h = MIN(tile_h, img->res.height - yy * tile_h),
-                };
-                RenderTile(cam, scene, img, &tile, spp, md);
+    ImageRGB* img = job->img;
+
+    TileBuffer_Reserve(buf, tile->w * tile->h);
+
+    size_t corner = tile->y * img->res.width + tile->x;
+    Random_Seed_Stream(job->seed, ((u64)corner << 32) | job->first_sample);
+
+    for (size_t by = 0; by < tile->h; by += scale) {
+        for (size_t bx = 0; bx < tile->w; bx += scale) {
+            size_t xx = tile->x + bx;
+            size_t yy = tile->y + by;
+
+            Sampler sampler = Sampler_Make(job->sampler, job->seed, xx, yy, job->first_sample, job->total_samples);
+            Sampler_Bind(&sampler);
+
+            Ray ray   = CameraRay(job->cam, img->res.width, img->res.height, xx, yy);
+            RGB color = RGB_FromColor(RayColor(job->scene, &ray, job->max_ray_depth, NULL));
+
+            for (size_t row = by; row < MIN(by + scale, tile->h); row++) {
+                for (size_t col = bx; col < MIN(bx + scale, tile->w); col++) {
+                    buf->pix[row * tile->w + col] = color;
+                }
             }
         }
     }
 
-    return;
+    Sampler_Bind(NULL);
+
+    ImageRGB_SetRect(img, tile->x, tile->y, tile->w, tile->h, buf->pix);
 }
 
-typedef struct {
-    RenderCtx* ctx;
-    size_t     samples_per_pixel;
-    size_t     max_ray_depth;
-} WaiterThreadArg;
+// Hands a tile RenderTile just finished to the job's tile callback (if any), with the mean radiance of its pixels
+intern void RenderJob_ReportTile(RenderJob* job, Tile* tile, TileBuffer* buf, size_t pass)
+{
+    if (job->callbacks.tile == NULL) {
+        return;
+    }
+
+    size_t num_pixels = tile->w * tile->h;
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        PixelAccum* acc   = &buf->accum[ii];
+        buf->radiance[ii] = acc->samples > 0 ? vdiv(acc->sum, (f32)acc->samples) : COLOR_BLACK;
+    }
+
+    RenderTileResult result = {
+        .rect     = {.x = tile->x, .y = tile->y, .w = tile->w, .h = tile->h},
+        .pass     = pass,
+        .spp      = buf->accum[0].samples,
+        .radiance = buf->radiance,
+    };
+
+    job->callbacks.tile(&result, job->callbacks.user);
+}
 
-intern void Render_Waiter(void* arg)
+// A job stops being current once Render_Cancel moves the context on to a new epoch
+intern inline bool RenderJob_Current(RenderJob* job, RenderCtx* ctx)
 {
-    // grab args
-    WaiterThreadArg* args = (WaiterThreadArg*)arg;
+    return __atomic_load_n(&ctx->epoch, __ATOMIC_ACQUIRE) == job->epoch;
+}
 
-    RenderCtx* ctx               = args->ctx;
-    size_t     samples_per_pixel = args->samples_per_pixel;
-    size_t     max_ray_depth     = args->max_ray_depth;
+intern bool WavefrontBatch_Init(WavefrontBatch* batch, size_t batch_size)
+{
+    batch->wf       = Wavefront_New(batch_size);
+    batch->rays     = (Ray*)malloc(batch_size * sizeof(Ray));
+    batch->samplers = (Sampler*)malloc(batch_size * sizeof(Sampler));
+    batch->radiance = (Color*)malloc(batch_size * sizeof(Color));
+    batch->guides   = (PathGuide*)malloc(batch_size * sizeof(PathGuide));
 
-    // create queue of work units
-    size_t tile_w = RENDER_TILE_W_PX, tile_h = RENDER_TILE_H_PX;
-    size_t num_tiles_w = (ctx->img->res.width + tile_w - 1) / tile_w;
-    size_t num_tiles_h = (ctx->img->res.height + tile_h - 1) / tile_h;
+    return batch->wf != NULL && batch->rays != NULL && batch->samplers != NULL && batch->radiance != NULL
+           && batch->guides != NULL;
+}
 
-    Vector(WorkUnit) vect;
-    Vector_Init(&vect, num_tiles_w * num_tiles_h);
-    Vector_ExtendBy(&vect, num_tiles_w * num_tiles_h);
+intern void WavefrontBatch_Uninit(WavefrontBatch* batch)
+{
+    if (batch->wf) {
+        Wavefront_Delete(batch->wf);
+    }
 
-    // create worker threads
-    size_t num_threads    = NUM_HYPERTHREADS;
-    size_t min_stack_size = 2 * 1024 * 1024;
+    free(batch->guides);
+    free(batch->radiance);
+    free(batch->samplers);
+    free(batch->rays);
+}
 
-    Thread*         threads[NUM_HYPERTHREADS];
-    RenderThreadArg thread_args[NUM_HYPERTHREADS];
+static_assert_decl((RENDER_COMMIT_QUEUE_SIZE & (RENDER_COMMIT_QUEUE_SIZE - 1)) == 0);
 
-    for (size_t ii = 0; ii < num_threads; ii++) {
-        threads[ii] = Thread_New();
-        if (!threads[ii]) {
-            ABORT("Failed to create render worker thread");
+intern bool CommitQueue_Init(CommitQueue* queue)
+{
+    queue->slots = (CommitSlot*)malloc(RENDER_COMMIT_QUEUE_SIZE * sizeof(CommitSlot));
+    if (queue->slots == NULL) {
+        return false;
+    }
+
+    for (u64 ii = 0; ii < RENDER_COMMIT_QUEUE_SIZE; ii++) {
+        queue->slots[ii].seq = ii;
+    }
+
+    queue->head       = 0;
+    queue->tail       = 0;
+    queue->overflowed = false;
+
+    return true;
+}
+
+intern void CommitQueue_Uninit(CommitQueue* queue)
+{
+    free(queue->slots);
+}
+
+// A slot is free to publish into when its sequence number is the position, and holds a published rect when it's one
+// past it, consuming it moves it a lap ahead
+intern void CommitQueue_Push(CommitQueue* queue, RenderRect rect)
+{
+    u64         pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    CommitSlot* slot;
+
+    while (true) {
+        slot    = &queue->slots[pos & (RENDER_COMMIT_QUEUE_SIZE - 1)];
+        i64 lag = (i64)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (lag == 0) {
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (lag < 0) {
+            // full, the consumer will have to take the whole image
+            __atomic_store_n(&queue->overflowed, true, __ATOMIC_RELEASE);
+            return;
+        } else {
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->rect = rect;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+intern bool CommitQueue_Pop(CommitQueue* queue, RenderRect* rect)
+{
+    u64         pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    CommitSlot* slot;
+
+    while (true) {
+        slot    = &queue->slots[pos & (RENDER_COMMIT_QUEUE_SIZE - 1)];
+        i64 lag = (i64)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+
+        if (lag == 0) {
+            if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (lag < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
         }
+    }
 
-        Thread_Set_StackSize(threads[ii], min_stack_size);
+    *rect = slot->rect;
+    __atomic_store_n(&slot->seq, pos + RENDER_COMMIT_QUEUE_SIZE, __ATOMIC_RELEASE);
 
-        thread_args[ii].ctx                      = ctx;
-        thread_args[ii].work                     = &vect;
-        thread_args[ii].params.max_ray_depth     = max_ray_depth;
-        thread_args[ii].params.samples_per_pixel = samples_per_pixel;
+    return true;
+}
 
-        if (!Thread_Spawn(threads[ii], Render_Worker, &thread_args[ii])) {
-            ABORT("Failed to start render worker thread");
+intern bool TileQueue_Init(TileQueue* queue)
+{
+    if (!Vector_Init(&queue->order, Vector_Default_Capacity)) {
+        goto error_Order;
+    }
+
+    if (!Vector_Init(&queue->active, Vector_Default_Capacity)) {
+        goto error_Active;
+    }
+
+    if (!Vector_Init(&queue->error, Vector_Default_Capacity)) {
+        goto error_Error;
+    }
+
+    queue->img_w  = 0;
+    queue->img_h  = 0;
+    queue->tile_w = 0;
+    queue->tile_h = 0;
+    queue->layout = 0;
+
+    queue->num_regions = 0;
+
+    queue->num_bands = 1;
+    queue->bands[0]  = (TileCursor){.next = 0, .end = 0};
+
+    return true;
+
+error_Error:
+    Vector_Uninit(&queue->active);
+error_Active:
+    Vector_Uninit(&queue->order);
+error_Order:
+    return false;
+}
+
+// Band of the tiles in a row of the tile grid, the grid's rows are split into num_bands runs as even as they can be
+// (band b starts at row b * num_rows / num_bands)
+intern size_t TileQueue_Band(TileQueue* queue, size_t tile_y)
+{
+    size_t num_rows = (queue->img_h + queue->tile_h - 1) / queue->tile_h;
+    size_t row      = tile_y / queue->tile_h;
+
+    return ((row + 1) * queue->num_bands - 1) / num_rows;
+}
+
+// Pixel rows [y0, y1) covered by a band
+intern void TileQueue_BandRows(TileQueue* queue, size_t band, size_t* y0, size_t* y1)
+{
+    size_t num_rows = (queue->img_h + queue->tile_h - 1) / queue->tile_h;
+
+    *y0 = MIN(band * num_rows / queue->num_bands * queue->tile_h, queue->img_h);
+    *y1 = MIN((band + 1) * num_rows / queue->num_bands * queue->tile_h, queue->img_h);
+}
+
+// Rewinds the cursors, keeping the same active tiles
+intern size_t TileQueue_Rewind(TileQueue* queue)
+{
+    // the order is grouped by band, so the active tiles (indices into it in ascending order) are too
+    size_t first = 0;
+
+    for (size_t band = 0; band < queue->num_bands; band++) {
+        size_t end = first;
+        while (end < queue->active.length && TileQueue_Band(queue, queue->order.at[queue->active.at[end]].y) == band) {
+            end += 1;
         }
+
+        queue->bands[band] = (TileCursor){.next = first, .end = end};
+        first              = end;
     }
 
-    // wait for worker threads to finish
-    for (size_t ii = 0; ii < num_threads; ii++) {
-        Thread_Join(threads[ii]);
-        Thread_Delete(threads[ii]);
+    return queue->active.length;
+}
+
+// Marks every tile active and rewinds the cursors
+intern bool TileQueue_Activate(TileQueue* queue)
+{
+    queue->active.length = 0;
+    queue->error.length  = 0;
+
+    if (!Vector_Reserve(&queue->active, queue->order.length) || !Vector_Reserve(&queue->error, queue->order.length)) {
+        return false;
     }
 
-    Vector_Uninit(&vect);
-    ctx->finished = true;
+    for (size_t ii = 0; ii < queue->order.length; ii++) {
+        Vector_Push(&queue->active, (u32)ii);
+        Vector_Push(&queue->error, INF);
+    }
+
+    TileQueue_Rewind(queue);
+    return true;
 }
 
-void Start_WaiterThread(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth)
+// Splits the union of the rects into disjoint ones (the merged spans of the rects crossing each horizontal band between
+// rect edges), so a pixel covered by several regions still only belongs to one tile, returns the number written
+intern size_t RenderRect_Disjoint(const RenderRect* rects, size_t num_rects, RenderRect* disjoint)
 {
-    WaiterThreadArg* waiter_args = (WaiterThreadArg*)calloc(1, sizeof(*waiter_args));
-    if (waiter_args == NULL) {
-        ABORT("Failed to create render waiter thread args");
+    size_t edges[2 * RENDER_MAX_REGIONS];
+    size_t num_edges = 0;
+
+    for (size_t ii = 0; ii < num_rects; ii++) {
+        edges[num_edges++] = rects[ii].y;
+        edges[num_edges++] = rects[ii].y + rects[ii].h;
     }
 
-    waiter_args->ctx               = ctx;
-    waiter_args->max_ray_depth     = max_ray_depth;
-    waiter_args->samples_per_pixel = samples_per_pixel;
+    // insertion sorts, there are only a handful of regions
+    for (size_t ii = 1; ii < num_edges; ii++) {
+        size_t edge = edges[ii];
+        size_t jj   = ii;
+
+        for (; jj > 0 && edges[jj - 1] > edge; jj--) {
+            edges[jj] = edges[jj - 1];
+        }
 
-    Thread* waiter_thread = Thread_New();
-    if (waiter_thread == NULL) {
-        ABORT("Failed to create render waiter thread");
+        edges[jj] = edge;
     }
 
-    Thread_Set_StackSize(waiter_thread, 64 * 1024);
+    size_t num_disjoint = 0;
+
+    for (size_t ee = 0; ee + 1 < num_edges; ee++) {
+        size_t band_y0 = edges[ee];
+        size_t band_y1 = edges[ee + 1];
 
-    ctx->waiter_thread = waiter_thread;
-    ctx->waiter_args   = waiter_args;
+        if (band_y0 == band_y1) {
+            continue;
+        }
+
+        // spans of the rects crossing the band, sorted by x
+        RenderRect spans[RENDER_MAX_REGIONS];
+        size_t     num_spans = 0;
+
+        for (size_t ii = 0; ii < num_rects; ii++) {
+            if (rects[ii].y <= band_y0 && band_y1 <= rects[ii].y + rects[ii].h) {
+                size_t jj = num_spans++;
+
+                for (; jj > 0 && spans[jj - 1].x > rects[ii].x; jj--) {
+                    spans[jj] = spans[jj - 1];
+                }
+
+                spans[jj] = rects[ii];
+            }
+        }
+
+        // overlapping (or touching) spans are merged
+        for (size_t ii = 0; ii < num_spans;) {
+            size_t span_x0 = spans[ii].x;
+            size_t span_x1 = spans[ii].x + spans[ii].w;
 
-    if (!Thread_Spawn(waiter_thread, Render_Waiter, waiter_args)) {
-        ABORT("Failed to start render waiter thread");
+            for (ii++; ii < num_spans && spans[ii].x <= span_x1; ii++) {
+                span_x1 = MAX(span_x1, spans[ii].x + spans[ii].w);
+            }
+
+            disjoint[num_disjoint++] = (RenderRect){
+                .x = span_x0,
+                .y = band_y0,
+                .w = span_x1 - span_x0,
+                .h = band_y1 - band_y0,
+            };
+        }
     }
+
+    return num_disjoint;
 }
 
-void Render_Start(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth)
+// Rewinds the cursors with every tile active, the tile order is only rebuilt if the image or tile dimensions, the
+// regions (clipped to the image) or the number of bands changed since the last render
+intern bool TileQueue_Reset(
+    TileQueue*        queue,
+    size_t            img_w,
+    size_t            img_h,
+    size_t            tile_w,
+    size_t            tile_h,
+    const RenderRect* regions,
+    size_t            num_regions,
+    size_t            num_bands)
 {
-    ctx->finished = false;
-    Start_WaiterThread(ctx, samples_per_pixel, max_ray_depth);
+    if (queue->img_w == img_w && queue->img_h == img_h && queue->tile_w == tile_w && queue->tile_h == tile_h
+        && queue->num_regions == num_regions && memcmp(queue->regions, regions, num_regions * sizeof(RenderRect)) == 0
+        && queue->num_bands == num_bands) {
+        return TileQueue_Activate(queue);
+    }
+
+    size_t num_tiles_w = (img_w + tile_w - 1) / tile_w;
+    size_t num_tiles_h = (img_h + tile_h - 1) / tile_h;
+
+    RenderRect disjoint[2 * RENDER_MAX_REGIONS * RENDER_MAX_REGIONS];
+    size_t     num_disjoint = RenderRect_Disjoint(regions, num_regions, disjoint);
+
+    queue->order.length = 0;
+    if (!Vector_Reserve(&queue->order, num_tiles_w * num_tiles_h)) {
+        return false;
+    }
+
+    queue->img_w  = img_w;
+    queue->img_h  = img_h;
+    queue->tile_w = tile_w;
+    queue->tile_h = tile_h;
+
+    memcpy(queue->regions, regions, num_regions * sizeof(RenderRect));
+    queue->num_regions = num_regions;
+    queue->num_bands   = num_bands;
+    queue->layout += 1;
+
+    // a single hilbert curve over a very wide (or tall) grid wastes most of its length outside the image, so the grid
+    // is covered by square blocks (sized to the short side) laid along the long side with a hilbert curve in each
+    size_t short_side = MIN(num_tiles_w, num_tiles_h);
+    u32    block_side = 1;
+    while (block_side < short_side) {
+        block_side *= 2;
+    }
+
+    bool   wide       = num_tiles_w >= num_tiles_h;
+    size_t long_side  = wide ? num_tiles_w : num_tiles_h;
+    size_t num_blocks = (long_side + block_side - 1) / block_side;
+    u64    curve_len  = (u64)block_side * block_side;
+
+    // with several bands the curves are walked once per band, keeping just that band's tiles, so the order is grouped
+    // by band and still in hilbert order within each
+    for (size_t band = 0; band < num_bands; band++) {
+        for (size_t block = 0; block < num_blocks; block++) {
+            for (u64 dist = 0; dist < curve_len; dist++) {
+                u32 bx, by;
+                Hilbert_ToXY(block_side, dist, &bx, &by);
+
+                size_t tx = wide ? block * block_side + bx : bx;
+                size_t ty = wide ? by : block * block_side + by;
+
+                if (tx >= num_tiles_w || ty >= num_tiles_h || TileQueue_Band(queue, ty * tile_h) != band) {
+                    continue;
+                }
+
+                size_t tile_x0 = tx * tile_w;
+                size_t tile_y0 = ty * tile_h;
+                size_t tile_x1 = MIN(tile_x0 + tile_w, img_w);
+                size_t tile_y1 = MIN(tile_y0 + tile_h, img_h);
+
+                for (size_t ii = 0; ii < num_disjoint; ii++) {
+                    size_t x0 = MAX(tile_x0, disjoint[ii].x);
+                    size_t y0 = MAX(tile_y0, disjoint[ii].y);
+                    size_t x1 = MIN(tile_x1, disjoint[ii].x + disjoint[ii].w);
+                    size_t y1 = MIN(tile_y1, disjoint[ii].y + disjoint[ii].h);
+
+                    if (x0 < x1 && y0 < y1) {
+                        Tile tile = {.w = x1 - x0, .h = y1 - y0, .x = x0, .y = y0};
+                        Vector_Push(&queue->order, tile);
+                    }
+                }
+            }
+        }
+    }
+
+    return TileQueue_Activate(queue);
+}
+
+// Drops the tiles whose error is under the threshold from the active set (keeping their order) and rewinds the
+// cursors, returns the number of tiles left
+intern size_t TileQueue_Retire(TileQueue* queue, f32 threshold)
+{
+    size_t num_active = 0;
+
+    for (size_t ii = 0; ii < queue->active.length; ii++) {
+        u32 order_index = queue->active.at[ii];
+        if (queue->error.at[order_index] >= threshold) {
+            queue->active.at[num_active++] = order_index;
+        }
+    }
+
+    queue->active.length = num_active;
+
+    return TileQueue_Rewind(queue);
+}
+
+// Number of pixels covered by the active tiles
+intern u64 TileQueue_ActivePixels(TileQueue* queue)
+{
+    u64 num_pixels = 0;
+
+    for (size_t ii = 0; ii < queue->active.length; ii++) {
+        Tile* tile = &queue->order.at[queue->active.at[ii]];
+        num_pixels += (u64)tile->w * tile->h;
+    }
+
+    return num_pixels;
+}
+
+intern void TileQueue_Uninit(TileQueue* queue)
+{
+    Vector_Uninit(&queue->error);
+    Vector_Uninit(&queue->active);
+    Vector_Uninit(&queue->order);
+}
+
+// Claims the next active tile of the band, or of the bands after it once it's empty, tile_index receives its index in
+// the tile order
+intern bool TileQueue_Claim(TileQueue* queue, size_t band, Tile* tile, u32* tile_index)
+{
+    for (size_t ii = 0; ii < queue->num_bands; ii++) {
+        TileCursor* cursor = &queue->bands[(band + ii) % queue->num_bands];
+
+        // a drained band is skipped without touching its cursor, so helping out doesn't contend with its workers
+        if (__atomic_load_n(&cursor->next, __ATOMIC_RELAXED) >= cursor->end) {
+            continue;
+        }
+
+        size_t index = __atomic_fetch_add(&cursor->next, 1, __ATOMIC_RELAXED);
+        if (index < cursor->end) {
+            *tile_index = queue->active.at[index];
+            *tile       = queue->order.at[*tile_index];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Decides the sample count of the next pass and which tiles it covers, called by the last worker to finish a pass
+// with the lock held
+intern void RenderPool_PreparePass(RenderPool* pool, RenderCtx* ctx)
+{
+    RenderJob* job = &pool->job;
+
+    // a cancelled job ends here, with whatever its finished tiles left in the image
+    if (!RenderJob_Current(job, ctx)) {
+        pool->job_complete = true;
+        return;
+    }
+
+    // the preview pass adds no samples, the job proper starts over every tile
+    if (pool->pass_scale > 1) {
+        pool->pass_scale = 1;
+        TileQueue_Rewind(&pool->tiles);
+        return;
+    }
+
+    pool->pass_spp_done += pool->pass_spp;
+    ctx->stats.passes += 1;
+    ctx->stats.spp = pool->pass_spp_done;
+
+    size_t num_active = 0;
+    if (pool->pass_spp_done < job->samples_per_pixel) {
+        if (job->adaptive.enabled) {
+            num_active = TileQueue_Retire(&pool->tiles, job->adaptive.threshold);
+        } else if (job->time_budget.enabled || job->checkpoint.path != NULL || job->progressive.enabled) {
+            num_active = TileQueue_Rewind(&pool->tiles);
+        }
+    }
+
+    if (num_active == 0) {
+        pool->job_complete = true;
+        return;
+    }
+
+    size_t spp_left = job->samples_per_pixel - pool->pass_spp_done;
+
+    if (!job->time_budget.enabled) {
+        size_t step_spp = RENDER_CHECKPOINT_PASS_SPP;
+        if (job->adaptive.enabled) {
+            step_spp = job->adaptive.step_spp;
+        } else if (job->progressive.enabled) {
+            step_spp = MIN(pool->pass_spp * 2, (size_t)RENDER_PROGRESSIVE_MAX_PASS_SPP);
+        }
+
+        pool->pass_spp = MIN(step_spp, spp_left);
+        return;
+    }
+
+    // the next pass is sized from what the last one cost per sample, it's cut short (or skipped) if the whole pass
+    // wouldn't finish before the deadline
+    Stopwatch_Stop(pool->clock);
+    i64 elapsed_us = Stopwatch_Elapsed(pool->clock, STOPWATCH_MICROSECONDS);
+    u64 samples    = __atomic_load_n(&ctx->stats.samples, __ATOMIC_RELAXED);
+
+    f64 pass_us        = (f64)(elapsed_us - pool->pass_start_us);
+    f64 pass_samples   = (f64)MAX(samples - pool->pass_start_samples, (u64)1);
+    f64 spp_cost_us    = pass_us / pass_samples * (f64)TileQueue_ActivePixels(&pool->tiles) * RENDER_BUDGET_MARGIN;
+    f64 remaining_us   = (f64)(job->time_budget.budget_us - elapsed_us);
+    f64 spp_affordable = spp_cost_us > 0.0 ? remaining_us / spp_cost_us : (f64)spp_left;
+
+    pool->pass_start_us      = elapsed_us;
+    pool->pass_start_samples = samples;
+
+    if (spp_affordable < 1.0) {
+        pool->job_complete = true;
+        return;
+    }
+
+    size_t pass_spp = MIN(job->time_budget.pass_spp, spp_left);
+    pool->pass_spp  = MIN(pass_spp, (size_t)spp_affordable);
+}
+
+/* ---- Checkpoints ---- */
+
+// A checkpoint is everything needed to carry on with the job from the start of a pass: the header, the accumulated
+// estimate of every pixel, then the active tiles of the next pass and the error of every tile
+// The generators need no state of their own, every sample value is derived from the seed and the pixel's sample count
+#define RENDER_CHECKPOINT_MAGIC   ("RTCKPT")
+#define RENDER_CHECKPOINT_VERSION (5)
+
+typedef struct {
+    char magic[8];
+    u32  version;
+    u32  accum_size; // sizeof(PixelAccum), guards against a checkpoint from a different build
+
+    u64 img_w, img_h;
+    u64 tile_w, tile_h;
+    u64 num_tiles;
+    u64 num_active;
+    u64 num_bands; // the tile order (which the active tiles index) depends on it
+
+    u64 num_regions;
+    u64 regions[RENDER_MAX_REGIONS][4]; // x, y, w, h
+
+    u64 seed;
+    u32 sampler;
+    u32 adaptive;
+    f32 adaptive_threshold;
+    u32 adaptive_min_spp;
+    u32 adaptive_step_spp;
+    u32 denoise;
+    u32 aovs; // the guide sums are only accumulated by renders that are denoised or write AOVs
+
+    u64 samples_per_pixel;
+    u32 first_sample;
+    u32 total_samples;
+    u64 max_ray_depth;
+    u64 pass_spp;
+    u64 pass_spp_done;
+
+    u64 stats_samples;
+    u64 stats_passes;
+} CheckpointHeader;
+
+intern bool RenderPool_WriteCheckpointData(RenderPool* pool, RenderCtx* ctx, FILE* fd)
+{
+    RenderJob* job   = &pool->job;
+    TileQueue* tiles = &pool->tiles;
+
+    CheckpointHeader header = {
+        .magic              = {0},
+        .version            = RENDER_CHECKPOINT_VERSION,
+        .accum_size         = sizeof(PixelAccum),
+        .img_w              = job->img->res.width,
+        .img_h              = job->img->res.height,
+        .tile_w             = tiles->tile_w,
+        .tile_h             = tiles->tile_h,
+        .num_tiles          = tiles->order.length,
+        .num_active         = tiles->active.length,
+        .num_bands          = tiles->num_bands,
+        .num_regions        = ctx->region.num_rects,
+        .regions            = {{0}},
+        .seed               = ctx->seed,
+        .sampler            = (u32)job->sampler,
+        .adaptive           = job->adaptive.enabled,
+        .adaptive_threshold = job->adaptive.threshold,
+        .adaptive_min_spp   = (u32)job->adaptive.min_spp,
+        .adaptive_step_spp  = (u32)job->adaptive.step_spp,
+        .denoise            = job->denoise,
+        .aovs               = job->guided && !job->denoise,
+        .samples_per_pixel  = job->samples_per_pixel,
+        .first_sample       = job->first_sample,
+        .total_samples      = job->total_samples,
+        .max_ray_depth      = job->max_ray_depth,
+        .pass_spp           = pool->pass_spp,
+        .pass_spp_done      = pool->pass_spp_done,
+        .stats_samples      = __atomic_load_n(&ctx->stats.samples, __ATOMIC_RELAXED),
+        .stats_passes       = ctx->stats.passes,
+    };
+    memcpy(header.magic, RENDER_CHECKPOINT_MAGIC, sizeof(RENDER_CHECKPOINT_MAGIC));
+
+    for (size_t ii = 0; ii < ctx->region.num_rects; ii++) {
+        header.regions[ii][0] = ctx->region.rects[ii].x;
+        header.regions[ii][1] = ctx->region.rects[ii].y;
+        header.regions[ii][2] = ctx->region.rects[ii].w;
+        header.regions[ii][3] = ctx->region.rects[ii].h;
+    }
+
+    size_t num_pixels = header.img_w * header.img_h;
+
+    return fwrite(&header, sizeof(header), 1, fd) == 1
+           && fwrite(pool->accum, sizeof(PixelAccum), num_pixels, fd) == num_pixels
+           && fwrite(tiles->active.at, sizeof(u32), tiles->active.length, fd) == tiles->active.length
+           && fwrite(tiles->error.at, sizeof(f32), tiles->error.length, fd) == tiles->error.length;
+}
+
+// Writes the checkpoint next to its destination first and moves it into place, so a node killed mid write leaves the
+// previous checkpoint intact
+intern bool RenderPool_WriteCheckpoint(RenderPool* pool, RenderCtx* ctx, const char* path)
+{
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return false;
+    }
+
+    FILE* fd = fopen(tmp_path, "wb");
+    if (fd == NULL) {
+        return false;
+    }
+
+    bool written = RenderPool_WriteCheckpointData(pool, ctx, fd);
+    written      = fclose(fd) == 0 && written;
+
+    if (!written) {
+        remove(tmp_path);
+        return false;
+    }
+
+    // rename doesn't replace an existing file on every platform
+    if (rename(tmp_path, path) != 0) {
+        remove(path);
+        if (rename(tmp_path, path) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Called by the last worker to finish a pass with the lock held, after the next pass is prepared
+intern void RenderPool_Checkpoint(RenderPool* pool, RenderCtx* ctx)
+{
+    RenderJob* job = &pool->job;
+    if (job->checkpoint.path == NULL || pool->job_complete) {
+        return;
+    }
+
+    Stopwatch_Stop(pool->clock);
+    i64 elapsed_us = Stopwatch_Elapsed(pool->clock, STOPWATCH_MICROSECONDS);
+    if (elapsed_us - pool->checkpoint_us < job->checkpoint.interval_us) {
+        return;
+    }
+
+    // a failed checkpoint isn't worth stopping the render over, the next one might work
+    if (!RenderPool_WriteCheckpoint(pool, ctx, job->checkpoint.path)) {
+        fprintf(stderr, "Failed to write render checkpoint to %s\n", job->checkpoint.path);
+    }
+
+    pool->checkpoint_us = elapsed_us;
+}
+
+// The body of a checkpoint, read and checked before the context or the pool are touched
+typedef struct {
+    PixelAccum* accum;
+    u32*        active;
+    f32*        error;
+} CheckpointData;
+
+intern void CheckpointData_Free(CheckpointData* data)
+{
+    free(data->accum);
+    free(data->active);
+    free(data->error);
+}
+
+// Reads the body following a checkpoint's header, false if it's cut short or the active tiles aren't ascending
+// indices into the tile order
+intern bool CheckpointData_Read(CheckpointData* data, CheckpointHeader* header, FILE* fd)
+{
+    size_t num_pixels = header->img_w * header->img_h;
+
+    // a checkpoint without active tiles is still read, so the buffers are never empty
+    data->accum  = (PixelAccum*)malloc(num_pixels * sizeof(PixelAccum));
+    data->active = (u32*)malloc(MAX(header->num_active, (u64)1) * sizeof(u32));
+    data->error  = (f32*)malloc(MAX(header->num_tiles, (u64)1) * sizeof(f32));
+
+    if (data->accum == NULL || data->active == NULL || data->error == NULL
+        || fread(data->accum, sizeof(PixelAccum), num_pixels, fd) != num_pixels
+        || fread(data->active, sizeof(u32), header->num_active, fd) != header->num_active
+        || fread(data->error, sizeof(f32), header->num_tiles, fd) != header->num_tiles) {
+        CheckpointData_Free(data);
+        return false;
+    }
+
+    for (size_t ii = 0; ii < header->num_active; ii++) {
+        if (data->active[ii] >= header->num_tiles || (ii > 0 && data->active[ii] <= data->active[ii - 1])) {
+            CheckpointData_Free(data);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Restores the job state read from a checkpoint into a job prepared with the header's settings
+intern void RenderPool_RestoreCheckpoint(
+    RenderPool*       pool,
+    RenderCtx*        ctx,
+    CheckpointHeader* header,
+    CheckpointData*   data)
+{
+    TileQueue* tiles      = &pool->tiles;
+    size_t     num_pixels = header->img_w * header->img_h;
+
+    // the queue was prepared with every tile active, so it has room for all of them
+    tiles->active.length = header->num_active;
+    tiles->error.length  = header->num_tiles;
+
+    memcpy(pool->accum, data->accum, num_pixels * sizeof(PixelAccum));
+    memcpy(tiles->active.at, data->active, header->num_active * sizeof(u32));
+    memcpy(tiles->error.at, data->error, header->num_tiles * sizeof(f32));
+
+    TileQueue_Rewind(tiles);
+
+    // tiles that are already done won't be rendered again, so the image gets the restored estimate up front (and the
+    // preview all of it)
+    ImageRGB* img = pool->job.img;
+    for (size_t yy = 0; yy < img->res.height; yy++) {
+        for (size_t xx = 0; xx < img->res.width; xx++) {
+            PixelAccum* acc = &pool->accum[yy * img->res.width + xx];
+
+            if (acc->samples > 0) {
+                ImageRGB_SetPixel(img, xx, yy, RGB_FromColor(vdiv(acc->sum, (f32)acc->samples)));
+            }
+        }
+    }
+
+    __atomic_store_n(&pool->commits.overflowed, true, __ATOMIC_RELEASE);
+
+    pool->pass_spp      = header->pass_spp;
+    pool->pass_scale    = 1;
+    pool->pass_spp_done = header->pass_spp_done;
+
+    ctx->stats.samples = header->stats_samples;
+    ctx->stats.passes  = header->stats_passes;
+    ctx->stats.spp     = header->pass_spp_done;
+
+    pool->pass_start_samples = header->stats_samples;
+
+    // the budget of a resumed render counts from the resume, so it starts over with the smallest pass
+    if (pool->job.time_budget.enabled) {
+        pool->pass_spp = MIN(pool->pass_spp, pool->job.time_budget.pass_spp);
+    }
+}
+
+// Barrier at the end of a pass, returns false once the job has no passes left, otherwise the sample count and block
+// size for the next pass are written to pass_spp and pass_scale
+intern bool RenderPool_EndPass(RenderPool* pool, RenderCtx* ctx, size_t* pass_spp, size_t* pass_scale)
+{
+    Mutex_Lock(pool->lock);
+
+    u64 pass = pool->pass;
+    pool->num_arrived += 1;
+
+    if (pool->num_arrived == pool->num_threads) {
+        pool->num_arrived = 0;
+        RenderPool_PreparePass(pool, ctx);
+        RenderPool_Checkpoint(pool, ctx);
+        pool->pass += 1;
+        Condition_Broadcast(pool->pass_ready);
+    } else {
+        while (pool->pass == pass) {
+            Condition_Wait(pool->pass_ready, pool->lock);
+        }
+    }
+
+    bool more_passes = !pool->job_complete;
+    *pass_spp        = pool->pass_spp;
+    *pass_scale      = pool->pass_scale;
+
+    Mutex_Unlock(pool->lock);
+    return more_passes;
+}
+
+// Writes the denoised estimates of every pixel with samples to the image
+intern void Render_Denoise(ImageRGB* img, PixelAccum* accum, size_t num_threads)
+{
+    size_t num_pixels = img->res.width * img->res.height;
+
+    Color* radiance = (Color*)malloc(num_pixels * sizeof(Color));
+    Color* albedo   = (Color*)malloc(num_pixels * sizeof(Color));
+    vec3*  normal   = (vec3*)malloc(num_pixels * sizeof(vec3));
+    f32*   depth    = (f32*)malloc(num_pixels * sizeof(f32));
+    f32*   variance = (f32*)malloc(num_pixels * sizeof(f32));
+
+    if (radiance == NULL || albedo == NULL || normal == NULL || depth == NULL || variance == NULL) {
+        ABORT("Failed to allocate denoiser input");
+    }
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        PixelAccum* acc = &accum[ii];
+
+        if (acc->samples == 0) {
+            radiance[ii] = COLOR_BLACK;
+            albedo[ii]   = COLOR_BLACK;
+            normal[ii]   = vec3_Set(0.0f);
+            depth[ii]    = 0.0f;
+            variance[ii] = -1.0f;
+            continue;
+        }
+
+        f32 inv_samples = 1.0f / (f32)acc->samples;
+
+        radiance[ii] = vmul(acc->sum, inv_samples);
+        albedo[ii]   = vmul(acc->albedo_sum, inv_samples);
+        normal[ii]   = vmul(acc->normal_sum, inv_samples);
+        depth[ii]    = acc->depth_sum * inv_samples;
+
+        // a single sample is taken to be as noisy as its own value
+        if (acc->samples > 1) {
+            variance[ii] = acc->lum_m2 / (f32)(acc->samples - 1) * inv_samples;
+        } else {
+            variance[ii] = acc->lum_mean * acc->lum_mean;
+        }
+    }
+
+    DenoiseImage image = {
+        .width    = img->res.width,
+        .height   = img->res.height,
+        .radiance = radiance,
+        .albedo   = albedo,
+        .normal   = normal,
+        .depth    = depth,
+        .variance = variance,
+    };
+
+    Denoise_Run(&image, RENDER_DENOISE_ITERATIONS, num_threads);
+
+    for (size_t yy = 0; yy < img->res.height; yy++) {
+        for (size_t xx = 0; xx < img->res.width; xx++) {
+            if (accum[yy * img->res.width + xx].samples != 0) {
+                ImageRGB_SetPixel(img, xx, yy, RGB_FromColor(radiance[yy * img->res.width + xx]));
+            }
+        }
+    }
+
+    free(variance);
+    free(depth);
+    free(normal);
+    free(albedo);
+    free(radiance);
+}
+
+intern void Render_Worker(void* arg)
+{
+    RenderWorkerArg* args = (RenderWorkerArg*)arg;
+    RenderCtx*       ctx  = args->ctx;
+    RenderPool*      pool = ctx->pool;
+
+    WavefrontBatch batch           = {.wf = NULL, .rays = NULL, .samplers = NULL, .radiance = NULL, .guides = NULL};
+    TileBuffer     tile_buf        = {.accum = NULL, .pix = NULL, .radiance = NULL, .len = 0};
+    u64            seen_generation = 0;
+
+    // everything the worker allocates (like its wavefront buffers) is placed on its node from here on
+    if (pool->num_nodes > 1) {
+        Numa_Bind(args->node);
+    }
+
+    while (true) {
+        // wait for a new job (or to be told to exit)
+        Mutex_Lock(pool->lock);
+        while (pool->generation == seen_generation && !pool->shutdown) {
+            Condition_Wait(pool->job_ready, pool->lock);
+        }
+
+        if (pool->shutdown) {
+            Mutex_Unlock(pool->lock);
+            WavefrontBatch_Uninit(&batch);
+            TileBuffer_Uninit(&tile_buf);
+            return;
+        }
+
+        seen_generation   = pool->generation;
+        RenderJob job     = pool->job;
+        size_t pass_spp   = pool->pass_spp;
+        size_t pass_scale = pool->pass_scale;
+        Mutex_Unlock(pool->lock);
+
+        if (pool->num_nodes > 1) {
+            job.scene = pool->replicas[args->node];
+        }
+
+        Object_Bind_Overrides(job.overrides, job.num_overrides);
+
+        if (job.mode == RENDER_MODE_WAVEFRONT) {
+            if (batch.wf == NULL && !WavefrontBatch_Init(&batch, RENDER_WAVEFRONT_BATCH_SIZE)) {
+                ABORT("Failed to allocate wavefront path buffers");
+            }
+
+            Wavefront_Set_RaySorting(batch.wf, job.sort_rays);
+        }
+
+        do {
+            // claim tiles until the pass runs dry (or the job is cancelled)
+            Tile tile;
+            u32  tile_index;
+            u64  num_samples = 0;
+
+            while (RenderJob_Current(&job, ctx) && TileQueue_Claim(&pool->tiles, args->node, &tile, &tile_index)) {
+                if (pass_scale > 1) {
+                    PreviewTile(&job, &tile, pass_scale, &tile_buf);
+                } else {
+                    f32 error = RenderTile(&job, pool->accum, &tile, pass_spp, &batch, &tile_buf);
+
+                    pool->tiles.error.at[tile_index] = error;
+                    num_samples += (u64)tile.w * tile.h * pass_spp;
+
+                    // passes only advances between passes, while every worker is held at the barrier
+                    RenderJob_ReportTile(&job, &tile, &tile_buf, ctx->stats.passes);
+                }
+
+                CommitQueue_Push(&pool->commits, (RenderRect){.x = tile.x, .y = tile.y, .w = tile.w, .h = tile.h});
+            }
+
+            __atomic_fetch_add(&ctx->stats.samples, num_samples, __ATOMIC_RELAXED);
+        } while (RenderPool_EndPass(pool, ctx, &pass_spp, &pass_scale));
+
+        Object_Bind_Overrides(NULL, 0);
+
+        // last one out denoises the image (if asked to, and the job wasn't cancelled), marks the job as finished and
+        // calls the done callback
+        Mutex_Lock(pool->lock);
+        if (pool->num_busy == 1) {
+            // the others are done with accum, and Render_Wait keeps waiting until this worker isn't busy
+            Mutex_Unlock(pool->lock);
+
+            bool cancelled = !RenderJob_Current(&job, ctx);
+            if (job.denoise && !cancelled) {
+                Render_Denoise(job.img, pool->accum, pool->num_threads);
+                __atomic_store_n(&pool->commits.overflowed, true, __ATOMIC_RELEASE);
+            }
+
+            __atomic_store_n(&ctx->finished, true, __ATOMIC_RELEASE);
+
+            if (job.callbacks.done != NULL) {
+                job.callbacks.done(ctx, cancelled, job.callbacks.user);
+            }
+
+            Mutex_Lock(pool->lock);
+        }
+
+        pool->num_busy -= 1;
+        if (pool->num_busy == 0) {
+            Condition_Broadcast(pool->job_done);
+        }
+        Mutex_Unlock(pool->lock);
+    }
+}
+
+// Spreads the workers over the nodes in proportion to their processors, each node gets a contiguous run of them
+intern void RenderPool_AssignNodes(RenderPool* pool)
+{
+    size_t node_cpus[NUMA_MAX_NODES];
+    size_t total_cpus = 0;
+
+    for (size_t node = 0; node < pool->num_nodes; node++) {
+        node_cpus[node] = MAX(Numa_NodeCPUs(node), (size_t)1);
+        total_cpus += node_cpus[node];
+    }
+
+    for (size_t ii = 0; ii < pool->num_threads; ii++) {
+        size_t cpu  = ii * total_cpus / pool->num_threads;
+        size_t node = 0;
+
+        while (cpu >= node_cpus[node]) {
+            cpu -= node_cpus[node];
+            node += 1;
+        }
+
+        pool->thread_args[ii].node = node;
+    }
+}
+
+intern RenderPool* RenderPool_New(RenderCtx* ctx, size_t num_threads, size_t num_nodes)
+{
+    RenderPool* pool = (RenderPool*)Aligned_Alloc(alignof(RenderPool), sizeof(RenderPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->lock       = Mutex_New();
+    pool->job_ready  = Condition_New();
+    pool->job_done   = Condition_New();
+    pool->pass_ready = Condition_New();
+    pool->generation = 0;
+    pool->num_busy   = 0;
+    pool->shutdown   = false;
+
+    pool->pass          = 0;
+    pool->pass_spp      = 0;
+    pool->pass_spp_done = 0;
+    pool->num_arrived   = 0;
+    pool->job_complete  = false;
+
+    pool->clock              = Stopwatch_New();
+    pool->pass_start_us      = 0;
+    pool->pass_start_samples = 0;
+
+    pool->accum     = NULL;
+    pool->accum_len = 0;
+
+    pool->num_nodes      = num_nodes;
+    pool->replica_source = NULL;
+    pool->accum_layout   = 0;
+
+    for (size_t node = 0; node < NUMA_MAX_NODES; node++) {
+        pool->replicas[node] = NULL;
+    }
+
+    pool->num_threads = num_threads;
+    pool->threads     = (Thread**)calloc(num_threads, sizeof(Thread*));
+    pool->thread_args = (RenderWorkerArg*)calloc(num_threads, sizeof(RenderWorkerArg));
+
+    if (pool->lock == NULL || pool->job_ready == NULL || pool->job_done == NULL || pool->pass_ready == NULL
+        || pool->clock == NULL || pool->threads == NULL || pool->thread_args == NULL) {
+        ABORT("Failed to create render thread pool");
+    }
+
+    if (!TileQueue_Init(&pool->tiles)) {
+        ABORT("Failed to create render tile queue");
+    }
+
+    if (!CommitQueue_Init(&pool->commits)) {
+        ABORT("Failed to create render commit queue");
+    }
+
+    for (size_t ii = 0; ii < num_threads; ii++) {
+        pool->thread_args[ii].ctx   = ctx;
+        pool->thread_args[ii].index = ii;
+        pool->thread_args[ii].node  = 0;
+    }
+
+    if (num_nodes > 1) {
+        RenderPool_AssignNodes(pool);
+    }
+
+    // workers grab the pool through the context
+    ctx->pool = pool;
+
+    size_t min_stack_size = 2 * 1024 * 1024;
+
+    for (size_t ii = 0; ii < num_threads; ii++) {
+        pool->threads[ii] = Thread_New();
+        if (!pool->threads[ii]) {
+            ABORT("Failed to create render worker thread");
+        }
+
+        Thread_Set_StackSize(pool->threads[ii], min_stack_size);
+
+        if (!Thread_Spawn(pool->threads[ii], Render_Worker, &pool->thread_args[ii])) {
+            ABORT("Failed to start render worker thread");
+        }
+    }
+
+    return pool;
+}
+
+intern void RenderPool_Delete(RenderPool* pool)
+{
+    Mutex_Lock(pool->lock);
+    pool->shutdown = true;
+    Condition_Broadcast(pool->job_ready);
+    Mutex_Unlock(pool->lock);
+
+    for (size_t ii = 0; ii < pool->num_threads; ii++) {
+        Thread_Join(pool->threads[ii]);
+        Thread_Delete(pool->threads[ii]);
+    }
+
+    TileQueue_Uninit(&pool->tiles);
+    CommitQueue_Uninit(&pool->commits);
+
+    if (pool->num_nodes > 1) {
+        Numa_Free(pool->accum, pool->accum_len * sizeof(PixelAccum));
+    } else {
+        free(pool->accum);
+    }
+
+    for (size_t node = 0; node < NUMA_MAX_NODES; node++) {
+        if (pool->replicas[node] != NULL) {
+            Scene_Delete(pool->replicas[node]);
+        }
+    }
+
+    Stopwatch_Delete(pool->clock);
+    Condition_Delete(pool->pass_ready);
+    Condition_Delete(pool->job_done);
+    Condition_Delete(pool->job_ready);
+    Mutex_Delete(pool->lock);
+
+    free(pool->thread_args);
+    free(pool->threads);
+    Aligned_Free(pool);
+}
+
+void Render_Set_TileSize(RenderCtx* ctx, size_t tile_w, size_t tile_h)
+{
+    ctx->tile_size.w = MAX(tile_w, (size_t)1);
+    ctx->tile_size.h = MAX(tile_h, (size_t)1);
+}
+
+void Render_Set_Mode(RenderCtx* ctx, RenderMode mode)
+{
+    ctx->mode = mode;
+}
+
+void Render_Set_Sampler(RenderCtx* ctx, SamplerType sampler)
+{
+    ctx->sampler = sampler;
+}
+
+void Render_Set_Seed(RenderCtx* ctx, u64 seed)
+{
+    ctx->seed = seed;
+}
+
+// NOTE: only wavefront mode has batches of secondary rays to sort, path mode ignores this
+void Render_Set_RaySorting(RenderCtx* ctx, bool sort_rays)
+{
+    ctx->sort_rays = sort_rays;
+}
+
+// Denoised renders also record what each pixel's camera rays first hit, and once every sample is in the image is
+// replaced by a filtered copy of the estimates (see rt/denoise.h), the estimates themselves are left as they were
+void Render_Set_Denoise(RenderCtx* ctx, bool enabled)
+{
+    ctx->denoise = enabled;
+}
+
+// Renders with AOVs also record what each pixel's camera rays first hit, for Render_Read_AOVs
+void Render_Set_AOVs(RenderCtx* ctx, bool enabled)
+{
+    ctx->aovs = enabled;
+}
+
+void Render_Set_Adaptive(RenderCtx* ctx, size_t min_spp, size_t step_spp, f32 threshold)
+{
+    ctx->adaptive.min_spp   = MAX(min_spp, (size_t)2);
+    ctx->adaptive.step_spp  = MAX(step_spp, (size_t)1);
+    ctx->adaptive.threshold = threshold;
+}
+
+// Writes a checkpoint to path at the first pass boundary at least interval_ms after the last one, the job is rendered
+// in passes of RENDER_CHECKPOINT_PASS_SPP to have boundaries to write them at, a NULL path disables checkpoints
+void Render_Set_Checkpoint(RenderCtx* ctx, const char* path, i64 interval_ms)
+{
+    ctx->checkpoint.path        = path;
+    ctx->checkpoint.interval_ms = MAX(interval_ms, (i64)0);
+}
+
+// Renders passes of pass_spp over the frame until the next pass wouldn't finish within budget_ms of Render_Start (or
+// the job's samples per pixel are reached), budget_ms <= 0 disables the budget
+void Render_Set_TimeBudget(RenderCtx* ctx, i64 budget_ms, size_t pass_spp)
+{
+    ctx->time_budget.budget_ms = budget_ms;
+    ctx->time_budget.pass_spp  = MAX(pass_spp, (size_t)1);
+}
+
+// Restricts the next renders to the union of the rects (clipped to the image), only their pixels are sampled and
+// written, so the rest of the image keeps whatever it had (e.g. an earlier full render), num_rects = 0 goes back to
+// rendering the whole image
+void Render_Set_Region(RenderCtx* ctx, const RenderRect* rects, size_t num_rects)
+{
+    if (num_rects > RENDER_MAX_REGIONS) {
+        ABORT("Too many render regions (%zu), at most %d are supported", num_rects, RENDER_MAX_REGIONS);
+    }
+
+    memcpy(ctx->region.rects, rects, num_rects * sizeof(RenderRect));
+    ctx->region.num_rects = num_rects;
+}
+
+// Shades every object with original's material with replacement's instead (the scene itself isn't touched, so
+// contexts rendering the same scene at the same time can each override different materials), num_overrides = 0
+// clears them
+void Render_Set_MaterialOverrides(RenderCtx* ctx, const MaterialOverride* overrides, size_t num_overrides)
+{
+    if (num_overrides > RENDER_MAX_OVERRIDES) {
+        ABORT("Too many material overrides (%zu), at most %d are supported", num_overrides, RENDER_MAX_OVERRIDES);
+    }
+
+    memcpy(ctx->overrides.list, overrides, num_overrides * sizeof(MaterialOverride));
+    ctx->overrides.count = num_overrides;
+}
+
+// Makes the next renders take samples [first_sample, first_sample + spp) of each pixel of an image rendered with
+// total_samples per pixel, so separate renders of different ranges (e.g. on different machines) sum to the same image
+// as one render of all of them, total_samples = 0 goes back to rendering whole images
+void Render_Set_SampleRange(RenderCtx* ctx, u32 first_sample, u32 total_samples)
+{
+    ctx->sample_range.first = first_sample;
+    ctx->sample_range.total = total_samples;
+}
+
+// Renders started by Render_Start go over the whole image in passes that double in spp (from 1 up to
+// RENDER_PROGRESSIVE_MAX_PASS_SPP) so the image sharpens everywhere at once, after a preview pass at 1/preview_scale of
+// the resolution (1 for none) that adds no samples, meant for interactive previews
+void Render_Set_Progressive(RenderCtx* ctx, bool enabled, size_t preview_scale)
+{
+    ctx->progressive.enabled       = enabled;
+    ctx->progressive.preview_scale = MAX(preview_scale, (size_t)1);
+}
+
+// Callbacks for the renders started after this (NULL for none), both are called from the render's threads with user:
+// on_tile as each tile with samples is written to the image (any number at once, from different threads), on_done once
+// the render has finished or been cancelled, before Render_Wait returns
+// Preview passes (see Render_Set_Progressive) and the denoised image only reach the image, and neither callback may
+// start or wait on a render of the context (cancelling is fine)
+void Render_Set_Callbacks(RenderCtx* ctx, RenderTileCallback on_tile, RenderDoneCallback on_done, void* user)
+{
+    ctx->callbacks.tile = on_tile;
+    ctx->callbacks.done = on_done;
+    ctx->callbacks.user = user;
+}
+
+void Render_Set_Threads(RenderCtx* ctx, size_t num_threads)
+{
+    num_threads = MAX(num_threads, (size_t)1);
+
+    if (num_threads == ctx->num_threads) {
+        return;
+    }
+
+    // the pool gets respawned with the new size on the next render
+    if (ctx->pool) {
+        Render_Wait(ctx);
+        RenderPool_Delete(ctx->pool);
+        ctx->pool = NULL;
+    }
+
+    ctx->num_threads = num_threads;
+}
+
+// Spreads the workers over the machine's NUMA nodes (if it has more than one): each node's workers are bound to it,
+// trace against a replica of the scene copied on the node, and claim tiles from a horizontal band of the image whose
+// accumulation rows are placed on the node before helping the other nodes with theirs
+// NOTE: the replicas cost a copy of the scene's objects and kd-tree per node, and are rebuilt after Render_Set_Job
+void Render_Set_Numa(RenderCtx* ctx, bool enabled)
+{
+    if (enabled == ctx->numa) {
+        return;
+    }
+
+    // the pool gets respawned with its workers bound (or not) on the next render
+    if (ctx->pool) {
+        Render_Wait(ctx);
+        RenderPool_Delete(ctx->pool);
+        ctx->pool = NULL;
+    }
+
+    ctx->numa = enabled;
+}
+
+void Render_Set_Job(RenderCtx* ctx, Scene* scene, ImageRGB* img, Camera* cam)
+{
+    Render_Wait(ctx);
+
+    // the scene could be a new one at the old one's address
+    if (ctx->pool) {
+        ctx->pool->replica_source = NULL;
+    }
+
+    ctx->scene = scene;
+    ctx->img   = img;
+    ctx->cam   = cam;
+}
+
+// The job the context's settings describe
+intern RenderJob RenderJob_Make(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth)
+{
+    // adaptive sampling only pays off if the base pass leaves samples for later passes
+    bool adaptive = ctx->adaptive.threshold > 0.0f && ctx->adaptive.min_spp < samples_per_pixel;
+
+    RenderJob job = {
+        .cam               = ctx->cam,
+        .scene             = ctx->scene,
+        .img               = ctx->img,
+        .mode              = ctx->mode,
+        .sampler           = ctx->sampler,
+        .seed              = (u32)(ctx->seed ^ (ctx->seed >> 32)),
+        .sort_rays         = ctx->sort_rays,
+        .denoise           = ctx->denoise,
+        .guided            = ctx->denoise || ctx->aovs,
+        .samples_per_pixel = samples_per_pixel,
+        .max_ray_depth     = max_ray_depth,
+        .epoch             = __atomic_load_n(&ctx->epoch, __ATOMIC_ACQUIRE),
+        .first_sample      = ctx->sample_range.first,
+        .total_samples     = ctx->sample_range.total ? ctx->sample_range.total : (u32)samples_per_pixel,
+        .adaptive = {
+            .enabled   = adaptive,
+            .min_spp   = ctx->adaptive.min_spp,
+            .step_spp  = ctx->adaptive.step_spp,
+            .threshold = ctx->adaptive.threshold,
+        },
+        .time_budget = {
+            .enabled   = ctx->time_budget.budget_ms > 0,
+            .budget_us = ctx->time_budget.budget_ms * 1000,
+            .pass_spp  = ctx->time_budget.pass_spp,
+        },
+        .checkpoint = {
+            .path        = ctx->checkpoint.path,
+            .interval_us = ctx->checkpoint.interval_ms * 1000,
+        },
+        .progressive = {
+            .enabled       = ctx->progressive.enabled,
+            .preview_scale = ctx->progressive.preview_scale,
+        },
+        .callbacks = {
+            .tile = ctx->callbacks.tile,
+            .done = ctx->callbacks.done,
+            .user = ctx->callbacks.user,
+        },
+        .overrides     = {},
+        .num_overrides = ctx->overrides.count,
+    };
+
+    memcpy(job.overrides, ctx->overrides.list, ctx->overrides.count * sizeof(MaterialOverride));
+
+    return job;
+}
+
+// Builds the tile order for the context's image and regions, with every tile active
+intern void RenderCtx_ResetTiles(RenderCtx* ctx, TileQueue* tiles, size_t num_bands)
+{
+    // the regions are clipped to the image, a render with regions that all miss it has nothing to do
+    size_t     img_w = ctx->img->res.width;
+    size_t     img_h = ctx->img->res.height;
+    RenderRect regions[RENDER_MAX_REGIONS];
+    size_t     num_regions = 0;
+
+    if (ctx->region.num_rects == 0) {
+        regions[num_regions++] = (RenderRect){.x = 0, .y = 0, .w = img_w, .h = img_h};
+    }
+
+    for (size_t ii = 0; ii < ctx->region.num_rects; ii++) {
+        RenderRect* rect = &ctx->region.rects[ii];
+
+        size_t x0 = MIN(rect->x, img_w);
+        size_t y0 = MIN(rect->y, img_h);
+        size_t x1 = MIN(rect->x + rect->w, img_w);
+        size_t y1 = MIN(rect->y + rect->h, img_h);
+
+        if (x0 < x1 && y0 < y1) {
+            regions[num_regions++] = (RenderRect){.x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0};
+        }
+    }
+
+    if (!TileQueue_Reset(tiles, img_w, img_h, ctx->tile_size.w, ctx->tile_size.h, regions, num_regions, num_bands)) {
+        ABORT("Failed to build render tile order");
+    }
+}
+
+// Zeroes the first num_pixels estimates, growing the buffer if it's too small
+intern void PixelAccum_Reset(PixelAccum** accum, size_t* accum_len, size_t num_pixels)
+{
+    if (*accum_len < num_pixels) {
+        free(*accum);
+        *accum     = (PixelAccum*)malloc(num_pixels * sizeof(PixelAccum));
+        *accum_len = num_pixels;
+
+        if (*accum == NULL) {
+            ABORT("Failed to allocate render accumulation buffer");
+        }
+    }
+
+    memset(*accum, 0, num_pixels * sizeof(PixelAccum));
+}
+
+typedef struct {
+    RenderPool* pool;
+    size_t      node;
+    bool        replicate;   // copy the job's scene for the node
+    bool        place_accum; // zero the accum rows of the node's bands (the first write to them)
+} NodeSetupArg;
+
+// Runs on a thread bound to the node, so what it writes first is placed there
+intern void RenderPool_SetupNode(void* arg)
+{
+    NodeSetupArg* args  = (NodeSetupArg*)arg;
+    RenderPool*   pool  = args->pool;
+    TileQueue*    tiles = &pool->tiles;
+
+    Numa_Bind(args->node);
+
+    if (args->replicate) {
+        if (pool->replicas[args->node] != NULL) {
+            Scene_Delete(pool->replicas[args->node]);
+        }
+
+        pool->replicas[args->node] = Scene_Replicate(pool->job.scene);
+        if (pool->replicas[args->node] == NULL) {
+            ABORT("Failed to replicate the scene on NUMA node %zu", args->node);
+        }
+    }
+
+    // a resumed job can have more bands than there are nodes, the extra ones are dealt out like the workers' claims
+    if (args->place_accum) {
+        for (size_t band = args->node; band < tiles->num_bands; band += pool->num_nodes) {
+            size_t y0, y1;
+            TileQueue_BandRows(tiles, band, &y0, &y1);
+
+            memset(&pool->accum[y0 * tiles->img_w], 0, (y1 - y0) * tiles->img_w * sizeof(PixelAccum));
+        }
+    }
+}
+
+// Zeroes the accum of a pool spread over NUMA nodes and makes sure each node has a replica of the job's scene, the
+// accum is reallocated (and its rows placed by a thread on each node) when the image or its bands change
+intern void RenderPool_PlaceJob(RenderPool* pool, size_t num_pixels)
+{
+    bool replicate   = pool->replica_source != pool->job.scene;
+    bool place_accum = pool->accum_len != num_pixels || pool->accum_layout != pool->tiles.layout;
+
+    if (place_accum) {
+        Numa_Free(pool->accum, pool->accum_len * sizeof(PixelAccum));
+
+        pool->accum        = (PixelAccum*)Numa_Alloc(num_pixels * sizeof(PixelAccum));
+        pool->accum_len    = num_pixels;
+        pool->accum_layout = pool->tiles.layout;
+
+        if (pool->accum == NULL) {
+            ABORT("Failed to allocate render accumulation buffer");
+        }
+    } else {
+        // the pages are already placed, writing them from here doesn't move them
+        memset(pool->accum, 0, num_pixels * sizeof(PixelAccum));
+    }
+
+    if (!replicate && !place_accum) {
+        return;
+    }
+
+    Thread*      threads[NUMA_MAX_NODES];
+    NodeSetupArg args[NUMA_MAX_NODES];
+
+    for (size_t node = 0; node < pool->num_nodes; node++) {
+        args[node] = (NodeSetupArg){
+            .pool        = pool,
+            .node        = node,
+            .replicate   = replicate,
+            .place_accum = place_accum,
+        };
+
+        threads[node] = Thread_New();
+        if (threads[node] == NULL || !Thread_Spawn(threads[node], RenderPool_SetupNode, &args[node])) {
+            ABORT("Failed to start NUMA node setup thread");
+        }
+    }
+
+    for (size_t node = 0; node < pool->num_nodes; node++) {
+        Thread_Join(threads[node]);
+        Thread_Delete(threads[node]);
+    }
+
+    pool->replica_source = pool->job.scene;
+}
+
+// Sets up a job from the context's settings with nothing rendered yet, called with the lock held
+intern void RenderPool_PrepareJob(
+    RenderPool* pool,
+    RenderCtx*  ctx,
+    size_t      samples_per_pixel,
+    size_t      max_ray_depth,
+    size_t      num_bands)
+{
+    pool->job = RenderJob_Make(ctx, samples_per_pixel, max_ray_depth);
+
+    size_t num_pixels = ctx->img->res.width * ctx->img->res.height;
+
+    RenderCtx_ResetTiles(ctx, &pool->tiles, num_bands);
+
+    if (pool->num_nodes > 1) {
+        RenderPool_PlaceJob(pool, num_pixels);
+    } else {
+        PixelAccum_Reset(&pool->accum, &pool->accum_len, num_pixels);
+    }
+
+    bool adaptive     = pool->job.adaptive.enabled;
+    bool budgeted     = pool->job.time_budget.enabled;
+    bool checkpointed = pool->job.checkpoint.path != NULL;
+    bool progressive  = pool->job.progressive.enabled;
+
+    // the base pass covers every tile with the minimum sample count, a time budgeted job starts with the smallest pass
+    // it can so it can measure what a pass costs
+    if (budgeted) {
+        pool->pass_spp = MIN(ctx->time_budget.pass_spp, samples_per_pixel);
+    } else if (adaptive) {
+        pool->pass_spp = ctx->adaptive.min_spp;
+    } else if (progressive) {
+        pool->pass_spp = 1;
+    } else if (checkpointed) {
+        pool->pass_spp = MIN((size_t)RENDER_CHECKPOINT_PASS_SPP, samples_per_pixel);
+    } else {
+        pool->pass_spp = samples_per_pixel;
+    }
+
+    pool->pass_scale         = progressive ? pool->job.progressive.preview_scale : 1;
+    pool->pass_spp_done      = 0;
+    pool->num_arrived        = 0;
+    pool->job_complete       = false;
+    pool->pass_start_us      = 0;
+    pool->pass_start_samples = 0;
+    pool->checkpoint_us      = 0;
+
+    ctx->stats = (RenderStats){.samples = 0, .passes = 0, .spp = 0};
+}
+
+// Wakes the workers on the prepared job, called with the lock held
+intern void RenderPool_LaunchJob(RenderPool* pool, RenderCtx* ctx)
+{
+    Stopwatch_Start(pool->clock);
+
+    ctx->last_local = false;
+    __atomic_store_n(&ctx->finished, false, __ATOMIC_RELEASE);
+
+    pool->num_busy = pool->num_threads;
+    pool->generation += 1;
+    Condition_Broadcast(pool->job_ready);
+}
+
+intern RenderPool* Render_Pool(RenderCtx* ctx)
+{
+    // only one render can be in flight per context
+    Render_Wait(ctx);
+
+    if (ctx->pool == NULL) {
+        // a node without workers would only get a replica nobody reads
+        size_t num_nodes = ctx->numa ? MIN(Numa_NodeCount(), (size_t)NUMA_MAX_NODES) : 1;
+        num_nodes        = MIN(num_nodes, ctx->num_threads);
+
+        if (RenderPool_New(ctx, ctx->num_threads, num_nodes) == NULL) {
+            ABORT("Failed to create render thread pool");
+        }
+    }
+
+    return ctx->pool;
+}
+
+void Render_Start(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth)
+{
+    RenderPool* pool = Render_Pool(ctx);
+
+    Mutex_Lock(pool->lock);
+    RenderPool_PrepareJob(pool, ctx, samples_per_pixel, max_ray_depth, pool->num_nodes);
+    RenderPool_LaunchJob(pool, ctx);
+    Mutex_Unlock(pool->lock);
+}
+
+// Replaces the context's settings with the ones a checkpoint was written with
+intern void RenderCtx_ApplyCheckpoint(RenderCtx* ctx, CheckpointHeader* header)
+{
+    ctx->seed    = header->seed;
+    ctx->sampler = (SamplerType)header->sampler;
+
+    ctx->sample_range.first = header->first_sample;
+    ctx->sample_range.total = header->total_samples;
+
+    ctx->region.num_rects = header->num_regions;
+    for (size_t ii = 0; ii < header->num_regions; ii++) {
+        ctx->region.rects[ii] = (RenderRect){
+            .x = header->regions[ii][0],
+            .y = header->regions[ii][1],
+            .w = header->regions[ii][2],
+            .h = header->regions[ii][3],
+        };
+    }
+    ctx->tile_size.w = header->tile_w;
+    ctx->tile_size.h = header->tile_h;
+
+    ctx->adaptive.min_spp   = header->adaptive_min_spp;
+    ctx->adaptive.step_spp  = header->adaptive_step_spp;
+    ctx->adaptive.threshold = header->adaptive ? header->adaptive_threshold : 0.0f;
+
+    ctx->denoise = header->denoise;
+    ctx->aovs    = header->aovs;
+}
+
+// Number of tiles in the order a job with the context's settings would be split into
+intern size_t RenderCtx_CountTiles(RenderCtx* ctx, size_t num_bands)
+{
+    TileQueue tiles;
+    if (!TileQueue_Init(&tiles)) {
+        ABORT("Failed to build render tile order");
+    }
+
+    RenderCtx_ResetTiles(ctx, &tiles, num_bands);
+    size_t num_tiles = tiles.order.length;
+
+    TileQueue_Uninit(&tiles);
+    return num_tiles;
+}
+
+// Continues the job saved in a checkpoint, the scene, camera and image must be set up the same as for the render that
+// wrote it, the checkpoint's seed, sampler, tile size, regions, adaptive and denoise settings, samples per pixel and
+// depth replace the context's, returns false (without starting anything) if the checkpoint can't be read or doesn't
+// match the image
+// The whole checkpoint is read before anything is replaced, so a failed resume leaves the context and the last
+// render's estimates as they were
+bool Render_Resume(RenderCtx* ctx, const char* checkpoint_path)
+{
+    RenderPool* pool = Render_Pool(ctx);
+
+    FILE* fd = fopen(checkpoint_path, "rb");
+    if (fd == NULL) {
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (fread(&header, sizeof(header), 1, fd) != 1
+        || memcmp(header.magic, RENDER_CHECKPOINT_MAGIC, sizeof(RENDER_CHECKPOINT_MAGIC)) != 0
+        || header.version != RENDER_CHECKPOINT_VERSION || header.accum_size != sizeof(PixelAccum)
+        || header.img_w != ctx->img->res.width || header.img_h != ctx->img->res.height || header.tile_w == 0
+        || header.tile_h == 0 || header.num_regions > RENDER_MAX_REGIONS || header.num_bands == 0
+        || header.num_bands > NUMA_MAX_NODES
+        || (header.sampler != SAMPLER_RANDOM && header.sampler != SAMPLER_STRATIFIED
+            && header.sampler != SAMPLER_SOBOL)
+        || header.num_active > header.num_tiles || header.pass_spp == 0
+        || header.pass_spp_done + header.pass_spp > header.samples_per_pixel) {
+        fclose(fd);
+        return false;
+    }
+
+    // the tile order has to be the one the checkpoint's active tiles index, whatever this pool's node count
+    RenderCtx resumed = *ctx;
+    RenderCtx_ApplyCheckpoint(&resumed, &header);
+
+    CheckpointData data;
+    if (RenderCtx_CountTiles(&resumed, header.num_bands) != header.num_tiles
+        || !CheckpointData_Read(&data, &header, fd)) {
+        fclose(fd);
+        return false;
+    }
+
+    fclose(fd);
+
+    RenderCtx_ApplyCheckpoint(ctx, &header);
+
+    Mutex_Lock(pool->lock);
+    RenderPool_PrepareJob(pool, ctx, header.samples_per_pixel, header.max_ray_depth, header.num_bands);
+    RenderPool_RestoreCheckpoint(pool, ctx, &header, &data);
+    RenderPool_LaunchJob(pool, ctx);
+    Mutex_Unlock(pool->lock);
+
+    CheckpointData_Free(&data);
+    return true;
+}
+
+intern RenderLocal* RenderLocal_New(void)
+{
+    RenderLocal* local = (RenderLocal*)calloc(1, sizeof(RenderLocal));
+    if (local == NULL) {
+        return NULL;
+    }
+
+    if (!TileQueue_Init(&local->tiles)) {
+        free(local);
+        return NULL;
+    }
+
+    return local;
+}
+
+intern void RenderLocal_Delete(RenderLocal* local)
+{
+    WavefrontBatch_Uninit(&local->batch);
+    TileBuffer_Uninit(&local->tile_buf);
+    TileQueue_Uninit(&local->tiles);
+    free(local->accum);
+    free(local);
+}
+
+// Renders the job on the calling thread instead of the pool, so there's no contention over the tile cursors and no
+// barrier between passes, which makes rendering lots of small images faster with a context per thread each rendering
+// whole images this way (the scene is only read, so the threads can share it)
+// Every sample is taken in one pass, adaptive sampling, the time budget and checkpoints are ignored, otherwise the
+// image is the same as Render_Start gives
+void Render_Now(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth)
+{
+    // a render on the pool would be writing to the same image
+    Render_Wait(ctx);
+
+    if (ctx->local == NULL) {
+        ctx->local = RenderLocal_New();
+        if (ctx->local == NULL) {
+            ABORT("Failed to allocate render buffers");
+        }
+    }
+
+    RenderLocal* local = ctx->local;
+    RenderJob    job   = RenderJob_Make(ctx, samples_per_pixel, max_ray_depth);
+
+    job.adaptive.enabled    = false;
+    job.time_budget.enabled = false;
+    job.checkpoint.path     = NULL;
+
+    RenderCtx_ResetTiles(ctx, &local->tiles, 1);
+    PixelAccum_Reset(&local->accum, &local->accum_len, ctx->img->res.width * ctx->img->res.height);
+    ctx->last_local = true;
+
+    if (job.mode == RENDER_MODE_WAVEFRONT) {
+        if (local->batch.wf == NULL && !WavefrontBatch_Init(&local->batch, RENDER_WAVEFRONT_BATCH_SIZE)) {
+            ABORT("Failed to allocate wavefront path buffers");
+        }
+
+        Wavefront_Set_RaySorting(local->batch.wf, job.sort_rays);
+    }
+
+    Object_Bind_Overrides(job.overrides, job.num_overrides);
+
+    u64 num_samples = 0;
+    for (size_t ii = 0; ii < local->tiles.order.length && RenderJob_Current(&job, ctx); ii++) {
+        Tile* tile = &local->tiles.order.at[ii];
+
+        RenderTile(&job, local->accum, tile, samples_per_pixel, &local->batch, &local->tile_buf);
+        num_samples += (u64)tile->w * tile->h * samples_per_pixel;
+
+        RenderJob_ReportTile(&job, tile, &local->tile_buf, 0);
+    }
+
+    Object_Bind_Overrides(NULL, 0);
+
+    bool cancelled = !RenderJob_Current(&job, ctx);
+    if (job.denoise && !cancelled) {
+        Render_Denoise(ctx->img, local->accum, 1);
+    }
+
+    ctx->stats = (RenderStats){.samples = num_samples, .passes = 1, .spp = samples_per_pixel};
+
+    if (job.callbacks.done != NULL) {
+        job.callbacks.done(ctx, cancelled, job.callbacks.user);
+    }
+}
+
+// Cancels the render in flight (if any) without waiting for it: workers stop claiming tiles and the job ends with the
+// pass, without denoising, the image keeps the tiles finished so far (Render_Wait returns once the in flight ones are)
+// Safe from any thread, including the render's own callbacks
+void Render_Cancel(RenderCtx* ctx)
+{
+    __atomic_add_fetch(&ctx->epoch, 1, __ATOMIC_RELEASE);
+}
+
+void Render_Wait(RenderCtx* ctx)
+{
+    RenderPool* pool = ctx->pool;
+    if (pool == NULL) {
+        return;
+    }
+
+    Mutex_Lock(pool->lock);
+    while (pool->num_busy != 0) {
+        Condition_Wait(pool->job_done, pool->lock);
+    }
+    Mutex_Unlock(pool->lock);
+}
+
+// Estimates of the last render, on the pool or by Render_Now, NULL if nothing has been rendered yet
+intern PixelAccum* Render_LastAccum(RenderCtx* ctx)
+{
+    if (ctx->last_local) {
+        return ctx->local->accum;
+    }
+
+    return ctx->pool ? ctx->pool->accum : NULL;
+}
+
+// Copies the radiance sum and sample count of every pixel from the last render (after Render_Wait), for merging with
+// renders of other sample ranges
+void Render_Read_Samples(RenderCtx* ctx, Color* sums, u32* counts)
+{
+    PixelAccum* accum      = Render_LastAccum(ctx);
+    size_t      num_pixels = ctx->img->res.width * ctx->img->res.height;
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        sums[ii]   = accum ? accum[ii].sum : COLOR_BLACK;
+        counts[ii] = accum ? accum[ii].samples : 0;
+    }
+}
+
+intern const char* Render_AOVNames[NUM_RENDER_AOVS] = {
+    [RENDER_AOV_R]        = "R",
+    [RENDER_AOV_G]        = "G",
+    [RENDER_AOV_B]        = "B",
+    [RENDER_AOV_ALBEDO_R] = "albedo.R",
+    [RENDER_AOV_ALBEDO_G] = "albedo.G",
+    [RENDER_AOV_ALBEDO_B] = "albedo.B",
+    [RENDER_AOV_NORMAL_X] = "N.X",
+    [RENDER_AOV_NORMAL_Y] = "N.Y",
+    [RENDER_AOV_NORMAL_Z] = "N.Z",
+    [RENDER_AOV_DEPTH]    = "Z",
+    [RENDER_AOV_MATERIAL] = "materialID",
+    [RENDER_AOV_SPP]      = "spp",
+};
+
+const char* Render_AOV_Name(RenderAOV aov)
+{
+    return Render_AOVNames[aov];
+}
+
+// Resolves the last render's estimates (after Render_Wait) into one float plane per AOV, width * height values each,
+// the guide AOVs are only meaningful if the render had AOVs (or denoising) enabled
+void Render_Read_AOVs(RenderCtx* ctx, f32* planes[NUM_RENDER_AOVS])
+{
+    PixelAccum* accum      = Render_LastAccum(ctx);
+    size_t      num_pixels = ctx->img->res.width * ctx->img->res.height;
+
+    for (size_t ii = 0; ii < num_pixels; ii++) {
+        PixelAccum  none = {};
+        PixelAccum* acc  = accum ? &accum[ii] : &none;
+
+        f32 inv_samples = acc->samples ? 1.0f / (f32)acc->samples : 0.0f;
+
+        planes[RENDER_AOV_R][ii]        = acc->sum.r * inv_samples;
+        planes[RENDER_AOV_G][ii]        = acc->sum.g * inv_samples;
+        planes[RENDER_AOV_B][ii]        = acc->sum.b * inv_samples;
+        planes[RENDER_AOV_ALBEDO_R][ii] = acc->albedo_sum.r * inv_samples;
+        planes[RENDER_AOV_ALBEDO_G][ii] = acc->albedo_sum.g * inv_samples;
+        planes[RENDER_AOV_ALBEDO_B][ii] = acc->albedo_sum.b * inv_samples;
+        planes[RENDER_AOV_NORMAL_X][ii] = acc->normal_sum.x * inv_samples;
+        planes[RENDER_AOV_NORMAL_Y][ii] = acc->normal_sum.y * inv_samples;
+        planes[RENDER_AOV_NORMAL_Z][ii] = acc->normal_sum.z * inv_samples;
+        planes[RENDER_AOV_DEPTH][ii]    = acc->depth_sum * inv_samples;
+        planes[RENDER_AOV_MATERIAL][ii] = (f32)acc->material;
+        planes[RENDER_AOV_SPP][ii]      = (f32)acc->samples;
+    }
+}
+
+// Takes up to max_rects of the rectangles workers have written to the image since the last poll, oldest first, returns
+// how many were written (a single rectangle covering the whole image if too many piled up since the last poll)
+// Only renders on the pool publish their tiles, and only one thread should poll
+size_t Render_Poll_Tiles(RenderCtx* ctx, RenderRect* rects, size_t max_rects)
+{
+    RenderPool* pool = ctx->pool;
+    if (pool == NULL || max_rects == 0) {
+        return 0;
+    }
+
+    // whatever is still queued is covered by the whole image, so it's dropped
+    if (__atomic_exchange_n(&pool->commits.overflowed, false, __ATOMIC_ACQUIRE)) {
+        RenderRect dropped;
+        while (CommitQueue_Pop(&pool->commits, &dropped)) {
+            continue;
+        }
+
+        rects[0] = (RenderRect){.x = 0, .y = 0, .w = ctx->img->res.width, .h = ctx->img->res.height};
+        return 1;
+    }
+
+    size_t num_rects = 0;
+    while (num_rects < max_rects && CommitQueue_Pop(&pool->commits, &rects[num_rects])) {
+        num_rects += 1;
+    }
+
+    return num_rects;
 }
 
 bool Render_Done(RenderCtx* ctx)
 {
-    return ctx->finished;
+    return __atomic_load_n(&ctx->finished, __ATOMIC_ACQUIRE);
 }
@@ -1,22 +1,163 @@
 #pragma once
 
 #include "gfx/image.h"
+#include "math/sampler.h"
 #include "platform/threads.h"
 #include "world/camera.h"
 #include "world/scene.h"
 
+typedef struct RenderPool  RenderPool;
+typedef struct RenderLocal RenderLocal;
+
+typedef enum {
+    RENDER_MODE_PATH,      // each thread traces one path at a time to completion
+    RENDER_MODE_WAVEFRONT, // each thread advances a batch of paths a bounce at a time (see rt/wavefront.h)
+} RenderMode;
+
+// Pixel rectangle, x/y is the top left corner
+typedef struct {
+    size_t x, y;
+    size_t w, h;
+} RenderRect;
+
+// Per pixel outputs of a render besides the image (see Render_Read_AOVs), the guide AOVs are averaged over the camera
+// rays' first hits, a pixel's material is its first sample's (1 + Scene_MaterialID, 0 for the sky)
+typedef enum {
+    RENDER_AOV_R, // mean radiance, before it's quantized (or denoised)
+    RENDER_AOV_G,
+    RENDER_AOV_B,
+    RENDER_AOV_ALBEDO_R,
+    RENDER_AOV_ALBEDO_G,
+    RENDER_AOV_ALBEDO_B,
+    RENDER_AOV_NORMAL_X,
+    RENDER_AOV_NORMAL_Y,
+    RENDER_AOV_NORMAL_Z,
+    RENDER_AOV_DEPTH,
+    RENDER_AOV_MATERIAL,
+    RENDER_AOV_SPP,
+    NUM_RENDER_AOVS,
+} RenderAOV;
+
+// A tile as it's written to the image (see Render_Set_Callbacks)
 typedef struct {
+    RenderRect   rect;
+    size_t       pass;     // pass the tile was sampled in, counted like RenderStats.passes (from 0)
+    u32          spp;      // samples per pixel the tile's pixels have so far
+    const Color* radiance; // mean radiance of the rect's pixels row by row, only valid during the callback
+} RenderTileResult;
+
+typedef struct RenderCtx RenderCtx;
+
+typedef void (*RenderTileCallback)(const RenderTileResult* tile, void* user);
+typedef void (*RenderDoneCallback)(RenderCtx* ctx, bool cancelled, void* user);
+
+typedef struct {
+    u64    samples; // camera samples taken so far by the current (or last) render
+    size_t passes;  // passes completed by the current (or last) render
+    size_t spp;     // samples per pixel completed by the pixels still sampled in the last pass
+} RenderStats;
+
+typedef struct RenderCtx {
     Camera*   cam;
     Scene*    scene;
     ImageRGB* img;
 
-    Thread* waiter_thread;
-    void*   waiter_args;
+    RenderPool*  pool;
+    RenderLocal* local;      // buffers for Render_Now, NULL until it's first used
+    bool         last_local; // the last render was a Render_Now one, so its estimates are in local
+    size_t       num_threads;
+    bool         numa; // spread the workers over NUMA nodes (see Render_Set_Numa)
+    RenderMode   mode;
+    SamplerType  sampler;
+    u64          seed;
+    bool         sort_rays;
+    bool         denoise; // filter the finished image (see Render_Set_Denoise)
+    bool         aovs;    // record the first hits for Render_Read_AOVs
+
+    struct {
+        size_t w, h;
+    } tile_size;
 
+    struct {
+        size_t min_spp;
+        size_t step_spp;
+        f32    threshold;
+    } adaptive;
+
+    struct {
+        i64    budget_ms;
+        size_t pass_spp;
+    } time_budget;
+
+    struct {
+        const char* path;
+        i64         interval_ms;
+    } checkpoint;
+
+    // the rectangles renders are restricted to, none for the whole image
+    struct {
+        RenderRect rects[RENDER_MAX_REGIONS];
+        size_t     num_rects;
+    } region;
+
+    struct {
+        MaterialOverride list[RENDER_MAX_OVERRIDES];
+        size_t           count;
+    } overrides;
+
+    // renders in whole image passes that double in spp, after a low resolution one (see Render_Set_Progressive)
+    struct {
+        bool   enabled;
+        size_t preview_scale;
+    } progressive;
+
+    struct {
+        u32 first; // index of the first sample the next render takes in each pixel
+        u32 total; // samples per pixel of the whole image the render is part of, 0 if it's the whole image
+    } sample_range;
+
+    // called from the render's threads (see Render_Set_Callbacks)
+    struct {
+        RenderTileCallback tile;
+        RenderDoneCallback done;
+        void*              user;
+    } callbacks;
+
+    RenderStats stats;
+
+    u64  epoch; // bumped by Render_Cancel, workers abandon jobs started in an earlier epoch
     bool finished;
 } RenderCtx;
 
 RenderCtx* Render_New(Scene* scene, ImageRGB* img, Camera* cam);
 void       Render_Delete(RenderCtx* ctx);
+void       Render_Set_TileSize(RenderCtx* ctx, size_t tile_w, size_t tile_h);
+void       Render_Set_Mode(RenderCtx* ctx, RenderMode mode);
+void       Render_Set_Sampler(RenderCtx* ctx, SamplerType sampler);
+void       Render_Set_Seed(RenderCtx* ctx, u64 seed);
+void       Render_Set_RaySorting(RenderCtx* ctx, bool sort_rays);
+void       Render_Set_Denoise(RenderCtx* ctx, bool enabled);
+void       Render_Set_AOVs(RenderCtx* ctx, bool enabled);
+void       Render_Set_Adaptive(RenderCtx* ctx, size_t min_spp, size_t step_spp, f32 threshold);
+void       Render_Set_TimeBudget(RenderCtx* ctx, i64 budget_ms, size_t pass_spp);
+void       Render_Set_Checkpoint(RenderCtx* ctx, const char* path, i64 interval_ms);
+void       Render_Set_Region(RenderCtx* ctx, const RenderRect* rects, size_t num_rects);
+void       Render_Set_MaterialOverrides(RenderCtx* ctx, const MaterialOverride* overrides, size_t num_overrides);
+void       Render_Set_SampleRange(RenderCtx* ctx, u32 first_sample, u32 total_samples);
+void       Render_Set_Progressive(RenderCtx* ctx, bool enabled, size_t preview_scale);
+void       Render_Set_Callbacks(RenderCtx* ctx, RenderTileCallback on_tile, RenderDoneCallback on_done, void* user);
+void       Render_Set_Threads(RenderCtx* ctx, size_t num_threads);
+void       Render_Set_Numa(RenderCtx* ctx, bool enabled);
+void       Render_Set_Job(RenderCtx* ctx, Scene* scene, ImageRGB* img, Camera* cam);
 void       Render_Start(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth);
+bool       Render_Resume(RenderCtx* ctx, const char* checkpoint_path);
+void       Render_Now(RenderCtx* ctx, size_t samples_per_pixel, size_t max_ray_depth);
+void       Render_Cancel(RenderCtx* ctx);
+void       Render_Wait(RenderCtx* ctx);
+void       Render_Read_Samples(RenderCtx* ctx, Color* sums, u32* counts);
+void       Render_Read_AOVs(RenderCtx* ctx, f32* planes[NUM_RENDER_AOVS]);
+size_t     Render_Poll_Tiles(RenderCtx* ctx, RenderRect* rects, size_t max_rects);
 bool       Render_Done(RenderCtx* ctx);
+
+// Channel name of the AOV in the OpenEXR convention (R/G/B, albedo.R, N.X, Z, ...)
+const char* Render_AOV_Name(RenderAOV aov);
@@ -0,0 +1,487 @@
+#include "wavefront.h"
+
+#include <stdlib.h>
+
+#include "math/curves.h"
+#include "math/math.h"
+#include "math/sampler.h"
+#include "rt/integrator.h"
+
+#define NUM_MATERIAL_TYPES (MATERIAL_DISNEY_BSDF + 1)
+
+// Bits of origin position per axis in a ray sort key (3 direction octant bits sit above the 3 * 9 morton bits)
+#define RAY_KEY_ORIGIN_BITS (9)
+#define RAY_KEY_BITS        (3 + 3 * RAY_KEY_ORIGIN_BITS)
+#define RAY_KEY_DIGIT_BITS  (10)
+
+// Every path in a batch is on the same bounce, so the only per-path state is what's needed to continue it
+struct Wavefront {
+    size_t batch_size;
+    bool   sort_rays;
+
+    // path state, indexed by path id (structure of arrays so each stage only touches what it uses)
+    Ray*        ray;
+    HitInfo*    hit;
+    Object**    obj;
+    Color*      throughput;
+    PathVertex* prev;
+    ShadowRay*  shadow;
+
+    // ids of the paths still alive, and the same ids bucketed by material type for shading
+    u32* active;
+    u32* sorted;
+
+    // ids of the paths with a shadow ray to trace this bounce
+    u32*   shadow_ids;
+    size_t num_shadows;
+
+    // sort key of each path's continuation ray (indexed by path id)
+    u32* ray_key;
+
+    WavefrontProfile* profile; // NULL unless a benchmark is measuring the stages
+
+    // state of the current trace
+    Scene*   scene;
+    Sampler* sampler; // indexed by path id, NULL if the trace draws from Random_Unilateral
+    size_t   depth;
+    bool     sample_direct;
+};
+
+Wavefront* Wavefront_New(size_t batch_size)
+{
+    Wavefront* wf = (Wavefront*)calloc(1, sizeof(Wavefront));
+    if (wf == NULL) {
+        goto error_Wavefront;
+    }
+
+    wf->batch_size = batch_size;
+    wf->sort_rays  = false;
+    wf->profile    = NULL;
+    wf->ray        = (Ray*)malloc(batch_size * sizeof(Ray));
+    wf->hit        = (HitInfo*)malloc(batch_size * sizeof(HitInfo));
+    wf->obj        = (Object**)malloc(batch_size * sizeof(Object*));
+    wf->throughput = (Color*)malloc(batch_size * sizeof(Color));
+    wf->prev       = (PathVertex*)malloc(batch_size * sizeof(PathVertex));
+    wf->shadow     = (ShadowRay*)malloc(batch_size * sizeof(ShadowRay));
+    wf->active     = (u32*)malloc(batch_size * sizeof(u32));
+    wf->sorted     = (u32*)malloc(batch_size * sizeof(u32));
+    wf->shadow_ids = (u32*)malloc(batch_size * sizeof(u32));
+    wf->ray_key    = (u32*)malloc(batch_size * sizeof(u32));
+
+    if (wf->ray == NULL || wf->hit == NULL || wf->obj == NULL || wf->throughput == NULL || wf->prev == NULL
+        || wf->shadow == NULL || wf->active == NULL || wf->sorted == NULL || wf->shadow_ids == NULL
+        || wf->ray_key == NULL) {
+        goto error_Buffers;
+    }
+
+    return wf;
+
+error_Buffers:
+    Wavefront_Delete(wf);
+error_Wavefront:
+    return NULL;
+}
+
+void Wavefront_Delete(Wavefront* wf)
+{
+    free(wf->ray_key);
+    free(wf->shadow_ids);
+    free(wf->sorted);
+    free(wf->active);
+    free(wf->shadow);
+    free(wf->prev);
+    free(wf->throughput);
+    free(wf->obj);
+    free(wf->hit);
+    free(wf->ray);
+    free(wf);
+}
+
+size_t Wavefront_BatchSize(Wavefront* wf)
+{
+    return wf->batch_size;
+}
+
+void Wavefront_Set_RaySorting(Wavefront* wf, bool sort_rays)
+{
+    wf->sort_rays = sort_rays;
+}
+
+void Wavefront_Set_Profile(Wavefront* wf, WavefrontProfile* profile)
+{
+    wf->profile = profile;
+}
+
+intern void WavefrontProfile_Start(WavefrontProfile* profile)
+{
+    if (profile->counter) {
+        PerfCounter_Start(profile->counter);
+    }
+    Stopwatch_Start(profile->clock);
+}
+
+intern void WavefrontProfile_Stop(WavefrontProfile* profile, WavefrontStageProfile* stage)
+{
+    Stopwatch_Stop(profile->clock);
+    if (profile->counter) {
+        PerfCounter_Stop(profile->counter);
+
+        PerfCounts counts = PerfCounter_Read(profile->counter);
+        stage->counts.cache_references += counts.cache_references;
+        stage->counts.cache_misses += counts.cache_misses;
+    }
+
+    stage->elapsed_us += Stopwatch_Elapsed(profile->clock, STOPWATCH_MICROSECONDS);
+}
+
+/* ---- Stages ---- */
+
+// Finds the closest hit of every live path, paths that miss pick up the sky and drop out of the active list
+// guides is only passed for the camera rays, NULL otherwise
+intern size_t Wavefront_Intersect(Wavefront* wf, Scene* scene, Color* radiance, PathGuide* guides, size_t num_active)
+{
+    size_t num_hit = 0;
+
+    for (size_t ii = 0; ii < num_active; ii++) {
+        u32 id = wf->active[ii];
+
+        if (Scene_ClosestHit(scene, &wf->ray[id], &wf->obj[id], &wf->hit[id])) {
+            wf->active[num_hit++] = id;
+
+            if (guides != NULL) {
+                guides[id] = Integrator_Guide(scene, &wf->ray[id], wf->obj[id], &wf->hit[id]);
+            }
+        } else {
+            vec3  dir    = wf->ray[id].dir;
+            Color sky    = vmul(Scene_Get_SkyColor(scene, dir), Integrator_SkyWeight(scene, &wf->prev[id], dir));
+            radiance[id] = Color_BrightenBy(radiance[id], Color_Tint(wf->throughput[id], sky));
+
+            if (guides != NULL) {
+                guides[id] = Integrator_Guide(scene, &wf->ray[id], NULL, NULL);
+            }
+        }
+    }
+
+    return num_hit;
+}
+
+// Counting sort of the active paths by the material type they hit, bucket_start[type] is where each type's run starts
+// in sorted (bucket_start[NUM_MATERIAL_TYPES] == num_active)
+intern void Wavefront_SortByMaterial(Wavefront* wf, size_t num_active, size_t bucket_start[NUM_MATERIAL_TYPES + 1])
+{
+    size_t bucket_count[NUM_MATERIAL_TYPES] = {0};
+
+    for (size_t ii = 0; ii < num_active; ii++) {
+        bucket_count[Object_Material(wf->obj[wf->active[ii]])->type] += 1;
+    }
+
+    bucket_start[0] = 0;
+    for (size_t type = 0; type < NUM_MATERIAL_TYPES; type++) {
+        bucket_start[type + 1] = bucket_start[type] + bucket_count[type];
+    }
+
+    size_t bucket_next[NUM_MATERIAL_TYPES];
+    for (size_t type = 0; type < NUM_MATERIAL_TYPES; type++) {
+        bucket_next[type] = bucket_start[type];
+    }
+
+    for (size_t ii = 0; ii < num_active; ii++) {
+        u32           id   = wf->active[ii];
+        Material_Type type = Object_Material(wf->obj[id])->type;
+
+        wf->sorted[bucket_next[type]++] = id;
+    }
+}
+
+// Adds the emitted light of the bounce to the path and, if it scattered, queues its continuation (and a shadow ray
+// toward a light for its direct lighting)
+intern inline size_t Wavefront_Continue(
+    Wavefront* wf,
+    Color*     radiance,
+    u32        id,
+    bool       bounced,
+    Color      surface_color,
+    Color      emitted_color,
+    Ray*       ray_out,
+    size_t     num_alive)
+{
+    f32 emission_weight = Integrator_EmissionWeight(wf->scene, &wf->prev[id], wf->obj[id], &wf->hit[id]);
+
+    radiance[id] = Color_BrightenBy(radiance[id], Color_Tint(wf->throughput[id], vmul(emitted_color, emission_weight)));
+
+    if (!bounced) {
+        return num_alive;
+    }
+
+    ShadowRay* shadow        = &wf->shadow[id];
+    bool       light_sampled = false;
+
+    if (wf->sample_direct) {
+        light_sampled = Integrator_SampleDirect(wf->scene, wf->obj[id], &wf->ray[id], &wf->hit[id], shadow);
+    }
+
+    if (light_sampled && shadow->dist > 0.0f) {
+        // the throughput is about to move on to the next vertex, so fold this vertex's into the shadow ray
+        shadow->contrib                   = Color_Tint(wf->throughput[id], shadow->contrib);
+        wf->shadow_ids[wf->num_shadows++] = id;
+    }
+
+    wf->prev[id]          = Integrator_ScatterVertex(wf->obj[id], &wf->ray[id], &wf->hit[id], ray_out, light_sampled);
+    wf->throughput[id]    = Color_Tint(wf->throughput[id], surface_color);
+    wf->ray[id]           = *ray_out;
+    wf->active[num_alive] = id;
+
+    return num_alive + 1;
+}
+
+// Binds the path's sampler for the current bounce, so its bounce function and light sample draw from it
+intern inline void Wavefront_BindSampler(Wavefront* wf, u32 id)
+{
+    if (wf->sampler != NULL) {
+        Sampler_Bind(&wf->sampler[id]);
+        Sampler_StartBounce((u32)wf->depth);
+    }
+}
+
+// Loops one material's bounce function over its bucket, the type dispatch happens once per bucket rather than per path
+#define WAVEFRONT_SHADE_BUCKET(bounce_func, member)                                                          \
+    for (size_t ii = begin; ii < end; ii++) {                                                                \
+        u32       id  = wf->sorted[ii];                                                                      \
+        Material* mat = Object_Material(wf->obj[id]);                                                        \
+        Ray       ray_out;                                                                                   \
+        Color     surface;                                                                                   \
+        Color     emitted;                                                                                   \
+                                                                                                             \
+        Wavefront_BindSampler(wf, id);                                                                       \
+        bool bounced = bounce_func(&mat->member, &wf->ray[id], &wf->hit[id], &surface, &emitted, &ray_out); \
+        num_alive    = Wavefront_Continue(wf, radiance, id, bounced, surface, emitted, &ray_out, num_alive); \
+    }
+
+intern size_t Wavefront_ShadeBucket(
+    Wavefront*    wf,
+    Color*        radiance,
+    Material_Type type,
+    size_t        begin,
+    size_t        end,
+    size_t        num_alive)
+{
+    switch (type) {
+        case MATERIAL_DIFFUSE: {
+            WAVEFRONT_SHADE_BUCKET(Material_Diffuse_Bounce, diffuse);
+        } break;
+
+        case MATERIAL_METAL: {
+            WAVEFRONT_SHADE_BUCKET(Material_Metal_Bounce, metal);
+        } break;
+
+        case MATERIAL_DIELECTRIC: {
+            WAVEFRONT_SHADE_BUCKET(Material_Dielectric_Bounce, dielectric);
+        } break;
+
+        case MATERIAL_DIFFUSE_LIGHT: {
+            WAVEFRONT_SHADE_BUCKET(Material_DiffuseLight_Bounce, diffuse_light);
+        } break;
+
+        case MATERIAL_SKYBOX: {
+            WAVEFRONT_SHADE_BUCKET(Material_Skybox_Bounce, skybox);
+        } break;
+
+        case MATERIAL_DISNEY_DIFFUSE: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_Diffuse_Bounce, disney);
+        } break;
+
+        case MATERIAL_DISNEY_METAL: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_Metal_Bounce, disney);
+        } break;
+
+        case MATERIAL_DISNEY_GLASS: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_Glass_Bounce, disney);
+        } break;
+
+        case MATERIAL_DISNEY_CLEARCOAT: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_Clearcoat_Bounce, disney);
+        } break;
+
+        case MATERIAL_DISNEY_SHEEN: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_Sheen_Bounce, disney);
+        } break;
+
+        case MATERIAL_DISNEY_BSDF: {
+            WAVEFRONT_SHADE_BUCKET(Material_Disney_BSDF_Bounce, disney);
+        } break;
+    }
+
+    return num_alive;
+}
+
+#undef WAVEFRONT_SHADE_BUCKET
+
+// Shades every sorted path a bucket at a time, rebuilding the active list from the paths that scattered
+intern size_t Wavefront_Shade(Wavefront* wf, Color* radiance, size_t bucket_start[NUM_MATERIAL_TYPES + 1])
+{
+    size_t num_alive = 0;
+
+    for (size_t type = 0; type < NUM_MATERIAL_TYPES; type++) {
+        if (bucket_start[type] == bucket_start[type + 1]) {
+            continue;
+        }
+
+        num_alive = Wavefront_ShadeBucket(
+            wf,
+            radiance,
+            (Material_Type)type,
+            bucket_start[type],
+            bucket_start[type + 1],
+            num_alive);
+    }
+
+    return num_alive;
+}
+
+// Key that groups rays by direction octant first and then by where they start (morton order within the scene bounds)
+intern inline u32 Wavefront_RayKey(Ray* ray, BoundingBox* bounds, vec3 inv_extent)
+{
+    u32 octant = (u32)(ray->dir.x < 0.0f) | ((u32)(ray->dir.y < 0.0f) << 1) | ((u32)(ray->dir.z < 0.0f) << 2);
+
+    // origins off unbounded geometry (e.g. a ground plane) can be outside the bounds, they get clamped to the edge
+    f32 max_cell = (f32)((1u << RAY_KEY_ORIGIN_BITS) - 1);
+    u32 cell[3];
+
+    for (size_t axis = 0; axis < 3; axis++) {
+        f32 tt     = (ray->origin.elem[axis] - bounds->min.elem[axis]) * inv_extent.elem[axis];
+        cell[axis] = (u32)(clampf(tt, 0.0f, 1.0f) * max_cell);
+    }
+
+    return (octant << (3 * RAY_KEY_ORIGIN_BITS)) | Morton_Encode3(cell[0], cell[1], cell[2]);
+}
+
+// Reorders the active paths by ray key (LSD radix sort) so the next intersect stage walks the kd-tree with rays that
+// start close together and head the same way, rather than rays scattered in every direction from the same tile
+intern void Wavefront_SortRays(Wavefront* wf, Scene* scene, size_t num_active)
+{
+    BoundingBox bounds = Scene_Get_Bounds(scene);
+
+    vec3 inv_extent;
+    for (size_t axis = 0; axis < 3; axis++) {
+        f32 extent            = bounds.max.elem[axis] - bounds.min.elem[axis];
+        inv_extent.elem[axis] = extent > 0.0f ? 1.0f / extent : 0.0f;
+    }
+
+    for (size_t ii = 0; ii < num_active; ii++) {
+        u32 id          = wf->active[ii];
+        wf->ray_key[id] = Wavefront_RayKey(&wf->ray[id], &bounds, inv_extent);
+    }
+
+    const u32 num_buckets = 1u << RAY_KEY_DIGIT_BITS;
+    const u32 digit_mask  = num_buckets - 1;
+
+    for (u32 shift = 0; shift < RAY_KEY_BITS; shift += RAY_KEY_DIGIT_BITS) {
+        size_t bucket_start[1u << RAY_KEY_DIGIT_BITS] = {0};
+
+        for (size_t ii = 0; ii < num_active; ii++) {
+            bucket_start[(wf->ray_key[wf->active[ii]] >> shift) & digit_mask] += 1;
+        }
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < num_buckets; bucket++) {
+            size_t count         = bucket_start[bucket];
+            bucket_start[bucket] = offset;
+            offset += count;
+        }
+
+        for (size_t ii = 0; ii < num_active; ii++) {
+            u32 id     = wf->active[ii];
+            u32 bucket = (wf->ray_key[id] >> shift) & digit_mask;
+
+            wf->sorted[bucket_start[bucket]++] = id;
+        }
+
+        // the sorted ids become the active list for the next digit
+        u32* tmp   = wf->active;
+        wf->active = wf->sorted;
+        wf->sorted = tmp;
+    }
+}
+
+// Traces the shadow rays queued by the shade stage, unoccluded ones add their light sample to the path
+intern void Wavefront_TraceShadows(Wavefront* wf, Color* radiance)
+{
+    for (size_t ii = 0; ii < wf->num_shadows; ii++) {
+        u32        id     = wf->shadow_ids[ii];
+        ShadowRay* shadow = &wf->shadow[id];
+
+        if (!Scene_Occluded(wf->scene, &shadow->ray, shadow->dist)) {
+            radiance[id] = Color_BrightenBy(radiance[id], shadow->contrib);
+        }
+    }
+
+    wf->num_shadows = 0;
+}
+
+void Wavefront_Trace(
+    Wavefront* wf,
+    Scene*     scene,
+    Sampler*   samplers,
+    Ray*       rays,
+    Color*     radiance,
+    PathGuide* guides,
+    size_t     num_rays,
+    size_t     max_depth)
+{
+    // generate
+    for (size_t ii = 0; ii < num_rays; ii++) {
+        wf->ray[ii]        = rays[ii];
+        wf->throughput[ii] = COLOR_WHITE;
+        wf->prev[ii]       = Integrator_CameraVertex(&rays[ii]);
+        wf->active[ii]     = (u32)ii;
+        radiance[ii]       = COLOR_BLACK;
+    }
+
+    wf->scene       = scene;
+    wf->sampler     = samplers;
+    wf->num_shadows = 0;
+
+    // a path still alive after max_depth bounces contributes nothing more, same as RayColor bottoming out
+    size_t num_active = num_rays;
+    for (size_t depth = 0; depth < max_depth && num_active > 0; depth++) {
+        // the camera rays are traced the same way whether sorting is on or not, so only later bounces are measured
+        bool profiled = wf->profile != NULL && depth > 0;
+
+        if (profiled) {
+            WavefrontProfile_Start(wf->profile);
+        }
+
+        num_active = Wavefront_Intersect(wf, scene, radiance, depth == 0 ? guides : NULL, num_active);
+
+        if (profiled) {
+            WavefrontProfile_Stop(wf->profile, &wf->profile->intersect);
+        }
+
+        size_t bucket_start[NUM_MATERIAL_TYPES + 1];
+        Wavefront_SortByMaterial(wf, num_active, bucket_start);
+
+        // direct light shares its credit with what the next bounce would find, so it needs a next bounce
+        wf->depth         = depth;
+        wf->sample_direct = depth + 1 < max_depth;
+        num_active        = Wavefront_Shade(wf, radiance, bucket_start);
+
+        Wavefront_TraceShadows(wf, radiance);
+
+        // every continuation is a secondary ray, camera rays from a tile are already coherent
+        if (wf->sort_rays && depth + 1 < max_depth) {
+            if (wf->profile) {
+                WavefrontProfile_Start(wf->profile);
+            }
+
+            Wavefront_SortRays(wf, scene, num_active);
+
+            if (wf->profile) {
+                WavefrontProfile_Stop(wf->profile, &wf->profile->sort);
+            }
+        }
+    }
+
+    if (samplers != NULL) {
+        Sampler_Bind(NULL);
+    }
+}
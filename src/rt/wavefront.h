@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gfx/color.h"
+#include "math/sampler.h"
+#include "platform/profiling.h"
+#include "rt/integrator.h"
+#include "rt/ray.h"
+#include "world/scene.h"
+
+// Stream (wavefront) path tracer, instead of following one path to completion it advances a whole batch of paths
+// a bounce at a time through separate stages:
+//   intersect -> sort by material type -> shade -> trace shadow rays -> compact
+// so each stage runs a tight loop over coherent work (one material's bounce function at a time, etc.)
+// A Wavefront is not thread safe, each render thread keeps its own
+typedef struct Wavefront Wavefront;
+
+Wavefront* Wavefront_New(size_t batch_size);
+void       Wavefront_Delete(Wavefront* wf);
+size_t     Wavefront_BatchSize(Wavefront* wf);
+
+// Reorders secondary rays by direction octant and origin morton code before each intersect stage
+void Wavefront_Set_RaySorting(Wavefront* wf, bool sort_rays);
+
+typedef struct {
+    i64        elapsed_us;
+    PerfCounts counts;
+} WavefrontStageProfile;
+
+// What the stages ray sorting affects cost, summed over every trace while it's set (for benchmarks)
+typedef struct {
+    PerfCounter*          counter; // NULL to only time the stages
+    Stopwatch*            clock;
+    WavefrontStageProfile intersect; // intersect stages of the secondary rays (the camera rays' aren't sorted)
+    WavefrontStageProfile sort;      // ray sorts, keys included
+} WavefrontProfile;
+
+// Measures the stages into profile until it's set back to NULL
+void Wavefront_Set_Profile(Wavefront* wf, WavefrontProfile* profile);
+
+// Traces rays[0..num_rays) to completion (num_rays <= batch size), writing the radiance of each path to radiance[ii]
+// Path ii draws from samplers[ii] (its camera dimensions already used), or from Random_Unilateral if samplers is NULL
+// If guides isn't NULL what each camera ray first sees is written to guides[ii] (max_depth must be at least 1)
+void Wavefront_Trace(
+    Wavefront* wf,
+    Scene*     scene,
+    Sampler*   samplers,
+    Ray*       rays,
+    Color*     radiance,
+    PathGuide* guides,
+    size_t     num_rays,
+    size_t     max_depth);
@@ -0,0 +1,209 @@
+#include "animation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    size_t frame;
+    point3 look_from;
+    point3 look_to;
+    f32    vfov;
+} CameraKey;
+
+typedef struct {
+    size_t frame;
+    point3 origin;
+    vec3   axis;
+    f32    degrees;
+    f32    scale;
+} TransformKey;
+
+#define Vector_Type CameraKey
+#include "ctl/containers/vector.h"
+
+#define Vector_Type TransformKey
+#include "ctl/containers/vector.h"
+
+typedef struct Animation {
+    size_t num_frames;
+
+    // sorted by frame
+    Vector(CameraKey) cameras;
+    Vector(TransformKey) transforms;
+} Animation;
+
+// Finds the keys around the frame and how far it is from the first to the second (both are the same key before the
+// first key and after the last one), keys are an array of either key type, which both start with their frame
+intern f32 Animation_Bracket(const void* keys, size_t key_size, size_t num_keys, size_t frame, size_t* lo, size_t* hi)
+{
+#define KEY_FRAME(index) (*(const size_t*)((const u8*)keys + (index) * key_size))
+
+    *lo = 0;
+    while (*lo + 1 < num_keys && KEY_FRAME(*lo + 1) <= frame) {
+        *lo += 1;
+    }
+
+    *hi = *lo + 1 < num_keys && KEY_FRAME(*lo) <= frame ? *lo + 1 : *lo;
+    if (*hi == *lo) {
+        return 0.0f;
+    }
+
+    return (f32)(frame - KEY_FRAME(*lo)) / (f32)(KEY_FRAME(*hi) - KEY_FRAME(*lo));
+
+#undef KEY_FRAME
+}
+
+Animation* Animation_Load(FILE* fd)
+{
+    char line[512];
+
+    Animation* anim = (Animation*)calloc(1, sizeof(Animation));
+    if (anim == NULL) {
+        goto error_Animation;
+    }
+
+    if (!Vector_Init(&anim->cameras, Vector_Default_Capacity)) {
+        goto error_Cameras;
+    }
+
+    if (!Vector_Init(&anim->transforms, Vector_Default_Capacity)) {
+        goto error_Transforms;
+    }
+
+    while (fgets(line, sizeof(line), fd) != NULL) {
+        unsigned long long frame = 0;
+        CameraKey          cam;
+        TransformKey       xform;
+
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        if (sscanf(line, "frames %llu", &frame) == 1) {
+            anim->num_frames = (size_t)frame;
+        } else if (
+            sscanf(
+                line,
+                "camera %llu %f %f %f %f %f %f %f",
+                &frame,
+                &cam.look_from.x,
+                &cam.look_from.y,
+                &cam.look_from.z,
+                &cam.look_to.x,
+                &cam.look_to.y,
+                &cam.look_to.z,
+                &cam.vfov)
+            == 8) {
+            cam.frame = (size_t)frame;
+
+            // insertion keeps the keys sorted by frame
+            size_t ii = anim->cameras.length;
+            if (!Vector_Push(&anim->cameras, cam)) {
+                goto error_Parse;
+            }
+
+            for (; ii > 0 && anim->cameras.at[ii - 1].frame > cam.frame; ii--) {
+                anim->cameras.at[ii] = anim->cameras.at[ii - 1];
+            }
+            anim->cameras.at[ii] = cam;
+        } else if (
+            sscanf(
+                line,
+                "transform %llu %f %f %f %f %f %f %f %f",
+                &frame,
+                &xform.origin.x,
+                &xform.origin.y,
+                &xform.origin.z,
+                &xform.axis.x,
+                &xform.axis.y,
+                &xform.axis.z,
+                &xform.degrees,
+                &xform.scale)
+            == 9) {
+            xform.frame = (size_t)frame;
+
+            size_t ii = anim->transforms.length;
+            if (!Vector_Push(&anim->transforms, xform)) {
+                goto error_Parse;
+            }
+
+            for (; ii > 0 && anim->transforms.at[ii - 1].frame > xform.frame; ii--) {
+                anim->transforms.at[ii] = anim->transforms.at[ii - 1];
+            }
+            anim->transforms.at[ii] = xform;
+        } else {
+            printf("Invalid animation key: %s", line);
+            goto error_Parse;
+        }
+    }
+
+    if (anim->num_frames == 0) {
+        printf("Animation has no frames\n");
+        goto error_Parse;
+    }
+
+    return anim;
+
+error_Parse:
+    Vector_Uninit(&anim->transforms);
+error_Transforms:
+    Vector_Uninit(&anim->cameras);
+error_Cameras:
+    free(anim);
+error_Animation:
+    return NULL;
+}
+
+void Animation_Delete(Animation* anim)
+{
+    Vector_Uninit(&anim->transforms);
+    Vector_Uninit(&anim->cameras);
+    free(anim);
+}
+
+size_t Animation_NumFrames(Animation* anim)
+{
+    return anim->num_frames;
+}
+
+AnimationFrame Animation_At(Animation* anim, size_t frame)
+{
+    AnimationFrame pose = {
+        .has_camera    = anim->cameras.length > 0,
+        .look_from     = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+        .look_to       = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+        .vfov          = 0.0f,
+        .origin        = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+        .rotation_axis = {.x = 0.0f, .y = 0.0f, .z = 1.0f},
+        .rotation      = 0.0f,
+        .scale         = 1.0f,
+    };
+
+    size_t lo, hi;
+    f32    tt;
+
+    if (anim->cameras.length > 0) {
+        tt = Animation_Bracket(anim->cameras.at, sizeof(CameraKey), anim->cameras.length, frame, &lo, &hi);
+
+        CameraKey* k0  = &anim->cameras.at[lo];
+        CameraKey* k1  = &anim->cameras.at[hi];
+        pose.look_from = vlerp(k0->look_from, k1->look_from, tt);
+        pose.look_to   = vlerp(k0->look_to, k1->look_to, tt);
+        pose.vfov      = vlerp(k0->vfov, k1->vfov, tt);
+    }
+
+    if (anim->transforms.length > 0) {
+        tt = Animation_Bracket(anim->transforms.at, sizeof(TransformKey), anim->transforms.length, frame, &lo, &hi);
+
+        // the angle is interpolated about the (interpolated) axis rather than slerping orientations, so a key pair
+        // can spin the mesh more than a half turn (a turntable is 0 to 360 about one axis)
+        TransformKey* k0   = &anim->transforms.at[lo];
+        TransformKey* k1   = &anim->transforms.at[hi];
+        pose.origin        = vlerp(k0->origin, k1->origin, tt);
+        pose.rotation_axis = vlerp(k0->axis, k1->axis, tt);
+        pose.rotation      = vlerp(k0->degrees, k1->degrees, tt);
+        pose.scale         = vlerp(k0->scale, k1->scale, tt);
+    }
+
+    return pose;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "math/vec.h"
+
+// Keyframed camera path and mesh transform, loaded from a text file with one key per line:
+//   frames N                                               number of frames to render
+//   camera F fromX fromY fromZ toX toY toZ vfov            camera position, look-at point and vertical fov at frame F
+//   transform F x y z axisX axisY axisZ degrees scale      mesh origin, rotation (about the axis) and scale at frame F
+// Lines starting with '#' are comments, keys can be in any order and are linearly interpolated between (and held
+// before the first and after the last), e.g. a turntable is two transform keys 0 and 360 degrees about Z
+typedef struct Animation Animation;
+
+typedef struct {
+    bool   has_camera; // false if the animation has no camera keys (the camera is up to the caller)
+    point3 look_from;
+    point3 look_to;
+    f32    vfov;
+
+    point3 origin;
+    vec3   rotation_axis;
+    f32    rotation; // degrees
+    f32    scale;
+} AnimationFrame;
+
+Animation*     Animation_Load(FILE* fd);
+void           Animation_Delete(Animation* anim);
+size_t         Animation_NumFrames(Animation* anim);
+AnimationFrame Animation_At(Animation* anim, size_t frame);
@@ -4,7 +4,7 @@
 #include <stdlib.h>
 
 #include "math/math.h"
-#include "math/random.h"
+#include "math/sampler.h"
 #include "math/vec.h"
 
 Camera* Camera_New(point3 lookFrom, point3 lookTo, vec3 vup, f32 aspectRatio, f32 vertFov, f32 aperature, f32 focusDist)
@@ -33,7 +33,7 @@ Camera* Camera_New(point3 lookFrom, point3 lookTo, vec3 vup, f32 aspectRatio, f3
 
 Ray Camera_GetRay(Camera* cam, f32 u, f32 v)
 {
-    vec2 rd     = Random_InDisc(cam->lensRadius);
+    vec2 rd     = Sampler_InDisc(cam->lensRadius);
     vec3 offset = (vec3){
         .x = u * rd.x,
         .y = v * rd.y,
@@ -0,0 +1,785 @@
+#include "lights.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "math/math.h"
+#include "math/sampler.h"
+
+/* ---  Light Tree Metaparameters --- */
+// The number of positions to evaluate the split cost at along each axis when building the light tree
+// Range: [2, INF)
+#define LIGHT_TREE_NUM_BUCKETS (12u)
+
+bool Light_Samplable(Object* obj)
+{
+    if (obj->material->type != MATERIAL_DIFFUSE_LIGHT) {
+        return false;
+    }
+
+    switch (obj->surface.type) {
+        case SURFACE_SPHERE:
+        case SURFACE_TRIANGLE: {
+            return true;
+        } break;
+
+        case SURFACE_PLANE: {
+            return false;
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+Color Light_Radiance(Object* obj, HitInfo* hit)
+{
+    Material_DiffuseLight* light = &obj->material->diffuse_light;
+    return Color_Brighten(Texture_ColorAt(light->albedo, hit->uv), light->brightness);
+}
+
+/* ---- Sphere ---- */
+
+// Cosine of the half angle of the cone the sphere subtends from a point, or -1 if the point is inside the sphere
+intern inline f32 Sphere_ConeCosMax(Sphere* sphere, point3 from)
+{
+    f32 dist_2   = vmag2(vsub(sphere->c, from));
+    f32 radius_2 = sphere->r * sphere->r;
+
+    if (dist_2 <= radius_2) {
+        return -1.0f;
+    }
+
+    return sqrtf(maxf(0.0f, 1.0f - radius_2 / dist_2));
+}
+
+// Samples the cone of directions the sphere subtends uniformly, which (unlike area sampling) never wastes samples on
+// the far side of the sphere
+intern bool Sphere_Sample(Object* obj, point3 from, LightSample* sample)
+{
+    Sphere* sphere  = &obj->surface.sphere;
+    f32     cos_max = Sphere_ConeCosMax(sphere, from);
+
+    if (cos_max < 0.0f) {
+        return false;
+    }
+
+    point2 u  = Sampler_2D();
+    f32    u0 = u.u;
+    f32    u1 = u.v;
+
+    f32 cos_theta = 1.0f - u0 * (1.0f - cos_max);
+    f32 sin_theta = sqrtf(maxf(0.0f, 1.0f - cos_theta * cos_theta));
+    f32 phi       = 2.0f * PI32 * u1;
+
+    vec3   dir_cone_space = {cosf(phi) * sin_theta, sinf(phi) * sin_theta, cos_theta};
+    basis3 cone_to_world  = vec3_OrthonormalBasis(vnorm(vsub(sphere->c, from)));
+    vec3   dir            = vnorm(vec3_Reorient(dir_cone_space, cone_to_world));
+
+    Ray     ray = Ray_Make(from, dir);
+    HitInfo hit;
+    if (!Surface_HitAt(&obj->surface, &ray, RT_EPSILON, INF, &hit)) {
+        // grazing the silhouette
+        return false;
+    }
+
+    sample->dir      = dir;
+    sample->dist     = hit.tIntersect;
+    sample->pdf      = 1.0f / (2.0f * PI32 * (1.0f - cos_max));
+    sample->radiance = Light_Radiance(obj, &hit);
+
+    return true;
+}
+
+intern f32 Sphere_PDF(Object* obj, point3 from)
+{
+    f32 cos_max = Sphere_ConeCosMax(&obj->surface.sphere, from);
+    if (cos_max < 0.0f) {
+        return 0.0f;
+    }
+
+    return 1.0f / (2.0f * PI32 * (1.0f - cos_max));
+}
+
+/* ---- Triangle ---- */
+
+intern inline vec3 Triangle_AreaNormal(Triangle* tri)
+{
+    return vcross(vsub(tri->vtx[1].pos, tri->vtx[0].pos), vsub(tri->vtx[2].pos, tri->vtx[0].pos));
+}
+
+// Converts the uniform area density of a point on the triangle to a solid angle density from a point dist away
+intern inline f32 Triangle_SolidAnglePDF(Triangle* tri, vec3 dir, f32 dist)
+{
+    vec3 area_normal = Triangle_AreaNormal(tri);
+    f32  area        = 0.5f * vmag(area_normal);
+
+    if (area <= 0.0f) {
+        return 0.0f;
+    }
+
+    // lights emit from both faces
+    f32 cos_light = fabsf(vdot(area_normal, dir)) / (2.0f * area);
+    if (cos_light <= EPSILON) {
+        return 0.0f;
+    }
+
+    return (dist * dist) / (cos_light * area);
+}
+
+intern bool Triangle_Sample(Object* obj, point3 from, LightSample* sample)
+{
+    Triangle* tri = &obj->surface.triangle;
+
+    // uniform barycentrics, see: https://pharr.org/matt/blog/2019/02/27/triangle-sampling-1
+    point2 u  = Sampler_2D();
+    f32    su = sqrtf(u.u);
+    f32    b0 = 1.0f - su;
+    f32    b1 = u.v * su;
+    f32    b2 = 1.0f - b0 - b1;
+
+    point3 target = vsum(vmul(tri->vtx[0].pos, b0), vmul(tri->vtx[1].pos, b1), vmul(tri->vtx[2].pos, b2));
+    vec3   dir    = vnorm(vsub(target, from));
+
+    Ray     ray = Ray_Make(from, dir);
+    HitInfo hit;
+    if (!Surface_HitAt(&obj->surface, &ray, RT_EPSILON, INF, &hit)) {
+        // edge on, or the target landed on the edge and precision pushed the ray off
+        return false;
+    }
+
+    f32 pdf = Triangle_SolidAnglePDF(tri, dir, hit.tIntersect);
+    if (pdf <= 0.0f) {
+        return false;
+    }
+
+    sample->dir      = dir;
+    sample->dist     = hit.tIntersect;
+    sample->pdf      = pdf;
+    sample->radiance = Light_Radiance(obj, &hit);
+
+    return true;
+}
+
+/* ---- Light ---- */
+
+bool Light_Sample(Object* obj, point3 from, LightSample* sample)
+{
+    switch (obj->surface.type) {
+        case SURFACE_SPHERE: {
+            return Sphere_Sample(obj, from, sample);
+        } break;
+
+        case SURFACE_TRIANGLE: {
+            return Triangle_Sample(obj, from, sample);
+        } break;
+
+        case SURFACE_PLANE: {
+            return false;
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+f32 Light_PDF(Object* obj, point3 from, HitInfo* hit)
+{
+    switch (obj->surface.type) {
+        case SURFACE_SPHERE: {
+            return Sphere_PDF(obj, from);
+        } break;
+
+        case SURFACE_TRIANGLE: {
+            vec3 dir = vnorm(vsub(hit->position, from));
+            return Triangle_SolidAnglePDF(&obj->surface.triangle, dir, hit->tIntersect);
+        } break;
+
+        case SURFACE_PLANE: {
+            return 0.0f;
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+intern f32 Light_Power(Object* obj)
+{
+    Material_DiffuseLight* light = &obj->material->diffuse_light;
+
+    switch (obj->surface.type) {
+        case SURFACE_SPHERE: {
+            Sphere* sphere   = &obj->surface.sphere;
+            Color   radiance = Color_Brighten(Texture_ColorAt(light->albedo, (point2){0.5f, 0.5f}), light->brightness);
+
+            return PI32 * 4.0f * PI32 * sphere->r * sphere->r * Color_Luminance(radiance);
+        } break;
+
+        case SURFACE_TRIANGLE: {
+            Triangle* tri      = &obj->surface.triangle;
+            point2    uv       = vmul(vsum(tri->vtx[0].tex, tri->vtx[1].tex, tri->vtx[2].tex), 1.0f / 3.0f);
+            Color     radiance = Color_Brighten(Texture_ColorAt(light->albedo, uv), light->brightness);
+            f32       area     = 0.5f * vmag(Triangle_AreaNormal(tri));
+
+            // emits from both faces
+            return PI32 * 2.0f * area * Color_Luminance(radiance);
+        } break;
+
+        case SURFACE_PLANE: {
+            return 0.0f;
+        } break;
+    }
+
+    OPTIMIZE_UNREACHABLE;
+}
+
+/* ---- Light Sampler ---- */
+
+// Conservative bounds of a group of lights, see: https://pbr-book.org/4ed/Light_Sources/Light_Samplers
+// Lights emit from both faces, so the normals are bound by a cone around +axis or -axis, and the emitted directions
+// are always within 90 degrees of a normal (diffuse emission)
+typedef struct {
+    BoundingBox box;
+    vec3        axis;
+    f32         cos_theta_o; // cosine of the half angle of the normal cone, -1 if the normals go in every direction
+    f32         power;
+} LightBounds;
+
+typedef struct {
+    LightBounds bounds;
+    u32         parent;
+    u32         index; // internal nodes: second child (the first child is the next node), leaves: light index
+    bool        leaf;
+} LightNode;
+
+typedef struct {
+    f32 prob; // probability of keeping the entry rather than taking its alias
+    u32 alias;
+    f32 pmf; // probability of picking the light overall
+} LightAlias;
+
+typedef struct {
+    LightBounds bounds;
+    point3      centroid;
+    u32         light;
+} LightPrim;
+
+#define Vector_Type LightNode
+#include "ctl/containers/vector.h"
+
+struct LightSampler {
+    u32*              lights; // object index of each light
+    size_t            num_lights;
+    Vector(LightNode)* nodes;
+    u32*              leaf_of_object; // leaf node of each object, UINT32_MAX for objects that aren't lights
+    size_t            num_objects;
+    LightAlias*       alias;
+};
+
+intern LightBounds LightBounds_Make(Object* obj)
+{
+    LightBounds bounds = {
+        .box         = Surface_BoundingBox(&obj->surface),
+        .axis        = vec(0.0f, 0.0f, 1.0f),
+        .cos_theta_o = -1.0f,
+        .power       = Light_Power(obj),
+    };
+
+    if (obj->surface.type == SURFACE_TRIANGLE) {
+        vec3 area_normal = Triangle_AreaNormal(&obj->surface.triangle);
+
+        if (!vequ(area_normal, 0.0f)) {
+            bounds.axis        = vnorm(area_normal);
+            bounds.cos_theta_o = 1.0f;
+        }
+    }
+
+    return bounds;
+}
+
+intern inline BoundingBox BoundingBox_Union(BoundingBox a, BoundingBox b)
+{
+    return (BoundingBox){
+        .min = vec(minf(a.min.x, b.min.x), minf(a.min.y, b.min.y), minf(a.min.z, b.min.z)),
+        .max = vec(maxf(a.max.x, b.max.x), maxf(a.max.y, b.max.y), maxf(a.max.z, b.max.z)),
+    };
+}
+
+intern inline f32 BoundingBox_SurfaceArea(BoundingBox box)
+{
+    vec3 extent = vsub(box.max, box.min);
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+// Smallest cone containing both cones (treating each axis and its opposite as the same cone)
+intern LightBounds LightBounds_Union(LightBounds a, LightBounds b)
+{
+    LightBounds result = {
+        .box         = BoundingBox_Union(a.box, b.box),
+        .axis        = a.axis,
+        .cos_theta_o = a.cos_theta_o,
+        .power       = a.power + b.power,
+    };
+
+    if (vdot(a.axis, b.axis) < 0.0f) {
+        b.axis = vmul(b.axis, -1.0f);
+    }
+
+    f32 theta_a = acosf(clampf(a.cos_theta_o, -1.0f, 1.0f));
+    f32 theta_b = acosf(clampf(b.cos_theta_o, -1.0f, 1.0f));
+    f32 theta_d = acosf(clampf(vdot(a.axis, b.axis), -1.0f, 1.0f));
+
+    if (minf(theta_d + theta_b, PI32) <= theta_a) {
+        return result;
+    }
+
+    if (minf(theta_d + theta_a, PI32) <= theta_b) {
+        result.axis        = b.axis;
+        result.cos_theta_o = b.cos_theta_o;
+        return result;
+    }
+
+    f32  theta_o  = 0.5f * (theta_a + theta_d + theta_b);
+    vec3 rotation = vcross(a.axis, b.axis);
+
+    if (theta_o >= PI32 || vequ(rotation, 0.0f)) {
+        result.cos_theta_o = -1.0f;
+        return result;
+    }
+
+    // rotate a's axis toward b's so the cone just covers both
+    f32  theta_r = theta_o - theta_a;
+    vec3 toward  = vcross(vnorm(rotation), a.axis);
+
+    result.axis        = vnorm(vadd(vmul(a.axis, cosf(theta_r)), vmul(toward, sinf(theta_r))));
+    result.cos_theta_o = cosf(theta_o);
+    return result;
+}
+
+// Upper bound (up to a constant) on the light the group can send to a point
+intern f32 LightBounds_Importance(LightBounds* bounds, point3 from)
+{
+    if (bounds->power <= 0.0f) {
+        return 0.0f;
+    }
+
+    point3 center   = vmul(vadd(bounds->box.min, bounds->box.max), 0.5f);
+    f32    radius_2 = 0.25f * vmag2(vsub(bounds->box.max, bounds->box.min));
+    vec3   to_point = vsub(from, center);
+    f32    dist_2   = vmag2(to_point);
+
+    // angle the bounds subtend from the point, nothing can be ruled out from inside them
+    f32 theta_b = dist_2 <= radius_2 ? PI32 : asinf(sqrtf(radius_2 / dist_2));
+
+    // smallest angle between a normal in the cone and the direction to the point
+    f32 cos_w   = dist_2 > 0.0f ? fabsf(vdot(bounds->axis, to_point)) / sqrtf(dist_2) : 1.0f;
+    f32 theta_w = acosf(clampf(cos_w, -1.0f, 1.0f));
+    f32 theta_o = acosf(clampf(bounds->cos_theta_o, -1.0f, 1.0f));
+    f32 theta   = maxf(0.0f, theta_w - theta_o - theta_b);
+
+    if (theta >= 0.5f * PI32) {
+        return 0.0f;
+    }
+
+    // keep points close to (or inside) the bounds from blowing up the estimate
+    return bounds->power * cosf(theta) / maxf(dist_2, radius_2);
+}
+
+// Solid angle measure of the directions the group can emit in (the normal cone widened by 90 degrees)
+intern f32 LightBounds_OrientationMeasure(LightBounds* bounds)
+{
+    f32 theta_o = acosf(clampf(bounds->cos_theta_o, -1.0f, 1.0f));
+    f32 theta_w = minf(theta_o + 0.5f * PI32, PI32);
+    f32 sin_o   = sinf(theta_o);
+
+    return 2.0f * PI32 * (1.0f - bounds->cos_theta_o)
+           + 0.5f * PI32 * (2.0f * theta_w * sin_o - cosf(theta_o - 2.0f * theta_w) - 2.0f * theta_o * sin_o
+                             + bounds->cos_theta_o);
+}
+
+// Surface area orientation heuristic, the light analog of the SAH
+intern inline f32 LightBounds_Cost(LightBounds* bounds)
+{
+    return bounds->power * LightBounds_OrientationMeasure(bounds) * BoundingBox_SurfaceArea(bounds->box);
+}
+
+// Partitions prims[begin, end) around the cheapest bucketed split, returning the split point
+intern size_t LightTree_Split(LightPrim* prims, size_t begin, size_t end)
+{
+    point3 centroid_min = prims[begin].centroid;
+    point3 centroid_max = prims[begin].centroid;
+
+    for (size_t ii = begin + 1; ii < end; ii++) {
+        point3 c     = prims[ii].centroid;
+        centroid_min = vec(minf(centroid_min.x, c.x), minf(centroid_min.y, c.y), minf(centroid_min.z, c.z));
+        centroid_max = vec(maxf(centroid_max.x, c.x), maxf(centroid_max.y, c.y), maxf(centroid_max.z, c.z));
+    }
+
+    vec3 extent     = vsub(centroid_max, centroid_min);
+    f32  max_extent = maxf(extent.x, maxf(extent.y, extent.z));
+
+    f32  best_cost   = INF;
+    Axis best_axis   = AXIS_X;
+    u32  best_bucket = 0;
+
+    for (size_t axis = AXIS_X; axis <= AXIS_Z; axis++) {
+        if (extent.elem[axis] <= 0.0f) {
+            continue;
+        }
+
+        LightBounds buckets[LIGHT_TREE_NUM_BUCKETS];
+        bool        used[LIGHT_TREE_NUM_BUCKETS] = {false};
+
+        for (size_t ii = begin; ii < end; ii++) {
+            f32 offset = (prims[ii].centroid.elem[axis] - centroid_min.elem[axis]) / extent.elem[axis];
+            u32 bucket = MIN((u32)(offset * LIGHT_TREE_NUM_BUCKETS), LIGHT_TREE_NUM_BUCKETS - 1);
+
+            buckets[bucket] = used[bucket] ? LightBounds_Union(buckets[bucket], prims[ii].bounds) : prims[ii].bounds;
+            used[bucket]    = true;
+        }
+
+        // thin axes make for long and skinny children, which the surface area alone doesn't penalize enough
+        f32 axis_penalty = max_extent / extent.elem[axis];
+
+        for (u32 split = 1; split < LIGHT_TREE_NUM_BUCKETS; split++) {
+            LightBounds below, above;
+            bool        any_below = false, any_above = false;
+
+            for (u32 bucket = 0; bucket < LIGHT_TREE_NUM_BUCKETS; bucket++) {
+                if (!used[bucket]) {
+                    continue;
+                }
+
+                if (bucket < split) {
+                    below     = any_below ? LightBounds_Union(below, buckets[bucket]) : buckets[bucket];
+                    any_below = true;
+                } else {
+                    above     = any_above ? LightBounds_Union(above, buckets[bucket]) : buckets[bucket];
+                    any_above = true;
+                }
+            }
+
+            if (!any_below || !any_above) {
+                continue;
+            }
+
+            f32 cost = axis_penalty * (LightBounds_Cost(&below) + LightBounds_Cost(&above));
+            if (cost < best_cost) {
+                best_cost   = cost;
+                best_axis   = (Axis)axis;
+                best_bucket = split;
+            }
+        }
+    }
+
+    if (best_cost == INF) {
+        // every centroid is in the same spot, any split is as good as another
+        return begin + (end - begin) / 2;
+    }
+
+    size_t mid = begin;
+    for (size_t ii = begin; ii < end; ii++) {
+        f32 offset = (prims[ii].centroid.elem[best_axis] - centroid_min.elem[best_axis]) / extent.elem[best_axis];
+        u32 bucket = MIN((u32)(offset * LIGHT_TREE_NUM_BUCKETS), LIGHT_TREE_NUM_BUCKETS - 1);
+
+        if (bucket < best_bucket) {
+            LightPrim tmp = prims[mid];
+            prims[mid++]  = prims[ii];
+            prims[ii]     = tmp;
+        }
+    }
+
+    return mid;
+}
+
+intern u32 LightTree_Build(LightSampler* sampler, LightPrim* prims, size_t begin, size_t end, u32 parent)
+{
+    u32 node_index = (u32)sampler->nodes->length;
+
+    LightBounds bounds = prims[begin].bounds;
+    for (size_t ii = begin + 1; ii < end; ii++) {
+        bounds = LightBounds_Union(bounds, prims[ii].bounds);
+    }
+
+    LightNode node = {
+        .bounds = bounds,
+        .parent = parent,
+        .index  = prims[begin].light,
+        .leaf   = true,
+    };
+    Vector_Push(sampler->nodes, node);
+
+    if (end - begin == 1) {
+        return node_index;
+    }
+
+    size_t mid = LightTree_Split(prims, begin, end);
+
+    LightTree_Build(sampler, prims, begin, mid, node_index);
+    u32 second_child = LightTree_Build(sampler, prims, mid, end, node_index);
+
+    sampler->nodes->at[node_index].index = second_child;
+    sampler->nodes->at[node_index].leaf  = false;
+
+    return node_index;
+}
+
+// Vose's alias method, see: https://www.keithschwarz.com/darts-dice-coins/
+intern bool LightAlias_Build(LightSampler* sampler)
+{
+    size_t num_lights = sampler->num_lights;
+    f32    total      = 0.0f;
+
+    for (size_t ii = 0; ii < num_lights; ii++) {
+        total += sampler->nodes->at[sampler->leaf_of_object[sampler->lights[ii]]].bounds.power;
+    }
+
+    f32* scaled = (f32*)malloc(num_lights * sizeof(f32));
+    u32* small  = (u32*)malloc(num_lights * sizeof(u32));
+    u32* large  = (u32*)malloc(num_lights * sizeof(u32));
+    if (scaled == NULL || small == NULL || large == NULL) {
+        free(scaled);
+        free(small);
+        free(large);
+        return false;
+    }
+
+    size_t num_small = 0, num_large = 0;
+    for (size_t ii = 0; ii < num_lights; ii++) {
+        f32 power = sampler->nodes->at[sampler->leaf_of_object[sampler->lights[ii]]].bounds.power;
+
+        // all black lights get picked uniformly
+        sampler->alias[ii].pmf = total > 0.0f ? power / total : 1.0f / (f32)num_lights;
+        scaled[ii]             = sampler->alias[ii].pmf * (f32)num_lights;
+
+        if (scaled[ii] < 1.0f) {
+            small[num_small++] = (u32)ii;
+        } else {
+            large[num_large++] = (u32)ii;
+        }
+    }
+
+    while (num_small > 0 && num_large > 0) {
+        u32 less = small[--num_small];
+        u32 more = large[--num_large];
+
+        sampler->alias[less].prob  = scaled[less];
+        sampler->alias[less].alias = more;
+
+        scaled[more] = (scaled[more] + scaled[less]) - 1.0f;
+        if (scaled[more] < 1.0f) {
+            small[num_small++] = more;
+        } else {
+            large[num_large++] = more;
+        }
+    }
+
+    // whatever is left is 1 up to rounding
+    while (num_large > 0) {
+        u32 more                   = large[--num_large];
+        sampler->alias[more].prob  = 1.0f;
+        sampler->alias[more].alias = more;
+    }
+
+    while (num_small > 0) {
+        u32 less                   = small[--num_small];
+        sampler->alias[less].prob  = 1.0f;
+        sampler->alias[less].alias = less;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return true;
+}
+
+LightSampler* LightSampler_New(Object* objects, u32* lights, size_t num_lights, size_t num_objects)
+{
+    if (num_lights == 0) {
+        return NULL;
+    }
+
+    LightPrim* prims = NULL;
+
+    LightSampler* sampler = (LightSampler*)calloc(1, sizeof(LightSampler));
+    if (sampler == NULL) {
+        goto error_Sampler;
+    }
+
+    sampler->num_lights  = num_lights;
+    sampler->num_objects = num_objects;
+
+    sampler->lights = (u32*)malloc(num_lights * sizeof(u32));
+    if (sampler->lights == NULL) {
+        goto error_Lights;
+    }
+
+    sampler->leaf_of_object = (u32*)malloc(num_objects * sizeof(u32));
+    if (sampler->leaf_of_object == NULL) {
+        goto error_LeafOfObject;
+    }
+
+    sampler->alias = (LightAlias*)malloc(num_lights * sizeof(LightAlias));
+    if (sampler->alias == NULL) {
+        goto error_Alias;
+    }
+
+    sampler->nodes = Vector_New(LightNode)(2 * num_lights - 1);
+    if (sampler->nodes == NULL) {
+        goto error_Nodes;
+    }
+
+    prims = (LightPrim*)malloc(num_lights * sizeof(LightPrim));
+    if (prims == NULL) {
+        goto error_Prims;
+    }
+
+    for (size_t ii = 0; ii < num_lights; ii++) {
+        LightBounds bounds = LightBounds_Make(&objects[lights[ii]]);
+
+        sampler->lights[ii] = lights[ii];
+        prims[ii]           = (LightPrim){
+            .bounds   = bounds,
+            .centroid = vmul(vadd(bounds.box.min, bounds.box.max), 0.5f),
+            .light    = (u32)ii,
+        };
+    }
+
+    LightTree_Build(sampler, prims, 0, num_lights, UINT32_MAX);
+    free(prims);
+
+    for (size_t ii = 0; ii < num_objects; ii++) {
+        sampler->leaf_of_object[ii] = UINT32_MAX;
+    }
+
+    for (size_t ii = 0; ii < sampler->nodes->length; ii++) {
+        LightNode* node = &sampler->nodes->at[ii];
+        if (node->leaf) {
+            sampler->leaf_of_object[sampler->lights[node->index]] = (u32)ii;
+        }
+    }
+
+    if (!LightAlias_Build(sampler)) {
+        goto error_AliasBuild;
+    }
+
+    return sampler;
+
+error_AliasBuild:
+error_Prims:
+    Vector_Delete(sampler->nodes);
+error_Nodes:
+    free(sampler->alias);
+error_Alias:
+    free(sampler->leaf_of_object);
+error_LeafOfObject:
+    free(sampler->lights);
+error_Lights:
+    free(sampler);
+error_Sampler:
+    return NULL;
+}
+
+void LightSampler_Delete(LightSampler* sampler)
+{
+    Vector_Delete(sampler->nodes);
+    free(sampler->alias);
+    free(sampler->leaf_of_object);
+    free(sampler->lights);
+    free(sampler);
+}
+
+// Uses the integer part of u * num_lights to pick the entry and the fractional part to pick between it and its alias
+intern u32 LightSampler_SampleAlias(LightSampler* sampler, f32 u, f32* pmf)
+{
+    size_t      num_lights = sampler->num_lights;
+    f32         scaled     = u * num_lights;
+    u32         index      = (u32)MIN((size_t)scaled, num_lights - 1);
+    LightAlias* entry      = &sampler->alias[index];
+
+    if (minf(scaled - index, 1.0f - EPSILON) >= entry->prob) {
+        index = entry->alias;
+    }
+
+    *pmf = sampler->alias[index].pmf;
+    return sampler->lights[index];
+}
+
+bool LightSampler_Sample(LightSampler* sampler, point3 from, u32* object, f32* pmf)
+{
+    LightNode* nodes = sampler->nodes->at;
+    f32        u     = Sampler_1D();
+
+    if (LightBounds_Importance(&nodes[0].bounds, from) <= 0.0f) {
+        *object = LightSampler_SampleAlias(sampler, u, pmf);
+        return true;
+    }
+
+    LightNode* node = &nodes[0];
+    f32        prob = 1.0f;
+
+    while (!node->leaf) {
+        LightNode* first  = node + 1;
+        LightNode* second = &nodes[node->index];
+
+        f32 importance_first  = LightBounds_Importance(&first->bounds, from);
+        f32 importance_second = LightBounds_Importance(&second->bounds, from);
+        f32 importance_total  = importance_first + importance_second;
+
+        if (importance_total <= 0.0f) {
+            return false;
+        }
+
+        // a single draw picks the whole path down the tree, rescaled to [0, 1) at each level
+        f32 prob_first = importance_first / importance_total;
+        if (u < prob_first) {
+            node = first;
+            prob *= prob_first;
+            u = minf(u / prob_first, 1.0f - EPSILON);
+        } else {
+            node = second;
+            prob *= 1.0f - prob_first;
+            u = minf((u - prob_first) / (1.0f - prob_first), 1.0f - EPSILON);
+        }
+    }
+
+    *object = sampler->lights[node->index];
+    *pmf    = prob;
+    return true;
+}
+
+f32 LightSampler_PMF(LightSampler* sampler, point3 from, u32 object)
+{
+    if (object >= sampler->num_objects || sampler->leaf_of_object[object] == UINT32_MAX) {
+        return 0.0f;
+    }
+
+    LightNode* nodes      = sampler->nodes->at;
+    u32        node_index = sampler->leaf_of_object[object];
+
+    if (LightBounds_Importance(&nodes[0].bounds, from) <= 0.0f) {
+        return sampler->alias[nodes[node_index].index].pmf;
+    }
+
+    // walk back up to the root, picking up the odds of each step down
+    f32 prob = 1.0f;
+    while (node_index != 0) {
+        u32 parent  = nodes[node_index].parent;
+        u32 sibling = node_index == parent + 1 ? nodes[parent].index : parent + 1;
+
+        f32 importance         = LightBounds_Importance(&nodes[node_index].bounds, from);
+        f32 importance_sibling = LightBounds_Importance(&nodes[sibling].bounds, from);
+
+        if (importance <= 0.0f) {
+            return 0.0f;
+        }
+
+        prob *= importance / (importance + importance_sibling);
+        node_index = parent;
+    }
+
+    return prob;
+}
+
+f32 LightSampler_Power(LightSampler* sampler)
+{
+    return sampler->nodes->at[0].bounds.power;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gfx/color.h"
+#include "math/vec.h"
+#include "rt/ray.h"
+#include "world/object.h"
+
+// A direction toward a point on a light, as seen from a shading point
+typedef struct {
+    vec3  dir;      // unit direction from the shading point to the light
+    f32   dist;     // distance to the sampled point
+    f32   pdf;      // solid angle density of dir
+    Color radiance; // radiance emitted toward the shading point
+} LightSample;
+
+// Emissive objects that can be sampled explicitly (diffuse lights on spheres and triangles, planes are unbounded)
+bool Light_Samplable(Object* obj);
+
+// Samples a direction toward the light from a point, false if there's nothing to sample (e.g. from inside a sphere)
+bool Light_Sample(Object* obj, point3 from, LightSample* sample);
+
+// Solid angle density Light_Sample would have produced for the ray from a point that hit the light at hit
+f32 Light_PDF(Object* obj, point3 from, HitInfo* hit);
+
+Color Light_Radiance(Object* obj, HitInfo* hit);
+
+// Picks a light for a shading point in proportion to an estimate of its contribution, by walking a tree of the lights'
+// bounds, power and emission directions (a light BVH). Points the tree can't rank any light for fall back to picking
+// in proportion to power alone (alias table)
+// Lights are referred to by their index in the objects array the sampler was built with
+typedef struct LightSampler LightSampler;
+
+LightSampler* LightSampler_New(Object* objects, u32* lights, size_t num_lights, size_t num_objects);
+void          LightSampler_Delete(LightSampler* sampler);
+
+// Picks a light to sample from a point, returning the object index and the probability of having picked it
+bool LightSampler_Sample(LightSampler* sampler, point3 from, u32* object, f32* pmf);
+
+// Probability LightSampler_Sample would have picked the object from a point (0 if it isn't one of the lights)
+f32 LightSampler_PMF(LightSampler* sampler, point3 from, u32 object);
+
+// Total power emitted by the lights
+f32 LightSampler_Power(LightSampler* sampler);
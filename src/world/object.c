@@ -4,6 +4,27 @@
 
 #include "rt/materials.h"
 
+intern thread_local MaterialOverride* g_overrides     = NULL;
+intern thread_local size_t            g_num_overrides = 0;
+
+void Object_Bind_Overrides(MaterialOverride* overrides, size_t num_overrides)
+{
+    g_overrides     = overrides;
+    g_num_overrides = overrides ? num_overrides : 0;
+}
+
+// The material the calling thread shades obj with
+Material* Object_Material(Object* obj)
+{
+    for (size_t ii = 0; ii < g_num_overrides; ii++) {
+        if (g_overrides[ii].original == obj->material) {
+            return g_overrides[ii].replacement;
+        }
+    }
+
+    return obj->material;
+}
+
 bool Surface_HitAt(Surface* surface, Ray* ray, f32 t_min, f32 t_max, HitInfo* hit)
 {
     switch (surface->type) {
@@ -141,3 +162,118 @@ bool Material_Bounce(
 
     OPTIMIZE_UNREACHABLE;
 }
+
+bool Material_Evaluable(Material* material)
+{
+    switch (material->type) {
+        case MATERIAL_DISNEY_DIFFUSE:
+        case MATERIAL_DISNEY_METAL:
+        case MATERIAL_DISNEY_GLASS:
+        case MATERIAL_DISNEY_CLEARCOAT:
+        case MATERIAL_DISNEY_SHEEN:
+        case MATERIAL_DISNEY_BSDF: {
+            return true;
+        } break;
+
+        // the legacy materials don't have a well defined BSDF
+        default: {
+            return false;
+        } break;
+    }
+}
+
+Color Material_Eval(Material* material, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    switch (material->type) {
+        case MATERIAL_DISNEY_DIFFUSE: {
+            return Material_Disney_Diffuse_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_METAL: {
+            return Material_Disney_Metal_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_GLASS: {
+            return Material_Disney_Glass_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_CLEARCOAT: {
+            return Material_Disney_Clearcoat_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_SHEEN: {
+            return Material_Disney_Sheen_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_BSDF: {
+            return Material_Disney_BSDF_Eval(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        default: {
+            return COLOR_BLACK;
+        } break;
+    }
+}
+
+f32 Material_PDF(Material* material, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out)
+{
+    switch (material->type) {
+        case MATERIAL_DISNEY_DIFFUSE: {
+            return Material_Disney_Diffuse_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_METAL: {
+            return Material_Disney_Metal_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_GLASS: {
+            return Material_Disney_Glass_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_CLEARCOAT: {
+            return Material_Disney_Clearcoat_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_SHEEN: {
+            return Material_Disney_Sheen_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        case MATERIAL_DISNEY_BSDF: {
+            return Material_Disney_BSDF_PDF(&material->disney, ray_in, hit, ray_dir_out);
+        } break;
+
+        default: {
+            return 0.0f;
+        } break;
+    }
+}
+
+Color Material_Albedo(Material* material, HitInfo* hit)
+{
+    switch (material->type) {
+        case MATERIAL_DIFFUSE: {
+            return Texture_ColorAt(material->diffuse.albedo, hit->uv);
+        } break;
+
+        case MATERIAL_METAL: {
+            return Texture_ColorAt(material->metal.albedo, hit->uv);
+        } break;
+
+        case MATERIAL_DIELECTRIC: {
+            return Texture_ColorAt(material->dielectric.albedo, hit->uv);
+        } break;
+
+        case MATERIAL_DISNEY_DIFFUSE:
+        case MATERIAL_DISNEY_METAL:
+        case MATERIAL_DISNEY_GLASS:
+        case MATERIAL_DISNEY_SHEEN:
+        case MATERIAL_DISNEY_BSDF: {
+            return Texture_ColorAt(material->disney.albedo, hit->uv);
+        } break;
+
+        // emitters and the clearcoat layer don't tint what they reflect
+        default: {
+            return COLOR_WHITE;
+        } break;
+    }
+}
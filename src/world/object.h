@@ -17,6 +17,17 @@ typedef struct {
     // space once a mesh is converted to objects
 } Object;
 
+// Substitutes replacement wherever original is hit, so threads can render one shared (read only) scene with different
+// materials, bound per thread like the sampler (see Object_Bind_Overrides), emission seen by the light sampler isn't
+// affected since it's built with the scene
+typedef struct {
+    Material* original;
+    Material* replacement;
+} MaterialOverride;
+
+void      Object_Bind_Overrides(MaterialOverride* overrides, size_t num_overrides); // NULL/0 unbinds
+Material* Object_Material(Object* obj);
+
 BoundingBox Surface_BoundingBox(Surface* surface);
 bool        Surface_Bounded(Surface* surface);
 bool        Surface_HitAt(Surface* surface, Ray* ray, f32 tMin, f32 tMax, HitInfo* hitInfo);
@@ -28,3 +39,11 @@ bool Material_Bounce(
     Color*    colorSurface,
     Color*    colorEmitted,
     Ray*      rayOut);
+
+// Materials whose BSDF can be evaluated for an arbitrary direction, and so can be lit by sampling lights directly
+bool  Material_Evaluable(Material* material);
+Color Material_Eval(Material* material, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+f32   Material_PDF(Material* material, Ray* ray_in, HitInfo* hit, vec3 ray_dir_out);
+
+// Base color of the material at the hit, white for materials that don't tint what they reflect
+Color Material_Albedo(Material* material, HitInfo* hit);
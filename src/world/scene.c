@@ -5,20 +5,32 @@
 #include <stdio.h>
 
 #include "math/math.h"
+#include "math/sampler.h"
 #include "math/vec.h"
 #include "rt/accelerators/kdtree.h"
+#include "world/lights.h"
 #include "world/object.h"
 #include "world/skybox.h"
 
 #define Vector_Type Object
 #include "ctl/containers/vector.h"
 
+#define Vector_Type u32
+#include "ctl/containers/vector.h"
+
 typedef struct Scene {
     Skybox*         skybox;
     Vector(Object)* objects;
     Vector(Object)* unboundObjs;
     Vector(Object)* kdObjects;
     KDTree*         kdTree;
+    BoundingBox     bounds;
+    Vector(u32)*    lights; // indices into kdObjects of the lights that can be sampled directly
+    LightSampler*   lightSampler;
+    f32             skyProb;   // odds of sampling the sky rather than an object when sampling a light
+    Material**      materials; // distinct materials of the objects in the order they were added, shared by replicas
+    size_t          numMaterials;
+    Scene*          source; // the scene this is a replica of, which owns the light sampler and materials, NULL if not
 } Scene;
 
 Scene* Scene_New(Skybox* skybox)
@@ -43,10 +55,23 @@ Scene* Scene_New(Skybox* skybox)
         goto error_KdObjects;
     }
 
-    scene->skybox = skybox;
+    scene->lights = Vector_New(u32)(16);
+    if (scene->lights == NULL) {
+        goto error_Lights;
+    }
+
+    scene->skybox       = skybox;
+    scene->kdTree       = NULL;
+    scene->lightSampler = NULL;
+    scene->skyProb      = 0.0f;
+    scene->materials    = NULL;
+    scene->numMaterials = 0;
+    scene->source       = NULL;
 
     return scene;
 
+error_Lights:
+    Vector_Delete(scene->kdObjects);
 error_KdObjects:
     Vector_Delete(scene->unboundObjs);
 error_UnboundObjectsVector:
@@ -62,6 +87,15 @@ void Scene_Delete(Scene* scene)
     Vector_Delete(scene->objects);
     Vector_Delete(scene->unboundObjs);
     Vector_Delete(scene->kdObjects);
+    Vector_Delete(scene->lights);
+
+    if (scene->lightSampler != NULL && scene->source == NULL) {
+        LightSampler_Delete(scene->lightSampler);
+    }
+
+    if (scene->source == NULL) {
+        free(scene->materials);
+    }
 
     if (scene->kdTree != NULL) {
         KDTree_Delete(scene->kdTree);
@@ -97,6 +131,34 @@ intern bool Scene_ClosestHitInArray(Object* objs, size_t len, Ray* ray, Object**
     }
 }
 
+Scene* Scene_Replicate(Scene* scene)
+{
+    Scene* replica = Scene_New(scene->skybox);
+    if (replica == NULL) {
+        return NULL;
+    }
+
+    // the original's object list is only needed to prepare it, the replica just gets what's traced
+    if (!Vector_Copy(scene->unboundObjs, replica->unboundObjs) || !Vector_Copy(scene->kdObjects, replica->kdObjects)
+        || !Vector_Copy(scene->lights, replica->lights)) {
+        Scene_Delete(replica);
+        return NULL;
+    }
+
+    replica->bounds       = scene->bounds;
+    replica->lightSampler = scene->lightSampler;
+    replica->skyProb      = scene->skyProb;
+    replica->materials    = scene->materials;
+    replica->numMaterials = scene->numMaterials;
+    replica->source       = scene;
+
+    if (scene->kdTree != NULL) {
+        replica->kdTree = KDTree_Copy(scene->kdTree, scene->kdObjects->at, replica->kdObjects->at);
+    }
+
+    return replica;
+}
+
 bool Scene_ClosestHit(Scene* scene, Ray* ray, Object** obj_hit, HitInfo* hit)
 {
     // TODO: see if fetching more than the first object is beneficial
@@ -142,6 +204,101 @@ bool Scene_ClosestHit(Scene* scene, Ray* ray, Object** obj_hit, HitInfo* hit)
     }
 }
 
+bool Scene_Occluded(Scene* scene, Ray* ray, f32 dist)
+{
+    // the light itself sits at dist, shrink it a little so it doesn't count as a blocker
+    f32 t_max = dist * (1.0f - 1e-3f);
+
+    if (KDTree_Occluded(scene->kdTree, ray, t_max)) {
+        return true;
+    }
+
+    for (size_t ii = 0; ii < scene->unboundObjs->length; ii++) {
+        HitInfo hit;
+        if (Surface_HitAt(&scene->unboundObjs->at[ii].surface, ray, RT_EPSILON, t_max, &hit)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+intern inline f32 Scene_SkySelectProb(Scene* scene)
+{
+    return scene->skyProb;
+}
+
+bool Scene_SampleLight(Scene* scene, point3 from, LightSample* sample)
+{
+    f32 sky_prob = Scene_SkySelectProb(scene);
+
+    if (Sampler_1D() < sky_prob) {
+        vec3 dir;
+        f32  pdf;
+        if (!Skybox_Sample(scene->skybox, &dir, &pdf)) {
+            return false;
+        }
+
+        sample->dir      = dir;
+        sample->dist     = INF;
+        sample->pdf      = pdf * sky_prob;
+        sample->radiance = Skybox_ColorAt(scene->skybox, dir);
+        return true;
+    }
+
+    if (scene->lightSampler == NULL) {
+        return false;
+    }
+
+    u32 index;
+    f32 pmf;
+    if (!LightSampler_Sample(scene->lightSampler, from, &index, &pmf)) {
+        return false;
+    }
+
+    if (!Light_Sample(&scene->kdObjects->at[index], from, sample)) {
+        return false;
+    }
+
+    sample->pdf *= pmf * (1.0f - sky_prob);
+    return true;
+}
+
+f32 Scene_LightPDF(Scene* scene, point3 from, Object* obj, HitInfo* hit)
+{
+    if (scene->lightSampler == NULL) {
+        return 0.0f;
+    }
+
+    // only bounded objects can be lights, and those live in kdObjects
+    Object* objects = scene->kdObjects->at;
+    if (obj < objects || obj >= objects + scene->kdObjects->length) {
+        return 0.0f;
+    }
+
+    f32 pmf = LightSampler_PMF(scene->lightSampler, from, (u32)(obj - objects));
+    if (pmf <= 0.0f) {
+        return 0.0f;
+    }
+
+    return Light_PDF(obj, from, hit) * pmf * (1.0f - Scene_SkySelectProb(scene));
+}
+
+f32 Scene_SkyPDF(Scene* scene, vec3 dir)
+{
+    f32 sky_prob = Scene_SkySelectProb(scene);
+    if (sky_prob <= 0.0f) {
+        return 0.0f;
+    }
+
+    return Skybox_PDF(scene->skybox, dir) * sky_prob;
+}
+
+bool Scene_HasLights(Scene* scene)
+{
+    return scene->lightSampler != NULL || Skybox_Samplable(scene->skybox);
+}
+
 bool Scene_Prepare(Scene* scene)
 {
     Vector_Reserve(scene->kdObjects, scene->objects->length);
@@ -155,6 +312,76 @@ bool Scene_Prepare(Scene* scene)
         }
     }
 
+    // bounds of everything in the kd tree, unbounded objects are left out
+    scene->bounds = (BoundingBox){
+        .min = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+        .max = {.x = 0.0f, .y = 0.0f, .z = 0.0f},
+    };
+
+    for (size_t ii = 0; ii < scene->kdObjects->length; ii++) {
+        BoundingBox box = Surface_BoundingBox(&scene->kdObjects->at[ii].surface);
+
+        if (ii == 0) {
+            scene->bounds = box;
+            continue;
+        }
+
+        for (size_t axis = 0; axis < 3; axis++) {
+            scene->bounds.min.elem[axis] = minf(scene->bounds.min.elem[axis], box.min.elem[axis]);
+            scene->bounds.max.elem[axis] = maxf(scene->bounds.max.elem[axis], box.max.elem[axis]);
+        }
+    }
+
+    for (size_t ii = 0; ii < scene->kdObjects->length; ii++) {
+        if (Light_Samplable(&scene->kdObjects->at[ii])) {
+            Vector_Push(scene->lights, (u32)ii);
+        }
+    }
+
+    // consecutive objects (a mesh's triangles) mostly share a material, so only changes are looked up
+    Material* prev = NULL;
+    for (size_t ii = 0; ii < scene->objects->length; ii++) {
+        Material* material = scene->objects->at[ii].material;
+        if (material == prev || Scene_MaterialID(scene, material) < scene->numMaterials) {
+            prev = material;
+            continue;
+        }
+
+        Material** materials = (Material**)realloc(scene->materials, (scene->numMaterials + 1) * sizeof(Material*));
+        if (materials == NULL) {
+            return false;
+        }
+
+        scene->materials                       = materials;
+        scene->materials[scene->numMaterials++] = material;
+        prev                                   = material;
+    }
+
+    if (scene->lights->length > 0) {
+        scene->lightSampler = LightSampler_New(
+            scene->kdObjects->at,
+            scene->lights->at,
+            scene->lights->length,
+            scene->kdObjects->length);
+
+        if (scene->lightSampler == NULL) {
+            return false;
+        }
+    }
+
+    // the sky and the objects are picked in proportion to their power, the sky's as seen by a sphere around the scene
+    if (!Skybox_Samplable(scene->skybox)) {
+        scene->skyProb = 0.0f;
+    } else if (scene->lightSampler == NULL) {
+        scene->skyProb = 1.0f;
+    } else {
+        f32 radius      = 0.5f * vmag(vsub(scene->bounds.max, scene->bounds.min));
+        f32 sky_power   = Skybox_Power(scene->skybox, radius);
+        f32 light_power = LightSampler_Power(scene->lightSampler);
+
+        scene->skyProb = sky_power + light_power > 0.0f ? sky_power / (sky_power + light_power) : 0.5f;
+    }
+
     // now we need to construct the kd tree using the bounding boxes
     if (scene->kdObjects->length > 0) {
         scene->kdTree = KDTree_New(scene->kdObjects->at, scene->kdObjects->length);
@@ -170,6 +397,22 @@ bool Scene_Add_Object(Scene* scene, Object* obj)
     return Vector_Push(scene->objects, obj);
 }
 
+u32 Scene_MaterialID(Scene* scene, Material* material)
+{
+    for (size_t ii = 0; ii < scene->numMaterials; ii++) {
+        if (scene->materials[ii] == material) {
+            return (u32)ii;
+        }
+    }
+
+    return (u32)scene->numMaterials;
+}
+
+BoundingBox Scene_Get_Bounds(Scene* scene)
+{
+    return scene->bounds;
+}
+
 Color Scene_Get_SkyColor(Scene* scene, vec3 dir)
 {
     return Skybox_ColorAt(scene->skybox, dir);
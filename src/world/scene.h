@@ -1,6 +1,7 @@
 #pragma once
 
 #include "rt/accelerators/kdtree.h"
+#include "world/lights.h"
 #include "world/object.h"
 #include "world/skybox.h"
 
@@ -10,6 +11,24 @@ Scene* Scene_New(Skybox* skybox);
 void   Scene_Delete(Scene* scene);
 bool   Scene_Prepare(Scene* scene);
 bool   Scene_ClosestHit(Scene* scene, Ray* ray, Object** objHit, HitInfo* hit);
+bool   Scene_Occluded(Scene* scene, Ray* ray, f32 dist);
 
-bool  Scene_Add_Object(Scene* scene, Object* obj);
-Color Scene_Get_SkyColor(Scene* scene, vec3 dir);
+// Copies the prepared scene's objects and kd-tree, so threads on another NUMA node can trace against memory local to
+// them (the copy is placed by the calling thread), the light sampler, skybox and materials are shared with the original
+// which has to outlive the replica
+Scene* Scene_Replicate(Scene* scene);
+
+// Picks a light (see LightSampler) and samples a direction toward it, the pdf includes the odds of picking the light
+// An equirectangular sky is sampled as a light too (with dist = INF)
+bool Scene_SampleLight(Scene* scene, point3 from, LightSample* sample);
+f32  Scene_LightPDF(Scene* scene, point3 from, Object* obj, HitInfo* hit);
+f32  Scene_SkyPDF(Scene* scene, vec3 dir);
+bool Scene_HasLights(Scene* scene);
+
+// Index of one of the scene's materials among the distinct materials of its objects (in the order they were added),
+// stable across scenes built from the same objects in the same order, the material count if it isn't one of them
+u32 Scene_MaterialID(Scene* scene, Material* material);
+
+bool        Scene_Add_Object(Scene* scene, Object* obj);
+BoundingBox Scene_Get_Bounds(Scene* scene);
+Color       Scene_Get_SkyColor(Scene* scene, vec3 dir);
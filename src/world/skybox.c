@@ -7,6 +7,7 @@
 
 #include "gfx/texture.h"
 #include "math/math.h"
+#include "math/sampler.h"
 #include "math/vec.h"
 
 void Skybox_Delete(Skybox* skybox)
@@ -16,6 +17,12 @@ void Skybox_Delete(Skybox* skybox)
             Texture_Delete(skybox->tex[ii]);
         }
     }
+
+    if (skybox->envmap != NULL) {
+        Distribution2D_Uninit(&skybox->envmap_dist);
+        ImageColor_Unload(skybox->envmap);
+        free(skybox->envmap);
+    }
 }
 
 Skybox* Skybox_Import_BMP(const char* folder_path)
@@ -63,8 +70,164 @@ error_load:
     return NULL;
 }
 
+// Importance of each pixel of an equirectangular map, rows near the poles cover less solid angle
+intern f32* Equirect_Weights(ImageColor* envmap)
+{
+    size_t width  = envmap->res.width;
+    size_t height = envmap->res.height;
+
+    f32* weights = (f32*)malloc(width * height * sizeof(f32));
+    if (weights == NULL) {
+        return NULL;
+    }
+
+    for (size_t yy = 0; yy < height; yy++) {
+        f32 sin_theta = sinf(PI32 * (yy + 0.5f) / (f32)height);
+
+        for (size_t xx = 0; xx < width; xx++) {
+            weights[yy * width + xx] = Color_Luminance(ImageColor_GetPixel(envmap, xx, yy)) * sin_theta;
+        }
+    }
+
+    return weights;
+}
+
+Skybox* Skybox_Import_HDR(const char* path)
+{
+    FILE*       fd      = NULL;
+    ImageColor* envmap  = NULL;
+    f32*        weights = NULL;
+
+    Skybox* skybox = (Skybox*)calloc(1, sizeof(*skybox));
+    if (skybox == NULL) {
+        goto error_Skybox;
+    }
+
+    fd = fopen(path, "rb");
+    if (fd == NULL) {
+        goto error_Open;
+    }
+
+    envmap = (ImageColor*)calloc(1, sizeof(ImageColor));
+    if (envmap == NULL) {
+        goto error_Envmap;
+    }
+
+    if (!ImageColor_Load_HDR(envmap, fd)) {
+        goto error_Load;
+    }
+
+    weights = Equirect_Weights(envmap);
+    if (weights == NULL) {
+        goto error_Weights;
+    }
+
+    if (!Distribution2D_Init(&skybox->envmap_dist, weights, envmap->res.width, envmap->res.height)) {
+        goto error_Distribution;
+    }
+
+    free(weights);
+    fclose(fd);
+
+    skybox->type   = SKYBOX_EQUIRECT;
+    skybox->envmap = envmap;
+    return skybox;
+
+error_Distribution:
+    free(weights);
+error_Weights:
+    ImageColor_Unload(envmap);
+error_Load:
+    free(envmap);
+error_Envmap:
+    fclose(fd);
+error_Open:
+    free(skybox);
+error_Skybox:
+    return NULL;
+}
+
+// Latitude-longitude parameterization, u goes around Z+ starting from X-, v goes from Z+ (0) to Z- (1)
+intern inline point2 Equirect_DirToUV(vec3 dir)
+{
+    f32 phi   = atan2f(dir.y, dir.x);
+    f32 theta = acosf(clampf(dir.z, -1.0f, 1.0f));
+
+    return (point2){.u = (phi + PI32) / (2.0f * PI32), .v = theta / PI32};
+}
+
+intern inline vec3 Equirect_UVToDir(point2 uv)
+{
+    f32 phi   = 2.0f * PI32 * uv.u - PI32;
+    f32 theta = PI32 * uv.v;
+
+    return (vec3){.x = sinf(theta) * cosf(phi), .y = sinf(theta) * sinf(phi), .z = cosf(theta)};
+}
+
+intern Color Equirect_ColorAt(Skybox* skybox, vec3 dir)
+{
+    ImageColor* envmap = skybox->envmap;
+    point2      uv     = Equirect_DirToUV(dir);
+
+    size_t xx = MIN((size_t)(uv.u * envmap->res.width), envmap->res.width - 1);
+    size_t yy = MIN((size_t)(uv.v * envmap->res.height), envmap->res.height - 1);
+
+    return ImageColor_GetPixel(envmap, xx, yy);
+}
+
+bool Skybox_Samplable(Skybox* skybox)
+{
+    return skybox->type == SKYBOX_EQUIRECT;
+}
+
+bool Skybox_Sample(Skybox* skybox, vec3* dir, f32* pdf)
+{
+    f32    uv_pdf;
+    point2 uv = Distribution2D_Sample(&skybox->envmap_dist, Sampler_2D(), &uv_pdf);
+
+    f32 sin_theta = sinf(PI32 * uv.v);
+    if (uv_pdf <= 0.0f || sin_theta <= 0.0f) {
+        return false;
+    }
+
+    // jacobian of the map from [0, 1)^2 to the sphere is 2 * pi^2 * sin(theta)
+    *dir = Equirect_UVToDir(uv);
+    *pdf = uv_pdf / (2.0f * PI32 * PI32 * sin_theta);
+    return true;
+}
+
+f32 Skybox_PDF(Skybox* skybox, vec3 dir)
+{
+    if (!Skybox_Samplable(skybox)) {
+        return 0.0f;
+    }
+
+    f32 sin_theta = sqrtf(maxf(0.0f, 1.0f - dir.z * dir.z));
+    if (sin_theta <= 0.0f) {
+        return 0.0f;
+    }
+
+    return Distribution2D_PDF(&skybox->envmap_dist, Equirect_DirToUV(dir)) / (2.0f * PI32 * PI32 * sin_theta);
+}
+
+f32 Skybox_Power(Skybox* skybox, f32 radius)
+{
+    if (!Skybox_Samplable(skybox)) {
+        return 0.0f;
+    }
+
+    // the marginal's integral is the mean of luminance * sin(theta) over [0, 1)^2, the jacobian turns it into the
+    // luminance integrated over all directions, each of which lights the sphere's cross-section
+    f32 luminance = 2.0f * PI32 * PI32 * skybox->envmap_dist.marginal.integral;
+    return PI32 * radius * radius * luminance;
+}
+
 Color Skybox_ColorAt(Skybox* skybox, vec3 dir)
 {
+    if (skybox->type == SKYBOX_EQUIRECT) {
+        return Equirect_ColorAt(skybox, dir);
+    }
+
     f32 absX = fabsf(dir.x);
     f32 absY = fabsf(dir.y);
     f32 absZ = fabsf(dir.z);
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "gfx/color.h"
+#include "gfx/image.h"
 #include "gfx/texture.h"
+#include "math/distribution.h"
 #include "math/vec.h"
 
+typedef enum {
+    SKYBOX_CUBEMAP,  // 6 LDR faces, only reached by rays that escape the scene
+    SKYBOX_EQUIRECT, // HDR latitude-longitude map (Z+ at the top row), can be importance sampled as a light
+} SkyboxType;
+
 typedef struct {
+    SkyboxType type;
+
     union {
         struct {
             Texture *xpos, *xneg;
@@ -14,8 +25,20 @@ typedef struct {
 
         Texture* tex[6];
     };
+
+    ImageColor*    envmap;
+    Distribution2D envmap_dist; // proportional to luminance * sin(theta), i.e. to radiance per unit solid angle
 } Skybox;
 
 void    Skybox_Delete(Skybox* skybox);
 Skybox* Skybox_Import_BMP(const char* folder_path);
+Skybox* Skybox_Import_HDR(const char* path);
 Color   Skybox_ColorAt(Skybox* skybox, vec3 dir);
+
+// Importance sampling of the sky as a light, only equirectangular maps can be sampled
+bool Skybox_Samplable(Skybox* skybox);
+bool Skybox_Sample(Skybox* skybox, vec3* dir, f32* pdf);
+f32  Skybox_PDF(Skybox* skybox, vec3 dir);
+
+// Power the sky delivers to a sphere of the given radius, in the same units as the power of a light
+f32 Skybox_Power(Skybox* skybox, f32 radius);